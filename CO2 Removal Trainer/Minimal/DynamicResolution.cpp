@@ -0,0 +1,67 @@
+#include "DynamicResolution.h"
+
+#include <math.h>
+
+DynamicResolution::DynamicResolution(float minScale, float maxScale)
+	: minScale(minScale), maxScale(maxScale), current(1.0f), targetMs(1000.0 / 90.0 * DYNRES_HEADROOM),
+	overBudget(0), underBudget(0)
+{
+	this->current = clamp(1.0f);
+}
+
+void DynamicResolution::setBudget(double frameMs)
+{
+	this->targetMs = frameMs * DYNRES_HEADROOM;
+}
+
+void DynamicResolution::reset(float scale)
+{
+	this->current = clamp(scale);
+	this->overBudget = this->underBudget = 0;
+}
+
+float DynamicResolution::clamp(float scale) const
+{
+	if (scale < this->minScale)
+		return this->minScale;
+	if (scale > this->maxScale)
+		return this->maxScale;
+	return scale;
+}
+
+float DynamicResolution::update(double gpuMs)
+{
+	if (gpuMs <= 0.0)
+		return this->current;
+
+	if (gpuMs > this->targetMs)
+	{
+		this->overBudget++;
+		this->underBudget = 0;
+	}
+	else if (gpuMs < this->targetMs * DYNRES_UP_THRESHOLD)
+	{
+		this->underBudget++;
+		this->overBudget = 0;
+	}
+	else
+	{
+		// inside the band, keep the scale
+		this->overBudget = this->underBudget = 0;
+	}
+
+	if (this->overBudget < DYNRES_DOWN_FRAMES && this->underBudget < DYNRES_UP_FRAMES)
+		return this->current;
+
+	// cost goes with the pixel count, so the scale that would just meet the target is the square root of the ratio
+	float wanted = this->current * (float)sqrt(this->targetMs / gpuMs);
+	float step = this->current * DYNRES_MAX_STEP;
+	if (wanted < this->current - step)
+		wanted = this->current - step;
+	if (wanted > this->current + step)
+		wanted = this->current + step;
+
+	this->current = clamp(wanted);
+	this->overBudget = this->underBudget = 0;
+	return this->current;
+}
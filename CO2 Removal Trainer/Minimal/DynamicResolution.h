@@ -0,0 +1,42 @@
+#ifndef DYNAMICRESOLUTION_H_
+#define DYNAMICRESOLUTION_H_
+
+// Fraction of the frame budget the eyes may take on the GPU, the rest is left to the compositor
+#define DYNRES_HEADROOM 0.85
+// Over budget for this many measured frames in a row scales down, under the lower threshold this long scales up
+#define DYNRES_DOWN_FRAMES 2
+#define DYNRES_UP_FRAMES 45
+// Only scale back up once the GPU time is this far under the target
+#define DYNRES_UP_THRESHOLD 0.8
+// Largest change of the scale in one step, as a fraction of the current scale
+#define DYNRES_MAX_STEP 0.1f
+
+// Picks the pixel density of the eye viewports from measured GPU time. The scale applies
+// to width and height, so the cost of a frame grows with its square. Scaling down reacts
+// within a couple of frames, scaling up waits until there has been headroom for a while,
+// so the scale doesn't oscillate around the budget.
+class DynamicResolution
+{
+public:
+	DynamicResolution(float minScale, float maxScale);
+
+	// Frame budget in ms, 1000 / refresh rate of the headset
+	void setBudget(double frameMs);
+	// Feeds the GPU time of one measured frame, returns the scale the next frames should use
+	float update(double gpuMs);
+
+	float scale() const { return this->current; }
+	float minimum() const { return this->minScale; }
+	float maximum() const { return this->maxScale; }
+	double target() const { return this->targetMs; }
+	void reset(float scale);
+
+private:
+	float minScale, maxScale, current;
+	double targetMs;
+	int overBudget, underBudget;
+
+	float clamp(float scale) const;
+};
+
+#endif
@@ -0,0 +1,111 @@
+#include "EyeTarget.h"
+
+EyeTarget::EyeTarget()
+	: fbo(0), resolveFbo(0), colorBuffer(0), depthBuffer(0), output(0),
+	width(0), height(0), sampleCount(1), depth(GL_DEPTH_COMPONENT24), timing(false)
+{
+}
+
+void EyeTarget::create(GLsizei width, GLsizei height, GLsizei samples, GLenum depthFormat)
+{
+	destroy();
+
+	GLint maxSamples = 1;
+	glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+	if (samples > maxSamples)
+		samples = maxSamples;
+	if (samples < 1)
+		samples = 1;
+
+	this->width = width;
+	this->height = height;
+	this->sampleCount = samples;
+	this->depth = depthFormat;
+
+	glGenFramebuffers(1, &this->fbo);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->fbo);
+
+	glGenRenderbuffers(1, &this->depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, this->depthBuffer);
+	if (samples > 1)
+	{
+		glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, depthFormat, width, height);
+
+		// same format as the swap chain, so the resolve is a straight copy of the averaged samples
+		glGenRenderbuffers(1, &this->colorBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, this->colorBuffer);
+		glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_SRGB8_ALPHA8, width, height);
+		glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->colorBuffer);
+
+		glGenFramebuffers(1, &this->resolveFbo);
+	}
+	else
+	{
+		glRenderbufferStorage(GL_RENDERBUFFER, depthFormat, width, height);
+	}
+	glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, this->depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+
+	// results still in flight were measured with the old buffers
+	this->drawTimer.reset();
+	this->resolveTimer.reset();
+}
+
+void EyeTarget::destroy()
+{
+	if (this->fbo)
+		glDeleteFramebuffers(1, &this->fbo);
+	if (this->resolveFbo)
+		glDeleteFramebuffers(1, &this->resolveFbo);
+	if (this->colorBuffer)
+		glDeleteRenderbuffers(1, &this->colorBuffer);
+	if (this->depthBuffer)
+		glDeleteRenderbuffers(1, &this->depthBuffer);
+	this->fbo = this->resolveFbo = this->colorBuffer = this->depthBuffer = 0;
+}
+
+void EyeTarget::setTiming(bool enabled)
+{
+	this->timing = enabled;
+	this->drawTimer.reset();
+	this->resolveTimer.reset();
+}
+
+void EyeTarget::bind(GLuint output)
+{
+	this->output = output;
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->fbo);
+	if (this->sampleCount == 1)
+		glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, output, 0);
+	if (this->timing)
+		this->drawTimer.begin();
+}
+
+void EyeTarget::resolve()
+{
+	if (this->timing)
+	{
+		this->drawTimer.end();
+		this->resolveTimer.begin();
+	}
+
+	if (this->sampleCount > 1)
+	{
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, this->fbo);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->resolveFbo);
+		glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->output, 0);
+		glBlitFramebuffer(0, 0, this->width, this->height, 0, 0, this->width, this->height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	}
+	else
+	{
+		// the swap chain texture was drawn into directly, just let go of it
+		glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+	}
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+
+	if (this->timing)
+		this->resolveTimer.end();
+}
@@ -0,0 +1,50 @@
+#ifndef EYETARGET_H_
+#define EYETARGET_H_
+
+#include <GL/glew.h>
+
+#include "GpuTimer.h"
+
+// Framebuffer both eyes are drawn into before the image lands in the swap chain texture.
+// With one sample the swap chain texture is the color attachment and there is nothing to
+// resolve. With more, color and depth are multisampled renderbuffers and resolve() blits
+// the color down into the swap chain texture.
+class EyeTarget
+{
+public:
+	EyeTarget();
+
+	// (Re)creates the buffers. samples is clamped to GL_MAX_SAMPLES, depthFormat is
+	// GL_DEPTH_COMPONENT16, GL_DEPTH_COMPONENT24 or GL_DEPTH_COMPONENT32F.
+	void create(GLsizei width, GLsizei height, GLsizei samples, GLenum depthFormat);
+	void destroy();
+
+	// Binds the target for drawing, output is the texture the frame has to end up in
+	void bind(GLuint output);
+	// Resolves into output and leaves the draw framebuffer unbound
+	void resolve();
+
+	GLsizei samples() const { return this->sampleCount; }
+	GLenum depthFormat() const { return this->depth; }
+
+	// Times drawing into the target and resolving it on the GPU. Off by default, since
+	// the timers can't run while anything around the target is being timed.
+	void setTiming(bool enabled);
+	// Average GPU time of drawing into the target and of resolving it, in ms, over the
+	// frames read back since timing was switched on or the target was recreated
+	double averageDrawTime() const { return this->drawTimer.average(); }
+	double averageResolveTime() const { return this->resolveTimer.average(); }
+	unsigned int timedFrames() const { return this->resolveTimer.samples(); }
+
+private:
+	GLuint fbo, resolveFbo;
+	GLuint colorBuffer, depthBuffer;
+	GLuint output;
+	GLsizei width, height, sampleCount;
+	GLenum depth;
+
+	bool timing;
+	GpuTimer drawTimer, resolveTimer;
+};
+
+#endif
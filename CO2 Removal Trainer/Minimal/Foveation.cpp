@@ -0,0 +1,155 @@
+#include "Foveation.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+const FoveationLevel Foveation::levels[FOVEATION_LEVELS] = {
+	{ "off", 1.0f, 1.0f },
+	{ "low", 0.65f, 0.75f },
+	{ "medium", 0.5f, 0.5f },
+	{ "high", 0.4f, 0.35f }
+};
+
+Foveation::Foveation()
+	: peripheryTexture(0), insetTexture(0), readFbo(0), drawFbo(0), eyeWidth(0), eyeHeight(0),
+	peripheryWidth(0), peripheryHeight(0), insetWidth(0), insetHeight(0), insetX(0), insetY(0), currentLevel(0)
+{
+}
+
+GLuint Foveation::createLayerTexture(GLsizei width, GLsizei height)
+{
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	// same format as the swap chain, so compositing is a plain copy
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8_ALPHA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return texture;
+}
+
+void Foveation::create(GLsizei eyeWidth, GLsizei eyeHeight, GLsizei samples, GLenum depthFormat, int level)
+{
+	this->periphery.destroy();
+	this->inset.destroy();
+	if (this->peripheryTexture)
+		glDeleteTextures(1, &this->peripheryTexture);
+	if (this->insetTexture)
+		glDeleteTextures(1, &this->insetTexture);
+	this->peripheryTexture = this->insetTexture = 0;
+
+	this->currentLevel = level;
+	if (level <= 0 || level >= FOVEATION_LEVELS)
+	{
+		this->currentLevel = 0;
+		return;
+	}
+
+	const FoveationLevel& preset = levels[level];
+	this->eyeWidth = eyeWidth;
+	this->eyeHeight = eyeHeight;
+	this->peripheryWidth = (GLsizei)(eyeWidth * preset.peripheryScale);
+	this->peripheryHeight = (GLsizei)(eyeHeight * preset.peripheryScale);
+	this->insetWidth = (GLsizei)(eyeWidth * preset.insetSize);
+	this->insetHeight = (GLsizei)(eyeHeight * preset.insetSize);
+
+	this->periphery.create(this->peripheryWidth, this->peripheryHeight, samples, depthFormat);
+	this->inset.create(this->insetWidth, this->insetHeight, samples, depthFormat);
+	this->peripheryTexture = createLayerTexture(this->peripheryWidth, this->peripheryHeight);
+	this->insetTexture = createLayerTexture(this->insetWidth, this->insetHeight);
+
+	if (this->readFbo == 0)
+	{
+		glGenFramebuffers(1, &this->readFbo);
+		glGenFramebuffers(1, &this->drawFbo);
+	}
+}
+
+void Foveation::placeInset(const glm::mat4& projection)
+{
+	// The Rift's eye frusta are asymmetric, so the optical axis (0, 0, -1) isn't in the middle
+	// of the viewport. Center the inset on it, snapped to whole pixels and kept inside the eye.
+	float axisX = (-projection[2][0] + 1.0f) * 0.5f * this->eyeWidth;
+	float axisY = (-projection[2][1] + 1.0f) * 0.5f * this->eyeHeight;
+	this->insetX = (GLint)(axisX - this->insetWidth * 0.5f + 0.5f);
+	this->insetY = (GLint)(axisY - this->insetHeight * 0.5f + 0.5f);
+	if (this->insetX < 0)
+		this->insetX = 0;
+	if (this->insetY < 0)
+		this->insetY = 0;
+	if (this->insetX + this->insetWidth > this->eyeWidth)
+		this->insetX = this->eyeWidth - this->insetWidth;
+	if (this->insetY + this->insetHeight > this->eyeHeight)
+		this->insetY = this->eyeHeight - this->insetHeight;
+}
+
+void Foveation::beginPeriphery(const glm::mat4& projection)
+{
+	placeInset(projection);
+
+	this->periphery.bind(this->peripheryTexture);
+	glViewport(0, 0, this->peripheryWidth, this->peripheryHeight);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	// a pixel short of the inset on every side, so the upscaled edge never shows a gap
+	float scale = levels[this->currentLevel].peripheryScale;
+	GLint x0 = (GLint)(this->insetX * scale) + 1;
+	GLint y0 = (GLint)(this->insetY * scale) + 1;
+	GLint x1 = (GLint)((this->insetX + this->insetWidth) * scale) - 1;
+	GLint y1 = (GLint)((this->insetY + this->insetHeight) * scale) - 1;
+	if (x1 > x0 && y1 > y0)
+	{
+		glEnable(GL_SCISSOR_TEST);
+		glScissor(x0, y0, x1 - x0, y1 - y0);
+		glClearDepth(0.0);
+		glClear(GL_DEPTH_BUFFER_BIT);
+		glClearDepth(1.0);
+		glDisable(GL_SCISSOR_TEST);
+	}
+}
+
+glm::mat4 Foveation::beginInset(const glm::mat4& projection)
+{
+	this->periphery.resolve();
+
+	this->inset.bind(this->insetTexture);
+	glViewport(0, 0, this->insetWidth, this->insetHeight);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	// Scale and shift clip space so the inset's rectangle of normalized device coordinates fills the layer
+	float x0 = 2.0f * this->insetX / this->eyeWidth - 1.0f;
+	float x1 = 2.0f * (this->insetX + this->insetWidth) / this->eyeWidth - 1.0f;
+	float y0 = 2.0f * this->insetY / this->eyeHeight - 1.0f;
+	float y1 = 2.0f * (this->insetY + this->insetHeight) / this->eyeHeight - 1.0f;
+	glm::mat4 crop = glm::scale(glm::mat4(1.0f), glm::vec3(2.0f / (x1 - x0), 2.0f / (y1 - y0), 1.0f))
+		* glm::translate(glm::mat4(1.0f), glm::vec3(-(x0 + x1) * 0.5f, -(y0 + y1) * 0.5f, 0.0f));
+	return crop * projection;
+}
+
+void Foveation::composite(GLuint output, GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	this->inset.resolve();
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->drawFbo);
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, output, 0);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, this->readFbo);
+
+	glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->peripheryTexture, 0);
+	glBlitFramebuffer(0, 0, this->peripheryWidth, this->peripheryHeight,
+		x, y, x + width, y + height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+
+	// the viewport may be smaller than the eye the layers were made for, place the inset proportionally
+	GLint ix0 = x + this->insetX * width / this->eyeWidth;
+	GLint iy0 = y + this->insetY * height / this->eyeHeight;
+	GLint ix1 = x + (this->insetX + this->insetWidth) * width / this->eyeWidth;
+	GLint iy1 = y + (this->insetY + this->insetHeight) * height / this->eyeHeight;
+	glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->insetTexture, 0);
+	glBlitFramebuffer(0, 0, this->insetWidth, this->insetHeight, ix0, iy0, ix1, iy1, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+
+	glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+}
@@ -0,0 +1,62 @@
+#ifndef FOVEATION_H_
+#define FOVEATION_H_
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "EyeTarget.h"
+
+struct FoveationLevel
+{
+	const char* name;
+	float insetSize;		// fraction of the eye's width and height drawn at full density
+	float peripheryScale;	// resolution of the whole field of view behind the inset, relative to full density
+};
+
+#define FOVEATION_LEVELS 4
+
+// Fixed foveated rendering. Each eye is drawn twice: once over its whole field of view
+// at reduced resolution, then once more through a narrower projection covering only the
+// center of the lens at full density. composite() stretches the periphery over the eye's
+// viewport and lays the inset over it. Both eyes go through the same pair of targets.
+class Foveation
+{
+public:
+	// level 0 is off, the rest trade periphery detail for fill rate
+	static const FoveationLevel levels[FOVEATION_LEVELS];
+
+	Foveation();
+
+	// (Re)creates the layer targets for eyes of the given full density size
+	void create(GLsizei eyeWidth, GLsizei eyeHeight, GLsizei samples, GLenum depthFormat, int level);
+	int level() const { return this->currentLevel; }
+	bool enabled() const { return this->currentLevel > 0; }
+
+	// Binds and clears the periphery layer for an eye drawn with projection. The part the
+	// inset will cover is filled with the nearest depth, so nothing gets shaded under it.
+	void beginPeriphery(const glm::mat4& projection);
+	// Resolves the periphery and binds the inset layer, returns the projection to draw it with
+	glm::mat4 beginInset(const glm::mat4& projection);
+	// Resolves the inset and writes the eye into the given viewport of output
+	void composite(GLuint output, GLint x, GLint y, GLsizei width, GLsizei height);
+
+	// pixel rows spanned by the projection of each layer
+	float peripheryRows() const { return (float)this->peripheryHeight; }
+	float insetRows() const { return (float)this->insetHeight; }
+
+private:
+	EyeTarget periphery, inset;
+	GLuint peripheryTexture, insetTexture;
+	GLuint readFbo, drawFbo;
+	GLsizei eyeWidth, eyeHeight;
+	GLsizei peripheryWidth, peripheryHeight;
+	GLsizei insetWidth, insetHeight;
+	// lower left corner of the inset in full density pixels of the current eye
+	GLint insetX, insetY;
+	int currentLevel;
+
+	void placeInset(const glm::mat4& projection);
+	GLuint createLayerTexture(GLsizei width, GLsizei height);
+};
+
+#endif
@@ -0,0 +1,58 @@
+#include "Frustum.h"
+
+Frustum::Frustum()
+{
+	for (int i = 0; i < PlaneCount; i++)
+		planes[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+Frustum::Frustum(const glm::mat4& m)
+{
+	// glm is column major, so row i of the matrix is (m[0][i], m[1][i], m[2][i], m[3][i])
+	glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+	glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+	glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+	glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+	planes[Left] = row3 + row0;
+	planes[Right] = row3 - row0;
+	planes[Bottom] = row3 + row1;
+	planes[Top] = row3 - row1;
+	planes[Near] = row3 + row2;
+	planes[Far] = row3 - row2;
+
+	for (int i = 0; i < PlaneCount; i++)
+		planes[i] /= glm::length(glm::vec3(planes[i]));
+}
+
+Frustum Frustum::stereo(const glm::mat4& leftViewProjection, const glm::mat4& rightViewProjection)
+{
+	Frustum combined(leftViewProjection);
+	Frustum right(rightViewProjection);
+	combined.planes[Right] = right.planes[Right];
+	return combined;
+}
+
+bool Frustum::containsSphere(const glm::vec3& center, float radius) const
+{
+	for (int i = 0; i < PlaneCount; i++)
+	{
+		if (glm::dot(planes[i], glm::vec4(center, 1.0f)) < -radius)
+			return false;
+	}
+	return true;
+}
+
+bool Frustum::containsBox(const glm::vec3& boxMin, const glm::vec3& boxMax) const
+{
+	for (int i = 0; i < PlaneCount; i++)
+	{
+		// test the corner farthest along the plane normal
+		glm::vec3 corner(planes[i].x >= 0.0f ? boxMax.x : boxMin.x,
+			planes[i].y >= 0.0f ? boxMax.y : boxMin.y,
+			planes[i].z >= 0.0f ? boxMax.z : boxMin.z);
+		if (glm::dot(planes[i], glm::vec4(corner, 1.0f)) < 0.0f)
+			return false;
+	}
+	return true;
+}
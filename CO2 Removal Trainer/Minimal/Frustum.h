@@ -0,0 +1,28 @@
+#ifndef FRUSTUM_H_
+#define FRUSTUM_H_
+
+#include <glm/glm.hpp>
+
+// Six clip planes of a view frustum in world space. A point p is inside a plane
+// when dot(plane, vec4(p, 1)) >= 0. Planes are normalized so the dot product is a distance.
+class Frustum
+{
+public:
+	enum { Left = 0, Right, Bottom, Top, Near, Far, PlaneCount };
+
+	glm::vec4 planes[PlaneCount];
+
+	Frustum();
+	// Extracts the planes of projection * view (Gribb & Hartmann)
+	Frustum(const glm::mat4& viewProjection);
+
+	// Single frustum around both eyes, used to cull once per frame instead of once per eye.
+	// The eyes share orientation and vertical FOV, so their top, bottom, near and far planes
+	// coincide and only the outer side planes differ.
+	static Frustum stereo(const glm::mat4& leftViewProjection, const glm::mat4& rightViewProjection);
+
+	bool containsSphere(const glm::vec3& center, float radius) const;
+	bool containsBox(const glm::vec3& boxMin, const glm::vec3& boxMax) const;
+};
+
+#endif
@@ -0,0 +1,54 @@
+#include "GpuTimer.h"
+
+GpuTimer::GpuTimer() : slot(0), count(0), sum(0.0), latest(-1.0)
+{
+	for (int i = 0; i < GPU_TIMER_FRAMES; i++)
+	{
+		this->queries[i] = 0;
+		this->issued[i] = false;
+	}
+}
+
+void GpuTimer::begin()
+{
+	if (this->queries[0] == 0)
+		glGenQueries(GPU_TIMER_FRAMES, this->queries);
+
+	this->slot = (this->slot + 1) % GPU_TIMER_FRAMES;
+	if (this->issued[this->slot])
+	{
+		this->issued[this->slot] = false;
+		// a query that still hasn't finished after this long is dropped rather than waited on
+		GLint available = 0;
+		glGetQueryObjectiv(this->queries[this->slot], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available)
+		{
+			GLuint64 elapsed = 0;
+			glGetQueryObjectui64v(this->queries[this->slot], GL_QUERY_RESULT, &elapsed);
+			this->latest = (double)elapsed / 1.0e6;
+			this->sum += this->latest;
+			this->count++;
+		}
+	}
+	glBeginQuery(GL_TIME_ELAPSED, this->queries[this->slot]);
+}
+
+void GpuTimer::end()
+{
+	glEndQuery(GL_TIME_ELAPSED);
+	this->issued[this->slot] = true;
+}
+
+double GpuTimer::average() const
+{
+	return this->count ? this->sum / this->count : 0.0;
+}
+
+void GpuTimer::reset()
+{
+	for (int i = 0; i < GPU_TIMER_FRAMES; i++)
+		this->issued[i] = false;
+	this->count = 0;
+	this->sum = 0.0;
+	this->latest = -1.0;
+}
@@ -0,0 +1,35 @@
+#ifndef GPUTIMER_H_
+#define GPUTIMER_H_
+
+#include <GL/glew.h>
+
+// Frames a query stays in flight before it is read, so reading it never stalls
+#define GPU_TIMER_FRAMES 4
+
+// GL_TIME_ELAPSED query around a span of GL commands that is repeated every frame.
+// GL allows only one time query at a time, so timers must not overlap.
+class GpuTimer
+{
+public:
+	GpuTimer();
+
+	void begin();
+	void end();
+
+	// ms of the most recent result that came back, -1 before the first one
+	double last() const { return this->latest; }
+	// average ms over the results read back since the last reset
+	double average() const;
+	unsigned int samples() const { return this->count; }
+	// forgets the collected results and drops the queries still in flight
+	void reset();
+
+private:
+	GLuint queries[GPU_TIMER_FRAMES];
+	bool issued[GPU_TIMER_FRAMES];
+	unsigned int slot;
+	unsigned int count;
+	double sum, latest;
+};
+
+#endif
@@ -1,5 +1,7 @@
 
 #include "Mesh.h"
+#include "RenderStats.h"
+#include "RenderQueue.h"
 
 Mesh::Mesh(vector<Vertex> vertices, vector<GLuint> indices, vector<Texture> textures)
 {
@@ -37,8 +39,11 @@ Mesh::Mesh(vector<Vertex> vertices, vector<GLuint> indices, vector<Texture> text
 }
 
 // Render the mesh
-void Mesh::Draw(GLuint shaderID)
+void Mesh::Draw(GLuint shaderID, GLuint lod)
 {
+	if (lod >= this->lodCounts.size())
+		lod = this->lodCounts.size() - 1;
+
 	// Bind appropriate textures
 	GLuint diffuseNr = 1;
 	GLuint specularNr = 1;
@@ -49,10 +54,24 @@ void Mesh::Draw(GLuint shaderID)
 	GLint matSpecularLoc = glGetUniformLocation(shaderID, "material.specular");
 	GLint matShineLoc = glGetUniformLocation(shaderID, "material.shininess");
 
-	glUniform3f(matAmbientLoc,material.ambient.x, material.ambient.y, material.ambient.z);
-	glUniform3f(matDiffuseLoc, material.diffuse.x, material.diffuse.y, material.diffuse.z);
-	glUniform3f(matSpecularLoc, material.specular.x, material.specular.y, material.specular.z);
-	glUniform1f(matShineLoc, material.shininess);
+	// shader variants that don't read a field have no location for it
+	if (matAmbientLoc != -1) {
+		glUniform3f(matAmbientLoc, material.ambient.x, material.ambient.y, material.ambient.z);
+		RenderStats::frame.uniformUploads++;
+	}
+	if (matDiffuseLoc != -1) {
+		glUniform3f(matDiffuseLoc, material.diffuse.x, material.diffuse.y, material.diffuse.z);
+		RenderStats::frame.uniformUploads++;
+	}
+	if (matSpecularLoc != -1) {
+		glUniform3f(matSpecularLoc, material.specular.x, material.specular.y, material.specular.z);
+		RenderStats::frame.uniformUploads++;
+	}
+	if (matShineLoc != -1) {
+		glUniform1f(matShineLoc, material.shininess);
+		RenderStats::frame.uniformUploads++;
+	}
+	RenderStats::frame.uniformLookups += 4;
 
 	for (GLuint i = 0; i < this->textures.size(); i++)
 	{
@@ -66,10 +85,16 @@ void Mesh::Draw(GLuint shaderID)
 		else if (name == "texture_specular")
 			ss << specularNr++; // Transfer GLuint to stream
 		number = ss.str();
-		// Now set the sampler to the correct texture unit
-		glUniform1i(glGetUniformLocation(shaderID, (name + number).c_str()), i);
+		// Now set the sampler to the correct texture unit, variants that don't sample it skip the texture
+		GLint samplerLoc = glGetUniformLocation(shaderID, (name + number).c_str());
+		RenderStats::frame.uniformLookups++;
+		if (samplerLoc == -1)
+			continue;
+		glUniform1i(samplerLoc, i);
 		// And finally bind the texture
 		glBindTexture(GL_TEXTURE_2D, this->textures[i].id);
+		RenderStats::frame.uniformUploads++;
+		RenderStats::frame.textureBinds++;
 	}
 
 	// Also set each mesh's shininess property to a default value (if you want you could extend this to another mesh property and possibly change this value)
@@ -77,17 +102,39 @@ void Mesh::Draw(GLuint shaderID)
 
 	// Draw mesh
 	glBindVertexArray(this->VAO);
-	glDrawElements(GL_TRIANGLES, this->indices.size(), GL_UNSIGNED_INT, 0);
+	glDrawElements(GL_TRIANGLES, this->lodCounts[lod], GL_UNSIGNED_INT, (GLvoid*)(size_t)this->lodOffsets[lod]);
 	glBindVertexArray(0);
+	RenderStats::frame.drawCalls++;
+	RenderStats::frame.triangles += this->lodCounts[lod] / 3;
+	RenderStats::frame.vaoBinds += 2;
 
 	// Always good practice to set everything back to defaults once configured.
 	for (GLuint i = 0; i < this->textures.size(); i++)
 	{
 		glActiveTexture(GL_TEXTURE0 + i);
 		glBindTexture(GL_TEXTURE_2D, 0);
+		RenderStats::frame.textureBinds++;
 	}
 }
 
+void Mesh::Submit(RenderQueue& queue, GLuint shaderID, const glm::mat4& model, const glm::mat3& normalMatrix, GLuint lod)
+{
+	if (lod >= this->lodCounts.size())
+		lod = this->lodCounts.size() - 1;
+
+	DrawItem& item = queue.submit(shaderID, this->VAO, GL_TRIANGLES, this->lodOffsets[lod], this->lodCounts[lod], true, model);
+	item.material = &this->material;
+	queue.setNormalMatrix(item, normalMatrix);
+	// the shaders only sample the first diffuse map
+	for (GLuint i = 0; i < this->textures.size(); i++)
+	{
+		if (this->textures[i].type == "texture_diffuse")
+		{
+			queue.setTexture(item, GL_TEXTURE_2D, this->textures[i].id, "texture_diffuse1");
+			break;
+		}
+	}
+}
 
 void Mesh::setupMesh()
 {
@@ -119,4 +166,43 @@ void Mesh::setupMesh()
 		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, TexCoords));
 
 		glBindVertexArray(0);
+
+		this->lodOffsets.assign(1, 0);
+		this->lodCounts.assign(1, this->indices.size());
+}
+
+void Mesh::setLods(const vector<vector<GLuint> >& levels)
+{
+	this->lodIndices = levels;
+
+	// Level 0 stays at the front of the buffer, the simplified levels are appended after it
+	vector<GLuint> combined = this->indices;
+	this->lodOffsets.assign(1, 0);
+	this->lodCounts.assign(1, this->indices.size());
+	for (GLuint i = 0; i < levels.size(); i++)
+	{
+		this->lodOffsets.push_back(combined.size() * sizeof(GLuint));
+		this->lodCounts.push_back(levels[i].size());
+		combined.insert(combined.end(), levels[i].begin(), levels[i].end());
+	}
+
+	// The element buffer binding is VAO state, so bind the VAO before replacing its contents
+	glBindVertexArray(this->VAO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, combined.size() * sizeof(GLuint), &combined[0], GL_STATIC_DRAW);
+	glBindVertexArray(0);
+}
+
+GLuint Mesh::lodCount() const
+{
+	return this->lodCounts.size();
+}
+
+const vector<GLuint>& Mesh::lodIndexList(GLuint lod) const
+{
+	if (lod == 0 || this->lodIndices.empty())
+		return this->indices;
+	if (lod > this->lodIndices.size())
+		lod = this->lodIndices.size();
+	return this->lodIndices[lod - 1];
 }
\ No newline at end of file
@@ -13,6 +13,8 @@ using namespace std;
 #include <assimp/scene.h>
 
 
+class RenderQueue;
+
 struct Vertex {
 	glm::vec3 Position;
 	glm::vec3 Normal;
@@ -47,11 +49,20 @@ public:
 	vector<GLuint> indices;
 	vector<Texture> textures;
 	Material material;
+	// index lists of the simplified levels of detail, level 0 is 'indices' itself
+	vector<vector<GLuint> > lodIndices;
 	/*  Functions  */
-	void Draw(GLuint shaderId);
+	void Draw(GLuint shaderId, GLuint lod = 0);
+	// Records the draw in a render queue instead of issuing it, normalMatrix is computed once per instance by the caller
+	void Submit(RenderQueue& queue, GLuint shaderId, const glm::mat4& model, const glm::mat3& normalMatrix, GLuint lod = 0);
+	// Stores the simplified index lists and uploads them behind the full-detail indices in the element buffer
+	void setLods(const vector<vector<GLuint> >& levels);
+	GLuint lodCount() const;
+	const vector<GLuint>& lodIndexList(GLuint lod) const;
 private:
 	/*  Render data  */
 	GLuint VAO, VBO, EBO;
+	vector<GLsizei> lodOffsets, lodCounts; // byte offset and index count of every level in the EBO
 	/*  Functions    */
 	void setupMesh();
 };
\ No newline at end of file
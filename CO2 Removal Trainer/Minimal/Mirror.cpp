@@ -0,0 +1,172 @@
+#include "Mirror.h"
+
+Mirror::Mirror()
+	: desktopWindow(NULL), running(false), ready(-1), presenting(-1), windowWidth(0), windowHeight(0),
+	framesPerCopy(1), downscaleFactor(1), readFbo(0), drawFbo(0)
+{
+	for (int i = 0; i < MIRROR_BUFFERS; i++)
+	{
+		this->buffers[i].texture = 0;
+		this->buffers[i].width = this->buffers[i].height = 0;
+		this->buffers[i].fence = 0;
+	}
+}
+
+Mirror::~Mirror()
+{
+	stop();
+}
+
+GLFWwindow* Mirror::start(GLFWwindow* renderWindow, int width, int height, const char* title)
+{
+	glfwWindowHint(GLFW_VISIBLE, GL_TRUE);
+	this->desktopWindow = glfwCreateWindow(width, height, title, NULL, renderWindow);
+	if (this->desktopWindow == NULL)
+		return NULL;
+
+	glGenFramebuffers(1, &this->readFbo);
+	glGenFramebuffers(1, &this->drawFbo);
+	for (int i = 0; i < MIRROR_BUFFERS; i++)
+		glGenTextures(1, &this->buffers[i].texture);
+	glfwGetFramebufferSize(this->desktopWindow, &this->windowWidth, &this->windowHeight);
+
+	// the render thread keeps its own context current, the window's context belongs to the mirror thread from here on
+	this->running = true;
+	this->thread = std::thread(&Mirror::present, this);
+	return this->desktopWindow;
+}
+
+void Mirror::stop()
+{
+	if (!this->running)
+		return;
+	{
+		std::lock_guard<std::mutex> guard(this->lock);
+		this->running = false;
+	}
+	this->wake.notify_one();
+	this->thread.join();
+
+	// the thread is gone, so everything left is the render context's own, which is current here
+	for (int i = 0; i < MIRROR_BUFFERS; i++)
+	{
+		if (this->buffers[i].fence)
+			glDeleteSync(this->buffers[i].fence);
+		glDeleteTextures(1, &this->buffers[i].texture);
+		this->buffers[i].texture = 0;
+		this->buffers[i].width = this->buffers[i].height = 0;
+		this->buffers[i].fence = 0;
+	}
+	glDeleteFramebuffers(1, &this->readFbo);
+	glDeleteFramebuffers(1, &this->drawFbo);
+	this->readFbo = this->drawFbo = 0;
+	this->ready = this->presenting = -1;
+
+	glfwDestroyWindow(this->desktopWindow);
+	this->desktopWindow = NULL;
+}
+
+void Mirror::capture(GLuint source, int width, int height, unsigned int frame)
+{
+	if (!this->running || this->framesPerCopy <= 0 || frame % this->framesPerCopy != 0)
+		return;
+
+	// any buffer that is neither waiting to be presented nor being presented is free to overwrite
+	int target = -1;
+	{
+		std::lock_guard<std::mutex> guard(this->lock);
+		// GLFW only answers this on the main thread, so it is read here for the mirror thread
+		glfwGetFramebufferSize(this->desktopWindow, &this->windowWidth, &this->windowHeight);
+		for (int i = 0; i < MIRROR_BUFFERS && target < 0; i++)
+		{
+			if (i != this->ready && i != this->presenting)
+				target = i;
+		}
+	}
+
+	Buffer& buffer = this->buffers[target];
+	int copyWidth = width / this->downscaleFactor;
+	int copyHeight = height / this->downscaleFactor;
+	if (buffer.width != copyWidth || buffer.height != copyHeight)
+	{
+		glBindTexture(GL_TEXTURE_2D, buffer.texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8_ALPHA8, copyWidth, copyHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		buffer.width = copyWidth;
+		buffer.height = copyHeight;
+	}
+
+	// flip while copying, the compositor's mirror texture has its top row first
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, this->readFbo);
+	glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, source, 0);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->drawFbo);
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, buffer.texture, 0);
+	glBlitFramebuffer(0, 0, width, height, 0, copyHeight, copyWidth, 0, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+	glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+	GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	// the other context can only wait on a fence that has reached the GPU
+	glFlush();
+
+	{
+		std::lock_guard<std::mutex> guard(this->lock);
+		// a copy the mirror thread never got to is simply replaced
+		if (this->ready >= 0 && this->buffers[this->ready].fence)
+		{
+			glDeleteSync(this->buffers[this->ready].fence);
+			this->buffers[this->ready].fence = 0;
+		}
+		buffer.fence = fence;
+		this->ready = target;
+	}
+	this->wake.notify_one();
+}
+
+void Mirror::present()
+{
+	glfwMakeContextCurrent(this->desktopWindow);
+	// v-sync here only ever stalls this thread
+	glfwSwapInterval(1);
+	GLuint presentFbo;
+	glGenFramebuffers(1, &presentFbo);
+
+	std::unique_lock<std::mutex> guard(this->lock);
+	while (true)
+	{
+		this->wake.wait(guard, [this] { return !this->running || this->ready >= 0; });
+		if (!this->running)
+			break;
+
+		int index = this->ready;
+		Buffer& buffer = this->buffers[index];
+		GLsync fence = buffer.fence;
+		buffer.fence = 0;
+		this->ready = -1;
+		this->presenting = index;
+		int windowWidth = this->windowWidth;
+		int windowHeight = this->windowHeight;
+		guard.unlock();
+
+		glWaitSync(fence, 0, GL_TIMEOUT_IGNORED);
+		glDeleteSync(fence);
+
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, presentFbo);
+		glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, buffer.texture, 0);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+		glBlitFramebuffer(0, 0, buffer.width, buffer.height, 0, 0, windowWidth, windowHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+		glfwSwapBuffers(this->desktopWindow);
+
+		guard.lock();
+		this->presenting = -1;
+	}
+	guard.unlock();
+
+	glDeleteFramebuffers(1, &presentFbo);
+	glfwMakeContextCurrent(NULL);
+}
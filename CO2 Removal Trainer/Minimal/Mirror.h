@@ -0,0 +1,71 @@
+#ifndef MIRROR_H_
+#define MIRROR_H_
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+// Copies in flight between the render thread and the mirror thread: one being presented,
+// one ready, one being written
+#define MIRROR_BUFFERS 3
+
+// Desktop mirror of the headset view, presented from its own thread and GL context so the
+// desktop swap never blocks the HMD frame. The render thread copies the compositor's mirror
+// texture into one of three shared textures and fences it; the mirror thread waits on the
+// fence, draws the newest copy into its window and swaps with v-sync.
+class Mirror
+{
+public:
+	Mirror();
+	~Mirror();
+
+	// Opens the desktop window sharing objects with renderWindow's context and starts the
+	// mirror thread. Called on the main thread with renderWindow's context current.
+	GLFWwindow* start(GLFWwindow* renderWindow, int width, int height, const char* title);
+	// Stops the thread, deletes the copies and fences still pending and closes the window.
+	// Called with the render window's context current.
+	void stop();
+
+	// Copies source, stored top row first, every rate-th frame. Called on the render thread after ovr_SubmitFrame.
+	void capture(GLuint source, int width, int height, unsigned int frame);
+
+	// frames between copies, 0 stops mirroring and leaves the last image up
+	void setRate(int framesPerCopy) { this->framesPerCopy = framesPerCopy; }
+	int rate() const { return this->framesPerCopy; }
+	// the copy is made at 1/factor of the mirror texture size and stretched back up by the mirror thread
+	void setDownscale(int factor) { this->downscaleFactor = factor < 1 ? 1 : factor; }
+	int downscale() const { return this->downscaleFactor; }
+
+	GLFWwindow* window() const { return this->desktopWindow; }
+
+private:
+	struct Buffer
+	{
+		GLuint texture;
+		int width, height;
+		GLsync fence;		// set by the render thread once the copy is queued
+	};
+
+	GLFWwindow* desktopWindow;
+	std::thread thread;
+	std::mutex lock;
+	std::condition_variable wake;
+	bool running;
+
+	Buffer buffers[MIRROR_BUFFERS];
+	int ready;			// newest finished copy, -1 when the mirror thread has taken it
+	int presenting;		// copy the mirror thread is drawing, -1 while idle
+	int windowWidth, windowHeight;
+
+	int framesPerCopy;
+	int downscaleFactor;
+	// framebuffers aren't shared between contexts, so each thread has its own
+	GLuint readFbo, drawFbo;
+
+	void present();
+};
+
+#endif
@@ -1,24 +1,436 @@
 #include "Model.h"
+#include "RenderStats.h"
+#include "Simplify.h"
+#include "RenderQueue.h"
+
+#include <fstream>
+#include <cfloat>
+#include <cstring>
+#include <sys/stat.h>
+#include <glm/gtc/matrix_inverse.hpp>
+
+const float Model::lodRatios[MAX_LODS] = { 1.0f, 0.5f, 0.25f, 0.1f };
+const float Model::lodThresholds[MAX_LODS] = { FLT_MAX, 250.0f, 100.0f, 40.0f };
+
+// How far past a threshold the projected size has to move before the level changes
+static const float LOD_HYSTERESIS = 0.15f;
+
+// Two meshes can share a batch when their material colors and texture files match
+static bool sameMaterial(const Mesh& a, const Mesh& b)
+{
+	if (a.material.ambient != b.material.ambient || a.material.diffuse != b.material.diffuse ||
+		a.material.specular != b.material.specular || a.material.shininess != b.material.shininess)
+		return false;
+	if (a.textures.size() != b.textures.size())
+		return false;
+	for (GLuint i = 0; i < a.textures.size(); i++)
+	{
+		if (a.textures[i].type != b.textures[i].type || std::strcmp(a.textures[i].path.C_Str(), b.textures[i].path.C_Str()) != 0)
+			return false;
+	}
+	return true;
+}
 
 Model::Model(GLchar* path)
 {
+	useBatches = false;
+	boundingRadius = 0.0f;
+	boundsMin = glm::vec3(FLT_MAX);
+	boundsMax = glm::vec3(-FLT_MAX);
+	lodCount = 1;
+	batchVAO = batchVBO = batchEBO = 0;
+	forgetProgram();
 	std::cout << "Loading " << path << std::endl;
 	this->loadModel(path);
 }
 
 // Draws the model, and thus all its meshes
-void Model::Draw(GLuint shaderProgram)
+void Model::Draw(GLuint shaderProgram, GLuint lod)
 {
-	//uProjection = glGetUniformLocation(shaderProgram, "projection");
-	uModel = glGetUniformLocation(shaderProgram, "model");
-	//uView = glGetUniformLocation(shaderProgram, "view");
+	this->cacheLocations(shaderProgram);
 	// Now send these values to the shader program
 	//glUniformMatrix4fv(uProjection, 1, GL_FALSE, &Window::P[0][0]);
-	glUniformMatrix4fv(uModel, 1, GL_FALSE, &toWorld[0][0]);
+	glUniformMatrix4fv(this->modelLoc, 1, GL_FALSE, &toWorld[0][0]);
 	//glUniformMatrix4fv(uView, 1, GL_FALSE, &Window::V[0][0]);
+	RenderStats::frame.uniformUploads++;
+
+	// once per instance here instead of once per vertex in the shader
+	if (this->normalMatrixLoc != -1)
+	{
+		glm::mat3 normalMatrix = glm::inverseTranspose(glm::mat3(toWorld));
+		glUniformMatrix3fv(this->normalMatrixLoc, 1, GL_FALSE, &normalMatrix[0][0]);
+		RenderStats::frame.uniformUploads++;
+	}
+
+	if (this->useBatches && !this->batches.empty())
+	{
+		this->drawBatches(shaderProgram, lod);
+		return;
+	}
+
+	for (GLuint i = 0; i < this->meshes.size(); i++)
+		this->meshes[i].Draw(shaderProgram, lod);
+}
+
+void Model::Submit(RenderQueue& queue, GLuint shaderProgram, const glm::mat4& world, GLuint lod)
+{
+	// shared by every item of this instance
+	glm::mat3 normalMatrix = glm::inverseTranspose(glm::mat3(world));
+	if (this->useBatches && !this->batches.empty())
+	{
+		if (lod >= this->lodCount)
+			lod = this->lodCount - 1;
+		for (GLuint i = 0; i < this->batches.size(); i++)
+		{
+			const MeshBatch& batch = this->batches[i];
+			DrawItem& item = queue.submit(shaderProgram, this->batchVAO, GL_TRIANGLES, batch.lodOffsets[lod], batch.lodCounts[lod], true, world);
+			item.material = &batch.material;
+			queue.setNormalMatrix(item, normalMatrix);
+			for (GLuint t = 0; t < batch.textures.size(); t++)
+			{
+				if (batch.textures[t].type == "texture_diffuse")
+				{
+					queue.setTexture(item, GL_TEXTURE_2D, batch.textures[t].id, "texture_diffuse1");
+					break;
+				}
+			}
+		}
+		return;
+	}
+
+	for (GLuint i = 0; i < this->meshes.size(); i++)
+		this->meshes[i].Submit(queue, shaderProgram, world, normalMatrix, lod);
+}
+
+void Model::generateLods()
+{
+	string cacheFile = this->path + ".lod";
+	if (!this->loadLodCache(cacheFile))
+	{
+		std::cout << "Simplifying " << this->path << std::endl;
+		for (GLuint i = 0; i < this->meshes.size(); i++)
+		{
+			vector<vector<GLuint> > levels;
+			for (GLuint l = 1; l < MAX_LODS; l++)
+				levels.push_back(simplifyMesh(this->meshes[i].vertices, this->meshes[i].indices, lodRatios[l]));
+			this->meshes[i].setLods(levels);
+		}
+		this->saveLodCache(cacheFile);
+	}
+	this->lodCount = MAX_LODS;
+}
+
+// What a .lod file was made from: the size and modification time of the model file, and the
+// ratios it was simplified to. A cache whose key differs is regenerated.
+struct LodCacheKey
+{
+	long long sourceSize;
+	long long sourceTime;
+	float ratios[MAX_LODS];
+};
+
+static bool lodCacheKey(const string& source, LodCacheKey& key)
+{
+	struct _stat64 info;
+	if (_stat64(source.c_str(), &info) != 0)
+		return false;
+	memset(&key, 0, sizeof(key));
+	key.sourceSize = info.st_size;
+	key.sourceTime = info.st_mtime;
+	for (int l = 0; l < MAX_LODS; l++)
+		key.ratios[l] = Model::lodRatios[l];
+	return true;
+}
+
+// Cache layout: LodCacheKey, mesh count, then per mesh the level count followed by each level's
+// index count and indices
+bool Model::loadLodCache(const string& file)
+{
+	LodCacheKey expected, stored;
+	if (!lodCacheKey(this->path, expected))
+		return false;
+	std::ifstream in(file.c_str(), std::ios::in | std::ios::binary);
+	if (!in.is_open())
+		return false;
+	in.read((char*)&stored, sizeof(stored));
+	if (!in || memcmp(&stored, &expected, sizeof(stored)) != 0)
+	{
+		std::cout << file << " is from another version of the model" << std::endl;
+		return false;
+	}
+
+	GLuint meshCount = 0;
+	in.read((char*)&meshCount, sizeof(GLuint));
+	if (!in || meshCount != this->meshes.size())
+		return false;
+
+	vector<vector<vector<GLuint> > > allLevels(meshCount);
+	for (GLuint i = 0; i < meshCount; i++)
+	{
+		GLuint levelCount = 0;
+		in.read((char*)&levelCount, sizeof(GLuint));
+		if (!in || levelCount != MAX_LODS - 1)
+			return false;
+		allLevels[i].resize(levelCount);
+		for (GLuint l = 0; l < levelCount; l++)
+		{
+			GLuint count = 0;
+			in.read((char*)&count, sizeof(GLuint));
+			if (!in || count > this->meshes[i].indices.size())
+				return false;
+			allLevels[i][l].resize(count);
+			if (count > 0)
+				in.read((char*)&allLevels[i][l][0], count * sizeof(GLuint));
+			if (!in)
+				return false;
+			// a stale cache from an edited model would index past the vertex array
+			for (GLuint k = 0; k < count; k++)
+			{
+				if (allLevels[i][l][k] >= this->meshes[i].vertices.size())
+					return false;
+			}
+		}
+	}
+
+	for (GLuint i = 0; i < meshCount; i++)
+		this->meshes[i].setLods(allLevels[i]);
+	std::cout << "Loaded levels of detail from " << file << std::endl;
+	return true;
+}
+
+void Model::saveLodCache(const string& file)
+{
+	LodCacheKey key;
+	if (!lodCacheKey(this->path, key))
+		return;
+	std::ofstream out(file.c_str(), std::ios::out | std::ios::binary);
+	if (!out.is_open())
+	{
+		std::cout << "Unable to write " << file << std::endl;
+		return;
+	}
+
+	out.write((const char*)&key, sizeof(key));
+	GLuint meshCount = this->meshes.size();
+	out.write((const char*)&meshCount, sizeof(GLuint));
+	for (GLuint i = 0; i < meshCount; i++)
+	{
+		GLuint levelCount = this->meshes[i].lodIndices.size();
+		out.write((const char*)&levelCount, sizeof(GLuint));
+		for (GLuint l = 0; l < levelCount; l++)
+		{
+			const vector<GLuint>& level = this->meshes[i].lodIndices[l];
+			GLuint count = level.size();
+			out.write((const char*)&count, sizeof(GLuint));
+			if (count > 0)
+				out.write((const char*)&level[0], count * sizeof(GLuint));
+		}
+	}
+}
+
+float Model::projectedSize(const glm::mat4& projection, const glm::mat4& view, const glm::mat4& world, float viewportHeight) const
+{
+	// the largest axis scale of the world matrix scales the bounding sphere
+	float scale = glm::max(glm::length(glm::vec3(world[0])), glm::max(glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2]))));
+	float radius = this->boundingRadius * scale;
+	glm::vec4 center = view * world * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	float distance = glm::length(glm::vec3(center));
+	if (distance <= radius)
+		return FLT_MAX;
+
+	// projection[1][1] is cot(fovY / 2), which maps a unit at distance 1 to half the viewport
+	return radius / distance * projection[1][1] * viewportHeight;
+}
+
+bool Model::isVisible(const Frustum& frustum, const glm::mat4& world) const
+{
+	if (this->boundsMin.x > this->boundsMax.x)
+		return false; // nothing loaded
+
+	float scale = glm::max(glm::length(glm::vec3(world[0])), glm::max(glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2]))));
+	glm::vec3 origin(world[3]);
+	if (!frustum.containsSphere(origin, this->boundingRadius * scale))
+		return false;
 
+	// world space box around the eight transformed corners
+	glm::vec3 worldMin(FLT_MAX), worldMax(-FLT_MAX);
+	for (int i = 0; i < 8; i++)
+	{
+		glm::vec3 corner((i & 1) ? this->boundsMax.x : this->boundsMin.x,
+			(i & 2) ? this->boundsMax.y : this->boundsMin.y,
+			(i & 4) ? this->boundsMax.z : this->boundsMin.z);
+		glm::vec3 transformed(world * glm::vec4(corner, 1.0f));
+		worldMin = glm::min(worldMin, transformed);
+		worldMax = glm::max(worldMax, transformed);
+	}
+	return frustum.containsBox(worldMin, worldMax);
+}
+
+GLuint Model::selectLod(float pixelSize, GLuint current) const
+{
+	if (current >= this->lodCount)
+		current = this->lodCount - 1;
+
+	GLuint target = 0;
+	while (target + 1 < this->lodCount && pixelSize < lodThresholds[target + 1])
+		target++;
+
+	if (target > current && pixelSize < lodThresholds[current + 1] * (1.0f - LOD_HYSTERESIS))
+		return target;
+	if (target < current && pixelSize > lodThresholds[current] * (1.0f + LOD_HYSTERESIS))
+		return target;
+	return current;
+}
+
+void Model::buildStaticBatch()
+{
+	vector<Vertex> vertices;
+	vector<GLuint> indices;
+	vector<bool> merged(this->meshes.size(), false);
+	vector<vector<GLuint> > members; // meshes merged into each batch
+	vector<GLuint> base(this->meshes.size()); // where each mesh's vertices start in the merged array
+
+	this->batches.clear();
 	for (GLuint i = 0; i < this->meshes.size(); i++)
-		this->meshes[i].Draw(shaderProgram);
+	{
+		if (merged[i])
+			continue;
+
+		// Start a new batch with this mesh and pull in every later mesh with the same material
+		MeshBatch batch;
+		batch.material = this->meshes[i].material;
+		batch.textures = this->meshes[i].textures;
+		members.push_back(vector<GLuint>());
+		for (GLuint j = i; j < this->meshes.size(); j++)
+		{
+			if (merged[j] || !sameMaterial(this->meshes[i], this->meshes[j]))
+				continue;
+			merged[j] = true;
+			members.back().push_back(j);
+			base[j] = vertices.size();
+			vertices.insert(vertices.end(), this->meshes[j].vertices.begin(), this->meshes[j].vertices.end());
+		}
+		this->batches.push_back(batch);
+	}
+
+	// Every level of every batch is a contiguous run, with indices rebased onto the merged vertex array
+	for (GLuint l = 0; l < this->lodCount; l++)
+	{
+		for (GLuint b = 0; b < this->batches.size(); b++)
+		{
+			GLsizei start = indices.size();
+			for (GLuint m = 0; m < members[b].size(); m++)
+			{
+				GLuint j = members[b][m];
+				const vector<GLuint>& level = this->meshes[j].lodIndexList(l);
+				for (GLuint k = 0; k < level.size(); k++)
+					indices.push_back(base[j] + level[k]);
+			}
+			this->batches[b].lodOffsets.push_back(start * sizeof(GLuint));
+			this->batches[b].lodCounts.push_back(indices.size() - start);
+		}
+	}
+
+	if (vertices.empty())
+		return;
+
+	glGenVertexArrays(1, &this->batchVAO);
+	glGenBuffers(1, &this->batchVBO);
+	glGenBuffers(1, &this->batchEBO);
+
+	glBindVertexArray(this->batchVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, this->batchVBO);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->batchEBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), &indices[0], GL_STATIC_DRAW);
+
+	// Same layout as Mesh::setupMesh
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, Normal));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, TexCoords));
+	glBindVertexArray(0);
+
+	this->useBatches = true;
+	std::cout << "Batched " << this->meshes.size() << " meshes into " << this->batches.size() << " draws" << std::endl;
+}
+
+void Model::cacheLocations(GLuint shaderProgram)
+{
+	if (shaderProgram == this->batchShader)
+		return;
+	this->batchShader = shaderProgram;
+	this->modelLoc = glGetUniformLocation(shaderProgram, "model");
+	this->normalMatrixLoc = glGetUniformLocation(shaderProgram, "normalMatrix");
+	this->matAmbientLoc = glGetUniformLocation(shaderProgram, "material.ambient");
+	this->matDiffuseLoc = glGetUniformLocation(shaderProgram, "material.diffuse");
+	this->matSpecularLoc = glGetUniformLocation(shaderProgram, "material.specular");
+	this->matShineLoc = glGetUniformLocation(shaderProgram, "material.shininess");
+	this->diffuseSamplerLoc = glGetUniformLocation(shaderProgram, "texture_diffuse1");
+	RenderStats::frame.uniformLookups += 7;
+}
+
+void Model::forgetProgram()
+{
+	this->batchShader = 0;
+	this->modelLoc = this->normalMatrixLoc = -1;
+	this->matAmbientLoc = this->matDiffuseLoc = this->matSpecularLoc = this->matShineLoc = this->diffuseSamplerLoc = -1;
+}
+
+void Model::drawBatches(GLuint shaderProgram, GLuint lod)
+{
+	if (lod >= this->lodCount)
+		lod = this->lodCount - 1;
+
+	this->cacheLocations(shaderProgram);
+
+	glBindVertexArray(this->batchVAO);
+	RenderStats::frame.vaoBinds++;
+	for (GLuint i = 0; i < this->batches.size(); i++)
+	{
+		const MeshBatch& batch = this->batches[i];
+		if (matAmbientLoc != -1)
+		{
+			glUniform3f(matAmbientLoc, batch.material.ambient.x, batch.material.ambient.y, batch.material.ambient.z);
+			RenderStats::frame.uniformUploads++;
+		}
+		if (matDiffuseLoc != -1)
+		{
+			glUniform3f(matDiffuseLoc, batch.material.diffuse.x, batch.material.diffuse.y, batch.material.diffuse.z);
+			RenderStats::frame.uniformUploads++;
+		}
+		if (matSpecularLoc != -1)
+		{
+			glUniform3f(matSpecularLoc, batch.material.specular.x, batch.material.specular.y, batch.material.specular.z);
+			RenderStats::frame.uniformUploads++;
+		}
+		if (matShineLoc != -1)
+		{
+			glUniform1f(matShineLoc, batch.material.shininess);
+			RenderStats::frame.uniformUploads++;
+		}
+
+		// the shaders only sample the first diffuse map, and only the textured variants sample it at all
+		for (GLuint t = 0; diffuseSamplerLoc != -1 && t < batch.textures.size(); t++)
+		{
+			if (batch.textures[t].type != "texture_diffuse")
+				continue;
+			glActiveTexture(GL_TEXTURE0);
+			glUniform1i(diffuseSamplerLoc, 0);
+			glBindTexture(GL_TEXTURE_2D, batch.textures[t].id);
+			RenderStats::frame.uniformUploads++;
+			RenderStats::frame.textureBinds++;
+			break;
+		}
+
+		glDrawElements(GL_TRIANGLES, batch.lodCounts[lod], GL_UNSIGNED_INT, (GLvoid*)(size_t)batch.lodOffsets[lod]);
+		RenderStats::frame.drawCalls++;
+		RenderStats::frame.triangles += batch.lodCounts[lod] / 3;
+	}
+	glBindVertexArray(0);
+	RenderStats::frame.vaoBinds++;
 }
 
 void Model::loadModel(string path)
@@ -32,6 +444,7 @@ void Model::loadModel(string path)
 		cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
 		return;
 	}
+	this->path = path;
 	// Retrieve the directory path of the filepath
 	this->directory = path.substr(0, path.find_last_of('/'));
 
@@ -74,6 +487,9 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
 		vector.y = mesh->mVertices[i].y;
 		vector.z = mesh->mVertices[i].z;
 		vertex.Position = vector;
+		this->boundingRadius = glm::max(this->boundingRadius, glm::length(vector));
+		this->boundsMin = glm::min(this->boundsMin, vector);
+		this->boundsMax = glm::max(this->boundsMax, vector);
 		// Normals
 		vector.x = mesh->mNormals[i].x;
 		vector.y = mesh->mNormals[i].y;
@@ -148,6 +564,7 @@ vector<Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType type,
 		if (!skip)
 		{   // If texture hasn't been loaded already, load it
 			Texture texture;
+			texture.id = 0;
 			//texture.id = TextureFromFile(str.C_Str(), this->directory);
 			texture.type = typeName;
 			texture.path = str;
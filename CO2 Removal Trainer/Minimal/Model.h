@@ -15,21 +15,62 @@ using namespace std;
 #include <assimp/postprocess.h>
 
 #include "Mesh.h"
+#include "Frustum.h"
+
+// Number of detail levels generated per model, level 0 is the mesh as loaded
+#define MAX_LODS 4
+
+// A run of indices in the merged buffers of a model that all share one material.
+struct MeshBatch {
+	Material material;
+	vector<Texture> textures;
+	// byte offset and index count of the run at every level of detail
+	vector<GLsizei> lodOffsets;
+	vector<GLsizei> lodCounts;
+};
 
 class Model
 {
 public:
 	glm::mat4 toWorld;
+	bool useBatches; // draw through the merged buffers built by buildStaticBatch
+	float boundingRadius; // distance from the model origin to its farthest vertex
+	glm::vec3 boundsMin, boundsMax; // model space bounding box of all meshes
+	GLuint lodCount; // levels available to Draw, 1 until generateLods has run
+
+	// fraction of the full-detail triangles kept at each level
+	static const float lodRatios[MAX_LODS];
+	// projected height in pixels below which each level takes over
+	static const float lodThresholds[MAX_LODS];
 
 	/*  Functions   */
 	// Constructor, expects a filepath to a 3D model.
 	Model(GLchar* path);
-	// Draws the model, and thus all its meshes
-	void Draw(GLuint shader);
+	// Draws the model, and thus all its meshes, at the given level of detail
+	void Draw(GLuint shader, GLuint lod = 0);
+	// Records the model in a render queue, one item per mesh or per batch, placed with the given world matrix
+	void Submit(RenderQueue& queue, GLuint shader, const glm::mat4& world, GLuint lod = 0);
+	// Builds the simplified levels of every mesh. They are cached next to the model file
+	// as <path>.lod so the quadric simplification only runs the first time a model is seen.
+	void generateLods();
+	// Height in pixels the bounding sphere covers when drawn with the given matrices
+	float projectedSize(const glm::mat4& projection, const glm::mat4& view, const glm::mat4& world, float viewportHeight) const;
+	// Picks the level for an object of the given projected size, only leaving 'current' once the
+	// size is clearly past a threshold so objects near a boundary don't flicker between levels.
+	GLuint selectLod(float pixelSize, GLuint current) const;
+	// Tests the bounds placed with the given world matrix against a frustum. The cheap
+	// sphere test rejects first and the box test catches spheres poking into a corner.
+	bool isVisible(const Frustum& frustum, const glm::mat4& world) const;
+	// Merges all meshes sharing a material into a single VAO so the model draws in one call per material.
+	// Only valid for models whose meshes all move together through toWorld.
+	void buildStaticBatch();
+	// Drops the cached uniform locations, for programs rebuilt in place
+	void forgetProgram();
 
 private:
 	/*  Model Data  */
 	vector<Mesh> meshes;
+	string path;
 	string directory;
 	vector<Texture> textures_loaded;	// Stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
 
@@ -47,6 +88,20 @@ private:
 
 	GLuint uProjection, uModel, uView;
 
+	/*  Static batch data  */
+	vector<MeshBatch> batches;
+	GLuint batchVAO, batchVBO, batchEBO;
+	// uniform locations are cached per program instead of looked up per draw
+	GLuint batchShader;
+	GLint modelLoc, normalMatrixLoc;
+	GLint matAmbientLoc, matDiffuseLoc, matSpecularLoc, matShineLoc, diffuseSamplerLoc;
+
+	void cacheLocations(GLuint shader);
+	void drawBatches(GLuint shader, GLuint lod);
+
+	bool loadLodCache(const string& file);
+	void saveLodCache(const string& file);
+
 };
 
 
@@ -25,13 +25,30 @@ Molecule::Molecule(Model* model)
 	// initialize random rotation vector
 	this->spinner = glm::normalize(glm::vec3(rf(-1.0, 1.0), rf(-1.0, 1.0), rf(-1.0, 1.0)));
 
+	this->lod[0] = this->lod[1] = 0;
+}
+
+void Molecule::scatter(float range)
+{
+	float disp = -50.0f;
+	this->center = glm::vec3(rf(-range, range), rf(-range, range), rf(-range + disp, range + disp));
+}
+
+glm::mat4 Molecule::modelMatrix()
+{
+	return glm::translate(glm::mat4(1.0f), this->center) * this->toWorld;
 }
 
 // Draws the model, and thus all its meshes
-void Molecule::Draw(GLuint shaderProgram)
+void Molecule::Draw(GLuint shaderProgram, GLuint lodLevel)
+{
+	this->model->toWorld = this->modelMatrix();
+	this->model->Draw(shaderProgram, lodLevel);
+}
+
+void Molecule::Submit(RenderQueue& queue, GLuint shaderProgram, GLuint lodLevel)
 {
-	this->model->toWorld = glm::translate(glm::mat4(1.0f), this->center) * this->toWorld;
-	this->model->Draw(shaderProgram);
+	this->model->Submit(queue, shaderProgram, this->modelMatrix(), lodLevel);
 }
 
 void Molecule::update(bool endstate) {
@@ -20,11 +20,17 @@ public:
 	glm::vec3 center;
 	glm::vec3 velocity;
 	glm::vec3 spinner;
+	GLuint lod[2]; // level of detail last picked for each eye
 	/*  Functions   */
 	// Constructor, expects a filepath to a 3D model.
 	Molecule(Model* model);
+	// Moves the molecule to a random spot within range of the scene center
+	void scatter(float range);
+	// World transform of this instance of the model
+	glm::mat4 modelMatrix();
 	// Draws the model, and thus all its meshes
-	void Draw(GLuint shader);
+	void Draw(GLuint shader, GLuint lodLevel = 0);
+	void Submit(RenderQueue& queue, GLuint shader, GLuint lodLevel = 0);
 	void update(bool endstate);
 };
 #endif
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "Remote.h"
+#include "RenderQueue.h"
 
 Remote::Remote() {
 	colorVal = glm::vec3(0.0f, 1.0f, 0.0f);
@@ -56,7 +57,6 @@ void Remote::Draw(GLuint shaderProgram) {
 
 	toWorld = glm::translate(quat, position);
 
-	glLineWidth(10.0f);
 	// draw lines
 	GLuint MatrixID = glGetUniformLocation(shaderProgram, "model");
 	glUniformMatrix4fv(MatrixID, 1, GL_FALSE, &toWorld[0][0]);
@@ -68,3 +68,12 @@ void Remote::Draw(GLuint shaderProgram) {
 	glDrawArrays(GL_LINES, 0, 2);
 	glBindVertexArray(0);
 }
+
+void Remote::Submit(RenderQueue& queue, GLuint shaderProgram) {
+
+	toWorld = glm::translate(quat, position);
+
+	DrawItem& item = queue.submit(shaderProgram, VAO, GL_LINES, 0, 2, false, toWorld);
+	item.hasColor = true;
+	item.color = colorVal;
+}
\ No newline at end of file
@@ -31,5 +31,7 @@ public:
 	vector<glm::vec3> calcCoords();
 	// Draws the model, and thus all its meshes
 	void Draw(GLuint shader);
+	// Records the line in a render queue instead of drawing it
+	void Submit(RenderQueue& queue, GLuint shader);
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,274 @@
+#include "RenderQueue.h"
+#include "RenderStats.h"
+
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
+
+// view distance that maps to the largest depth key, matches the far plane of the eye projections
+#define QUEUE_FAR 1000.0f
+
+RenderQueue::RenderQueue()
+{
+}
+
+void RenderQueue::begin(const glm::mat4& projection, const glm::mat4& view)
+{
+	this->projection = projection;
+	this->view = view;
+	this->items.clear();
+}
+
+DrawItem& RenderQueue::submit(GLuint program, GLuint vao, GLenum mode, GLsizei first, GLsizei count, bool indexed, const glm::mat4& model)
+{
+	DrawItem item;
+	item.program = program;
+	item.vao = vao;
+	item.mode = mode;
+	item.indexed = indexed;
+	item.first = first;
+	item.count = count;
+	item.textureTarget = 0;
+	item.texture = 0;
+	item.sampler = NULL;
+	item.material = NULL;
+	item.hasColor = false;
+	item.color = glm::vec3(0.0f);
+	item.model = model;
+	item.hasNormalMatrix = false;
+	this->items.push_back(item);
+	return this->items.back();
+}
+
+void RenderQueue::setTexture(DrawItem& item, GLenum target, GLuint texture, const char* sampler)
+{
+	item.textureTarget = target;
+	item.texture = texture;
+	item.sampler = sampler;
+}
+
+void RenderQueue::setNormalMatrix(DrawItem& item, const glm::mat3& normalMatrix)
+{
+	item.hasNormalMatrix = true;
+	item.normalMatrix = normalMatrix;
+}
+
+GLuint RenderQueue::size() const
+{
+	return this->items.size();
+}
+
+void RenderQueue::forgetPrograms()
+{
+	this->programs.clear();
+}
+
+RenderQueue::ProgramState& RenderQueue::programState(GLuint program)
+{
+	map<GLuint, ProgramState>::iterator found = this->programs.find(program);
+	if (found != this->programs.end())
+		return found->second;
+
+	ProgramState& state = this->programs[program];
+	state.slot = (this->programs.size() - 1) & 0xFF;
+	state.projection = glGetUniformLocation(program, "projection");
+	state.view = glGetUniformLocation(program, "view");
+	state.model = glGetUniformLocation(program, "model");
+	state.normalMatrix = glGetUniformLocation(program, "normalMatrix");
+	state.color = glGetUniformLocation(program, "colorVal");
+	state.matAmbient = glGetUniformLocation(program, "material.ambient");
+	state.matDiffuse = glGetUniformLocation(program, "material.diffuse");
+	state.matSpecular = glGetUniformLocation(program, "material.specular");
+	state.matShine = glGetUniformLocation(program, "material.shininess");
+	RenderStats::frame.uniformLookups += 9;
+	return state;
+}
+
+GLuint RenderQueue::materialSlot(const Material* material, GLuint texture)
+{
+	pair<const Material*, GLuint> id(material, texture);
+	map<pair<const Material*, GLuint>, GLuint>::iterator found = this->materials.find(id);
+	if (found != this->materials.end())
+		return found->second;
+	GLuint slot = this->materials.size() & 0xFFFF;
+	this->materials[id] = slot;
+	return slot;
+}
+
+unsigned long long RenderQueue::makeKey(const DrawItem& item)
+{
+	glm::vec4 center = this->view * item.model[3];
+	float distance = glm::clamp(glm::length(glm::vec3(center)) / QUEUE_FAR, 0.0f, 1.0f);
+	unsigned long long depth = (unsigned long long)(distance * 0xFFFFFF);
+
+	unsigned long long key = 0;
+	key |= (unsigned long long)this->programState(item.program).slot << 56;
+	key |= (unsigned long long)this->materialSlot(item.material, item.texture) << 40;
+	key |= (unsigned long long)(item.vao & 0xFFFF) << 24;
+	key |= depth;
+	return key;
+}
+
+void RenderQueue::sortKeys()
+{
+	GLuint n = this->items.size();
+	this->order.resize(n);
+	this->scratch.resize(n);
+	for (GLuint i = 0; i < n; i++)
+		this->order[i] = i;
+
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		GLuint counts[256] = { 0 };
+		for (GLuint i = 0; i < n; i++)
+			counts[(this->keys[i] >> shift) & 0xFF]++;
+		if (counts[(this->keys[0] >> shift) & 0xFF] == n)
+			continue;
+
+		GLuint offsets[256];
+		GLuint sum = 0;
+		for (int b = 0; b < 256; b++)
+		{
+			offsets[b] = sum;
+			sum += counts[b];
+		}
+		for (GLuint i = 0; i < n; i++)
+		{
+			GLuint item = this->order[i];
+			this->scratch[offsets[(this->keys[item] >> shift) & 0xFF]++] = item;
+		}
+		this->order.swap(this->scratch);
+	}
+}
+
+void RenderQueue::flush()
+{
+	GLuint n = this->items.size();
+	if (n == 0)
+		return;
+
+	// material slots only have to tell this pass's materials apart, so they start over every flush
+	this->materials.clear();
+	this->keys.resize(n);
+	for (GLuint i = 0; i < n; i++)
+		this->keys[i] = this->makeKey(this->items[i]);
+	this->sortKeys();
+
+	// nothing is assumed about the state left behind by code outside the queue
+	GLuint program = 0, vao = 0, texture = 0;
+	GLenum textureTarget = 0;
+	const Material* material = NULL;
+	ProgramState* state = NULL;
+	bool hasColor = false;
+	glm::vec3 color;
+
+	glActiveTexture(GL_TEXTURE0);
+	for (GLuint i = 0; i < n; i++)
+	{
+		const DrawItem& item = this->items[this->order[i]];
+
+		if (item.program != program)
+		{
+			program = item.program;
+			state = &this->programState(program);
+			glUseProgram(program);
+			RenderStats::frame.programBinds++;
+			// programs that read the camera from a uniform block have neither location
+			if (state->projection != -1)
+			{
+				glUniformMatrix4fv(state->projection, 1, GL_FALSE, glm::value_ptr(this->projection));
+				glUniformMatrix4fv(state->view, 1, GL_FALSE, glm::value_ptr(this->view));
+				RenderStats::frame.uniformUploads += 2;
+			}
+			// uniforms belong to the program, so anything uploaded for the last one is gone
+			material = NULL;
+			hasColor = false;
+		}
+		if (item.vao != vao)
+		{
+			vao = item.vao;
+			glBindVertexArray(vao);
+			RenderStats::frame.vaoBinds++;
+		}
+		if (item.texture == 0 && texture != 0)
+		{
+			// the immediate path leaves untextured draws with nothing bound, so the queue does too
+			glBindTexture(textureTarget, 0);
+			texture = 0;
+			RenderStats::frame.textureBinds++;
+		}
+		else if (item.texture != 0 && (item.texture != texture || item.textureTarget != textureTarget))
+		{
+			map<const char*, GLint>::iterator sampler = state->samplers.find(item.sampler);
+			if (sampler == state->samplers.end())
+			{
+				// sampler uniforms keep their value in the program, so unit 0 only has to be set once
+				GLint location = glGetUniformLocation(program, item.sampler);
+				if (location != -1)
+				{
+					glUniform1i(location, 0);
+					RenderStats::frame.uniformUploads++;
+				}
+				sampler = state->samplers.insert(pair<const char*, GLint>(item.sampler, location)).first;
+				RenderStats::frame.uniformLookups++;
+			}
+			// a variant that doesn't sample the texture doesn't need it bound
+			if (sampler->second != -1)
+			{
+				texture = item.texture;
+				textureTarget = item.textureTarget;
+				glBindTexture(textureTarget, texture);
+				RenderStats::frame.textureBinds++;
+			}
+		}
+		if (item.material != NULL && item.material != material)
+		{
+			material = item.material;
+			if (state->matAmbient != -1)
+			{
+				glUniform3f(state->matAmbient, material->ambient.x, material->ambient.y, material->ambient.z);
+				RenderStats::frame.uniformUploads++;
+			}
+			if (state->matDiffuse != -1)
+			{
+				glUniform3f(state->matDiffuse, material->diffuse.x, material->diffuse.y, material->diffuse.z);
+				RenderStats::frame.uniformUploads++;
+			}
+			if (state->matSpecular != -1)
+			{
+				glUniform3f(state->matSpecular, material->specular.x, material->specular.y, material->specular.z);
+				RenderStats::frame.uniformUploads++;
+			}
+			if (state->matShine != -1)
+			{
+				glUniform1f(state->matShine, material->shininess);
+				RenderStats::frame.uniformUploads++;
+			}
+		}
+		if (item.hasColor && (!hasColor || item.color != color))
+		{
+			hasColor = true;
+			color = item.color;
+			glUniform3f(state->color, color.x, color.y, color.z);
+			RenderStats::frame.uniformUploads++;
+		}
+
+		glUniformMatrix4fv(state->model, 1, GL_FALSE, glm::value_ptr(item.model));
+		RenderStats::frame.uniformUploads++;
+		if (state->normalMatrix != -1)
+		{
+			glm::mat3 normalMatrix = item.hasNormalMatrix ? item.normalMatrix : glm::inverseTranspose(glm::mat3(item.model));
+			glUniformMatrix3fv(state->normalMatrix, 1, GL_FALSE, glm::value_ptr(normalMatrix));
+			RenderStats::frame.uniformUploads++;
+		}
+
+		if (item.indexed)
+			glDrawElements(item.mode, item.count, GL_UNSIGNED_INT, (GLvoid*)(size_t)item.first);
+		else
+			glDrawArrays(item.mode, item.first, item.count);
+		RenderStats::frame.drawCalls++;
+		if (item.mode == GL_TRIANGLES)
+			RenderStats::frame.triangles += item.count / 3;
+	}
+	glBindVertexArray(0);
+	this->items.clear();
+}
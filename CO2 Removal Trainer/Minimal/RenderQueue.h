@@ -0,0 +1,78 @@
+#ifndef RENDERQUEUE_H_
+#define RENDERQUEUE_H_
+
+#include <vector>
+#include <map>
+using namespace std;
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "Mesh.h"
+
+// One draw recorded for the frame. Everything needed to issue it is copied in when it is
+// submitted, so the queue can reorder draws freely before executing them.
+struct DrawItem {
+	GLuint program;
+	GLuint vao;
+	GLenum mode;			// GL_TRIANGLES or GL_LINES
+	bool indexed;			// glDrawElements with GL_UNSIGNED_INT indices, otherwise glDrawArrays
+	GLsizei first;			// byte offset into the element buffer, or first vertex of an array draw
+	GLsizei count;
+	GLenum textureTarget;	// GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP, 0 when untextured
+	GLuint texture;			// always bound to unit 0
+	const char* sampler;	// sampler uniform pointed at unit 0
+	const Material* material; // null for programs without a material block
+	bool hasColor;			// colorVal of the line shader
+	glm::vec3 color;
+	glm::mat4 model;
+	bool hasNormalMatrix;	// set once per instance, otherwise derived from model when the program reads it
+	glm::mat3 normalMatrix;
+};
+
+// Collects the draws of a pass, sorts them by a 64 bit key and executes them while skipping every
+// program, VAO, texture and material change that would not change anything.
+// Key layout from the top bit down: program (8) | material (16) | VAO (16) | depth (24),
+// so draws group by program first and, within a group, go front to back.
+class RenderQueue
+{
+public:
+	RenderQueue();
+
+	// Starts a pass, every program drawn by it gets this projection and view
+	void begin(const glm::mat4& projection, const glm::mat4& view);
+	DrawItem& submit(GLuint program, GLuint vao, GLenum mode, GLsizei first, GLsizei count, bool indexed, const glm::mat4& model);
+	void setTexture(DrawItem& item, GLenum target, GLuint texture, const char* sampler);
+	void setNormalMatrix(DrawItem& item, const glm::mat3& normalMatrix);
+	// Sorts and issues everything submitted since begin, leaving no VAO bound
+	void flush();
+
+	GLuint size() const;
+	// Drops the uniform locations looked up so far, for programs rebuilt in place
+	void forgetPrograms();
+
+private:
+	// uniform locations looked up once per program
+	struct ProgramState {
+		GLuint slot;
+		GLint projection, view, model, normalMatrix, color;
+		GLint matAmbient, matDiffuse, matSpecular, matShine;
+		map<const char*, GLint> samplers;
+	};
+
+	vector<DrawItem> items;
+	vector<unsigned long long> keys;
+	vector<GLuint> order, scratch;
+
+	glm::mat4 projection, view;
+	map<GLuint, ProgramState> programs;
+	map<pair<const Material*, GLuint>, GLuint> materials;
+
+	ProgramState& programState(GLuint program);
+	GLuint materialSlot(const Material* material, GLuint texture);
+	unsigned long long makeKey(const DrawItem& item);
+	// LSD radix sort of 'order' by key, one byte per pass, skipping bytes all keys share
+	void sortKeys();
+};
+
+#endif
@@ -0,0 +1,22 @@
+#include "RenderStats.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <Windows.h>
+
+RenderStats RenderStats::frame;
+
+void RenderStats::reset()
+{
+	memset(&frame, 0, sizeof(RenderStats));
+}
+
+void RenderStats::report(const char* label)
+{
+	char buff[256];
+	sprintf_s(buff, "%s: %u draws, %u tris, %u program binds, %u VAO binds, %u texture binds, %u uniform lookups, %u uniform uploads\n",
+		label, frame.drawCalls, frame.triangles, frame.programBinds, frame.vaoBinds,
+		frame.textureBinds, frame.uniformLookups, frame.uniformUploads);
+	OutputDebugStringA(buff);
+	printf("%s", buff);
+}
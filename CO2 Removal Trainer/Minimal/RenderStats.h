@@ -0,0 +1,25 @@
+#ifndef RENDERSTATS_H_
+#define RENDERSTATS_H_
+
+// Per-frame counters for draw calls and GL state changes. Every draw path bumps
+// these so the cost of a frame can be compared before and after an optimization.
+struct RenderStats
+{
+	unsigned int drawCalls;
+	unsigned int triangles;
+	unsigned int programBinds;
+	unsigned int vaoBinds;
+	unsigned int textureBinds;
+	unsigned int uniformLookups;
+	unsigned int uniformUploads;
+
+	// counters for the frame currently being rendered
+	static RenderStats frame;
+
+	// clears the counters, called once at the start of every frame
+	static void reset();
+	// writes the current counters to the debug output, prefixed by label
+	static void report(const char* label);
+};
+
+#endif
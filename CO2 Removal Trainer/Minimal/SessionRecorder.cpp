@@ -0,0 +1,253 @@
+#include "SessionRecorder.h"
+#include "Input.h"
+
+#include <string.h>
+#include <Windows.h>
+
+// frames are small, so buffer a few seconds worth before touching the disk
+#define SESSION_BUFFER_SIZE (64 * 1024)
+
+SessionRecorder::SessionRecorder() : fp(NULL), frames(0)
+{
+	memset(&header, 0, sizeof(header));
+}
+
+SessionRecorder::~SessionRecorder()
+{
+	stop();
+}
+
+bool SessionRecorder::start(const char* file, unsigned int seed)
+{
+	stop();
+	fp = fopen(file, "wb");
+	if (fp == NULL)
+	{
+		printf("Unable to record session to %s\n", file);
+		return false;
+	}
+	setvbuf(fp, NULL, _IOFBF, SESSION_BUFFER_SIZE);
+
+	header.magic = SESSION_MAGIC;
+	header.version = SESSION_VERSION;
+	header.frameSize = sizeof(SessionFrame);
+	header.seed = seed;
+	fwrite(&header, sizeof(header), 1, fp);
+	frames = 0;
+	return true;
+}
+
+void SessionRecorder::write(const FrameContext& context, const ovrInputState* input)
+{
+	if (fp == NULL)
+		return;
+
+	SessionFrame record;
+	memset(&record, 0, sizeof(record));
+	record.sampleTime = context.sampleTime;
+	record.predictedDisplayTime = context.predictedDisplayTime;
+	record.headPose = context.headPose;
+	for (int i = 0; i < 2; i++)
+	{
+		record.eyePoses[i] = context.eyePoses[i];
+		record.handPoses[i] = context.handPoses[i];
+		record.handStatusFlags[i] = context.handStatusFlags[i];
+	}
+	if (input != NULL)
+	{
+		record.inputValid = 1;
+		record.inputTime = input->TimeInSeconds;
+		record.buttons = input->Buttons;
+		record.touches = input->Touches;
+		for (int hand = 0; hand < ovrHand_Count; hand++)
+		{
+			record.indexTrigger[hand] = input->IndexTrigger[hand];
+			record.handTrigger[hand] = input->HandTrigger[hand];
+			record.thumbstick[hand] = input->Thumbstick[hand];
+		}
+	}
+	fwrite(&record, sizeof(record), 1, fp);
+	frames++;
+}
+
+void SessionRecorder::stop()
+{
+	if (fp == NULL)
+		return;
+	fclose(fp);
+	fp = NULL;
+
+	char buff[100];
+	sprintf_s(buff, "Recorded %u frames\n", frames);
+	OutputDebugStringA(buff);
+	printf("%s", buff);
+}
+
+SessionPlayer::SessionPlayer() : fp(NULL), frames(0)
+{
+	memset(&header, 0, sizeof(header));
+}
+
+SessionPlayer::~SessionPlayer()
+{
+	close();
+}
+
+bool SessionPlayer::open(const char* file)
+{
+	close();
+	fp = fopen(file, "rb");
+	if (fp == NULL)
+	{
+		printf("Unable to open session %s\n", file);
+		return false;
+	}
+	setvbuf(fp, NULL, _IOFBF, SESSION_BUFFER_SIZE);
+
+	if (fread(&header, sizeof(header), 1, fp) != 1 || header.magic != SESSION_MAGIC
+		|| header.version != SESSION_VERSION || header.frameSize != sizeof(SessionFrame))
+	{
+		printf("%s is not a session recorded by this version\n", file);
+		close();
+		return false;
+	}
+	frames = 0;
+	return true;
+}
+
+bool SessionPlayer::next(FrameContext& context, ovrInputState& input, bool& inputValid)
+{
+	SessionFrame record;
+	if (fp == NULL || fread(&record, sizeof(record), 1, fp) != 1)
+		return false;
+
+	context.sampleTime = record.sampleTime;
+	context.predictedDisplayTime = record.predictedDisplayTime;
+	context.headPose = record.headPose;
+	for (int i = 0; i < 2; i++)
+	{
+		context.eyePoses[i] = record.eyePoses[i];
+		context.handPoses[i] = record.handPoses[i];
+		context.handStatusFlags[i] = record.handStatusFlags[i];
+	}
+
+	memset(&input, 0, sizeof(input));
+	inputValid = record.inputValid != 0;
+	input.TimeInSeconds = record.inputTime;
+	input.Buttons = record.buttons;
+	input.Touches = record.touches;
+	input.ControllerType = ovrControllerType_Touch;
+	for (int hand = 0; hand < ovrHand_Count; hand++)
+	{
+		input.IndexTrigger[hand] = record.indexTrigger[hand];
+		input.HandTrigger[hand] = record.handTrigger[hand];
+		input.Thumbstick[hand] = record.thumbstick[hand];
+	}
+	frames++;
+	return true;
+}
+
+void SessionPlayer::close()
+{
+	if (fp == NULL)
+		return;
+	fclose(fp);
+	fp = NULL;
+}
+
+// One frame of the input check: what the controllers read, and the events that frame has to
+// produce, worked out by hand
+struct InputCheckFrame
+{
+	bool valid;
+	unsigned int buttons;
+	float rightIndexTrigger;
+	float leftHandTrigger;
+	unsigned int held, pressed, released;
+};
+
+static const InputCheckFrame INPUT_CHECK[] = {
+	// nothing held
+	{ true, 0, 0.0f, 0.0f, 0, 0, 0 },
+	// A goes down
+	{ true, ovrButton_A, 0.0f, 0.0f, ovrButton_A, ovrButton_A, 0 },
+	// A held is no second press, the right trigger pulled past the threshold is one
+	{ true, ovrButton_A, 0.6f, 0.0f, ovrButton_A | INPUT_RIGHT_INDEX_TRIGGER, INPUT_RIGHT_INDEX_TRIGGER, 0 },
+	// A up, and the trigger eased back to exactly the threshold no longer counts as pulled
+	{ true, 0, 0.5f, 0.0f, 0, 0, ovrButton_A | INPUT_RIGHT_INDEX_TRIGGER },
+	// B and the left grip in the same frame
+	{ true, ovrButton_B, 0.0f, 0.9f, ovrButton_B | INPUT_LEFT_HAND_TRIGGER, ovrButton_B | INPUT_LEFT_HAND_TRIGGER, 0 },
+	// controllers lost, everything reads as released
+	{ false, ovrButton_B, 0.0f, 0.9f, 0, 0, ovrButton_B | INPUT_LEFT_HAND_TRIGGER },
+	// back with B still down, which is pressed again
+	{ true, ovrButton_B, 0.0f, 0.0f, ovrButton_B, ovrButton_B, 0 },
+	// B up as A goes down
+	{ true, ovrButton_A, 0.0f, 0.0f, ovrButton_A, ovrButton_A, ovrButton_B },
+	// let go
+	{ true, 0, 0.0f, 0.0f, 0, 0, ovrButton_A },
+};
+
+bool checkInputReplay(const char* file)
+{
+	static const unsigned int FRAMES = sizeof(INPUT_CHECK) / sizeof(INPUT_CHECK[0]);
+	char buff[300];
+
+	SessionRecorder recorder;
+	if (!recorder.start(file, 0))
+	{
+		sprintf_s(buff, "Input replay FAIL: can't write %s\n", file);
+		OutputDebugStringA(buff);
+		printf("%s", buff);
+		return false;
+	}
+	FrameContext context;
+	memset(&context, 0, sizeof(context));
+	for (unsigned int f = 0; f < FRAMES; f++)
+	{
+		ovrInputState raw;
+		memset(&raw, 0, sizeof(raw));
+		raw.TimeInSeconds = f / 90.0;
+		raw.Buttons = INPUT_CHECK[f].buttons;
+		raw.IndexTrigger[ovrHand_Right] = INPUT_CHECK[f].rightIndexTrigger;
+		raw.HandTrigger[ovrHand_Left] = INPUT_CHECK[f].leftHandTrigger;
+		context.frame = f;
+		recorder.write(context, INPUT_CHECK[f].valid ? &raw : NULL);
+	}
+	recorder.stop();
+
+	SessionPlayer player;
+	if (!player.open(file))
+	{
+		sprintf_s(buff, "Input replay FAIL: can't read %s back\n", file);
+		OutputDebugStringA(buff);
+		printf("%s", buff);
+		return false;
+	}
+
+	InputSystem input;
+	ovrInputState raw;
+	bool valid;
+	unsigned int failed = 0, firstFailed = 0;
+	while (player.next(context, raw, valid) && player.framesRead() <= FRAMES)
+	{
+		const InputCheckFrame& expected = INPUT_CHECK[player.framesRead() - 1];
+		const InputSnapshot& snapshot = input.advance(valid ? &raw : NULL);
+		bool ok = snapshot.valid == expected.valid && snapshot.buttons == expected.held
+			&& snapshot.pressed == expected.pressed && snapshot.released == expected.released;
+		if (!ok && failed++ == 0)
+			firstFailed = player.framesRead() - 1;
+	}
+	unsigned int frames = player.framesRead();
+	player.close();
+
+	if (frames != FRAMES)
+		sprintf_s(buff, "Input replay FAIL: %u frames recorded, %u read back from %s\n", FRAMES, frames, file);
+	else if (failed == 0)
+		sprintf_s(buff, "Input replay PASS: all %u scripted frames of %s gave the expected press and release events\n", FRAMES, file);
+	else
+		sprintf_s(buff, "Input replay FAIL: %u of %u scripted frames of %s gave other events than expected, the first at frame %u\n",
+			failed, FRAMES, file, firstFailed);
+	OutputDebugStringA(buff);
+	printf("%s", buff);
+	return frames == FRAMES && failed == 0;
+}
@@ -0,0 +1,92 @@
+#ifndef SESSIONRECORDER_H_
+#define SESSIONRECORDER_H_
+
+#include <stdio.h>
+
+#include <OVR_CAPI.h>
+
+#include "FrameContext.h"
+
+// "CO2S" in a little-endian file
+#define SESSION_MAGIC 0x53324F43
+#define SESSION_VERSION 1
+
+#pragma pack(push, 1)
+struct SessionHeader
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned int frameSize;		// sizeof(SessionFrame) of the writer, a mismatch means another layout
+	unsigned int seed;			// rand() seed the scene was restarted with when recording began
+};
+
+// Everything a frame reads from the SDK. Triggers, thumbsticks and buttons are stored raw,
+// so the edge events are rebuilt by the same InputSystem code on replay.
+struct SessionFrame
+{
+	double sampleTime;
+	double predictedDisplayTime;
+	ovrPosef headPose;
+	ovrPosef eyePoses[2];
+	ovrPosef handPoses[2];
+	unsigned int handStatusFlags[2];
+	unsigned char inputValid;
+	double inputTime;
+	unsigned int buttons;
+	unsigned int touches;
+	float indexTrigger[ovrHand_Count];
+	float handTrigger[ovrHand_Count];
+	ovrVector2f thumbstick[ovrHand_Count];
+};
+#pragma pack(pop)
+
+// Streams one SessionFrame per rendered frame to a file
+class SessionRecorder
+{
+public:
+	SessionRecorder();
+	~SessionRecorder();
+
+	bool start(const char* file, unsigned int seed);
+	// input is null when the controllers couldn't be read this frame
+	void write(const FrameContext& context, const ovrInputState* input);
+	void stop();
+
+	bool recording() const { return fp != NULL; }
+	unsigned int seed() const { return header.seed; }
+
+private:
+	FILE* fp;
+	SessionHeader header;
+	unsigned int frames;
+};
+
+// Reads a recorded session back one frame at a time
+class SessionPlayer
+{
+public:
+	SessionPlayer();
+	~SessionPlayer();
+
+	bool open(const char* file);
+	// Fills the tracking of context and the raw input of the next frame, false once the stream ends.
+	// inputValid is false for frames where the controllers couldn't be read.
+	bool next(FrameContext& context, ovrInputState& input, bool& inputValid);
+	void close();
+
+	bool playing() const { return fp != NULL; }
+	unsigned int seed() const { return header.seed; }
+	unsigned int framesRead() const { return frames; }
+
+private:
+	FILE* fp;
+	SessionHeader header;
+	unsigned int frames;
+};
+
+// Records a short scripted session of button presses, trigger pulls and a lost controller to
+// file, replays it through a fresh InputSystem and checks every snapshot against the events
+// written down for that frame. Logs PASS or FAIL with the first frame that differs. Needs no headset.
+bool checkInputReplay(const char* file);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,247 @@
+#include "Simplify.h"
+
+#include <map>
+#include <set>
+#include <queue>
+#include <tuple>
+#include <cmath>
+#include <algorithm>
+
+namespace {
+
+	struct Vec {
+		double x, y, z;
+	};
+
+	Vec sub(const Vec& a, const Vec& b) { Vec r = { a.x - b.x, a.y - b.y, a.z - b.z }; return r; }
+	Vec cross(const Vec& a, const Vec& b) { Vec r = { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; return r; }
+	double dot(const Vec& a, const Vec& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+	// Symmetric 4x4 error quadric, only the upper triangle is stored
+	struct Quadric {
+		double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+
+		Quadric() : a2(0), ab(0), ac(0), ad(0), b2(0), bc(0), bd(0), c2(0), cd(0), d2(0) {}
+
+		// quadric of the plane ax + by + cz + d = 0
+		Quadric(double a, double b, double c, double d)
+			: a2(a * a), ab(a * b), ac(a * c), ad(a * d), b2(b * b), bc(b * c), bd(b * d), c2(c * c), cd(c * d), d2(d * d) {}
+
+		void add(const Quadric& q) {
+			a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+			b2 += q.b2; bc += q.bc; bd += q.bd;
+			c2 += q.c2; cd += q.cd;
+			d2 += q.d2;
+		}
+
+		// sum of squared distances from p to all planes accumulated in this quadric
+		double error(const Vec& p) const {
+			return a2 * p.x * p.x + 2 * ab * p.x * p.y + 2 * ac * p.x * p.z + 2 * ad * p.x
+				+ b2 * p.y * p.y + 2 * bc * p.y * p.z + 2 * bd * p.y
+				+ c2 * p.z * p.z + 2 * cd * p.z
+				+ d2;
+		}
+	};
+
+	// Merging welded vertex 'from' into 'to'. The stamps go stale once either end changes.
+	struct Collapse {
+		double cost;
+		GLuint from, to;
+		GLuint fromStamp, toStamp;
+
+		// std::priority_queue is a max-heap, so invert to pop the cheapest collapse first
+		bool operator<(const Collapse& other) const { return cost > other.cost; }
+	};
+}
+
+vector<GLuint> simplifyMesh(const vector<Vertex>& vertices, const vector<GLuint>& indices, float targetRatio)
+{
+	GLuint triCount = indices.size() / 3;
+	if (targetRatio >= 1.0f || triCount == 0)
+		return indices;
+	GLuint target = (GLuint)(triCount * targetRatio);
+
+	// Weld vertices that share a position. rep maps each welded vertex back to one original vertex.
+	map<tuple<float, float, float>, GLuint> welded;
+	vector<GLuint> weld(vertices.size());
+	vector<GLuint> rep;
+	vector<Vec> pos;
+	for (GLuint i = 0; i < vertices.size(); i++)
+	{
+		tuple<float, float, float> key(vertices[i].Position.x, vertices[i].Position.y, vertices[i].Position.z);
+		map<tuple<float, float, float>, GLuint>::iterator found = welded.find(key);
+		if (found != welded.end()) {
+			weld[i] = found->second;
+			continue;
+		}
+		weld[i] = pos.size();
+		welded[key] = pos.size();
+		rep.push_back(i);
+		Vec p = { vertices[i].Position.x, vertices[i].Position.y, vertices[i].Position.z };
+		pos.push_back(p);
+	}
+
+	// Triangles over welded ids, with the plane of every face accumulated into its corners
+	vector<GLuint> tris(indices.size());
+	vector<bool> alive(triCount, true);
+	vector<Quadric> quadrics(pos.size());
+	vector<vector<GLuint> > vertTris(pos.size());
+	GLuint remaining = 0;
+	for (GLuint t = 0; t < triCount; t++)
+	{
+		GLuint a = tris[3 * t] = weld[indices[3 * t]];
+		GLuint b = tris[3 * t + 1] = weld[indices[3 * t + 1]];
+		GLuint c = tris[3 * t + 2] = weld[indices[3 * t + 2]];
+		if (a == b || b == c || a == c) {
+			alive[t] = false;
+			continue;
+		}
+		remaining++;
+
+		Vec n = cross(sub(pos[b], pos[a]), sub(pos[c], pos[a]));
+		double len = sqrt(dot(n, n));
+		if (len > 0.0) {
+			n.x /= len; n.y /= len; n.z /= len;
+			Quadric q(n.x, n.y, n.z, -dot(n, pos[a]));
+			quadrics[a].add(q);
+			quadrics[b].add(q);
+			quadrics[c].add(q);
+		}
+		vertTris[a].push_back(t);
+		vertTris[b].push_back(t);
+		vertTris[c].push_back(t);
+	}
+
+	vector<GLuint> stamp(pos.size(), 0);
+	vector<bool> removed(pos.size(), false);
+	priority_queue<Collapse> heap;
+
+	// Queue the cheaper direction of collapsing the edge a-b
+	auto pushEdge = [&](GLuint a, GLuint b) {
+		Quadric q = quadrics[a];
+		q.add(quadrics[b]);
+		double intoB = q.error(pos[b]);
+		double intoA = q.error(pos[a]);
+		Collapse c;
+		if (intoB <= intoA) {
+			c.cost = intoB; c.from = a; c.to = b;
+		}
+		else {
+			c.cost = intoA; c.from = b; c.to = a;
+		}
+		c.fromStamp = stamp[c.from];
+		c.toStamp = stamp[c.to];
+		heap.push(c);
+	};
+
+	set<pair<GLuint, GLuint> > edges;
+	for (GLuint t = 0; t < triCount; t++)
+	{
+		if (!alive[t])
+			continue;
+		for (int k = 0; k < 3; k++)
+		{
+			GLuint a = tris[3 * t + k];
+			GLuint b = tris[3 * t + (k + 1) % 3];
+			edges.insert(pair<GLuint, GLuint>(min(a, b), max(a, b)));
+		}
+	}
+	for (set<pair<GLuint, GLuint> >::iterator it = edges.begin(); it != edges.end(); ++it)
+		pushEdge(it->first, it->second);
+
+	// Moving 'from' onto 'to' must not turn any surviving triangle around 'from' inside out
+	auto flips = [&](GLuint from, GLuint to) {
+		for (GLuint i = 0; i < vertTris[from].size(); i++)
+		{
+			GLuint t = vertTris[from][i];
+			if (!alive[t])
+				continue;
+			Vec before[3], after[3];
+			bool shared = false;
+			for (int k = 0; k < 3; k++)
+			{
+				GLuint v = tris[3 * t + k];
+				if (v == to)
+					shared = true;
+				before[k] = pos[v];
+				after[k] = (v == from) ? pos[to] : pos[v];
+			}
+			if (shared)
+				continue; // this one collapses to a line and gets removed
+			Vec n0 = cross(sub(before[1], before[0]), sub(before[2], before[0]));
+			Vec n1 = cross(sub(after[1], after[0]), sub(after[2], after[0]));
+			if (dot(n0, n1) <= 0.0)
+				return true;
+		}
+		return false;
+	};
+
+	while (remaining > target && !heap.empty())
+	{
+		Collapse c = heap.top();
+		heap.pop();
+		if (removed[c.from] || removed[c.to] || stamp[c.from] != c.fromStamp || stamp[c.to] != c.toStamp)
+			continue;
+		if (flips(c.from, c.to))
+			continue;
+
+		removed[c.from] = true;
+		quadrics[c.to].add(quadrics[c.from]);
+		for (GLuint i = 0; i < vertTris[c.from].size(); i++)
+		{
+			GLuint t = vertTris[c.from][i];
+			if (!alive[t])
+				continue;
+			for (int k = 0; k < 3; k++)
+			{
+				if (tris[3 * t + k] == c.from)
+					tris[3 * t + k] = c.to;
+			}
+			GLuint a = tris[3 * t], b = tris[3 * t + 1], d = tris[3 * t + 2];
+			if (a == b || b == d || a == d) {
+				alive[t] = false;
+				remaining--;
+			}
+			else {
+				vertTris[c.to].push_back(t);
+			}
+		}
+		vertTris[c.from].clear();
+		stamp[c.to]++;
+
+		// Drop dead faces from the survivor and requeue the edges to its neighbors
+		vector<GLuint> live;
+		set<GLuint> neighbors;
+		for (GLuint i = 0; i < vertTris[c.to].size(); i++)
+		{
+			GLuint t = vertTris[c.to][i];
+			if (!alive[t])
+				continue;
+			live.push_back(t);
+			for (int k = 0; k < 3; k++)
+			{
+				if (tris[3 * t + k] != c.to)
+					neighbors.insert(tris[3 * t + k]);
+			}
+		}
+		vertTris[c.to] = live;
+		for (set<GLuint>::iterator it = neighbors.begin(); it != neighbors.end(); ++it)
+			pushEdge(c.to, *it);
+	}
+
+	// Corners that kept their welded vertex keep their own attributes, collapsed ones borrow the survivor's
+	vector<GLuint> result;
+	result.reserve(remaining * 3);
+	for (GLuint t = 0; t < triCount; t++)
+	{
+		if (!alive[t])
+			continue;
+		for (int k = 0; k < 3; k++)
+		{
+			GLuint original = indices[3 * t + k];
+			GLuint survivor = tris[3 * t + k];
+			result.push_back(survivor == weld[original] ? original : rep[survivor]);
+		}
+	}
+	return result;
+}
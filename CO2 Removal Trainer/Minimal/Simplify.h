@@ -0,0 +1,16 @@
+#ifndef SIMPLIFY_H_
+#define SIMPLIFY_H_
+
+#include <vector>
+using namespace std;
+
+#include "Mesh.h"
+
+// Quadric error metric simplification (Garland & Heckbert) of an indexed triangle list.
+// Vertices are welded by position first so meshes split along UV seams still collapse,
+// and every collapse moves onto one of the two existing endpoints, so the returned
+// index list can be drawn straight out of the original vertex buffer.
+// targetRatio is the fraction of the input triangles to keep.
+vector<GLuint> simplifyMesh(const vector<Vertex>& vertices, const vector<GLuint>& indices, float targetRatio);
+
+#endif
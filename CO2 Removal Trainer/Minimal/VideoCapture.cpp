@@ -0,0 +1,246 @@
+#include "VideoCapture.h"
+
+#include <string.h>
+#include <Windows.h>
+
+static double nowMs()
+{
+	static LARGE_INTEGER frequency = { 0 };
+	if (frequency.QuadPart == 0)
+		QueryPerformanceFrequency(&frequency);
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return (double)counter.QuadPart * 1000.0 / (double)frequency.QuadPart;
+}
+
+VideoCapture::VideoCapture()
+	: fp(NULL), width(0), height(0), readFbo(0), first(0), inFlight(0), finishing(false),
+	captured(0), written(0), droppedReadback(0), droppedEncoder(0), captureMs(0.0)
+{
+	for (int i = 0; i < CAPTURE_SLOTS; i++)
+	{
+		this->slots[i].pbo = 0;
+		this->slots[i].fence = 0;
+	}
+}
+
+VideoCapture::~VideoCapture()
+{
+	stop();
+}
+
+bool VideoCapture::start(const char* file, int width, int height, int framesPerSecond)
+{
+	if (this->fp != NULL)
+		return false;
+	this->fp = fopen(file, "wb");
+	if (this->fp == NULL)
+	{
+		printf("Unable to write video to %s\n", file);
+		return false;
+	}
+	this->width = width & ~1;
+	this->height = height & ~1;
+	// full range BT.601 chroma centered between the luma samples, what C420jpeg describes
+	fprintf(this->fp, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", this->width, this->height, framesPerSecond);
+
+	glGenFramebuffers(1, &this->readFbo);
+	for (int i = 0; i < CAPTURE_SLOTS; i++)
+	{
+		glGenBuffers(1, &this->slots[i].pbo);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, this->slots[i].pbo);
+		glBufferData(GL_PIXEL_PACK_BUFFER, this->width * this->height * 4, NULL, GL_STREAM_READ);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	this->first = 0;
+	this->inFlight = 0;
+
+	this->captured = this->written = this->droppedReadback = this->droppedEncoder = 0;
+	this->captureMs = 0.0;
+	this->finishing = false;
+	this->encoder = thread(&VideoCapture::encode, this);
+	return true;
+}
+
+void VideoCapture::stop()
+{
+	if (this->fp == NULL)
+		return;
+
+	collect(true);
+	{
+		lock_guard<mutex> guard(this->lock);
+		this->finishing = true;
+	}
+	this->wake.notify_one();
+	this->encoder.join();
+	fclose(this->fp);
+	this->fp = NULL;
+
+	// readbacks the blocking collect gave up on still hold their fences, and never reach the file
+	this->droppedReadback += this->inFlight;
+	for (int i = 0; i < CAPTURE_SLOTS; i++)
+	{
+		if (this->slots[i].fence != 0)
+		{
+			glDeleteSync(this->slots[i].fence);
+			this->slots[i].fence = 0;
+		}
+		glDeleteBuffers(1, &this->slots[i].pbo);
+		this->slots[i].pbo = 0;
+	}
+	this->inFlight = 0;
+	glDeleteFramebuffers(1, &this->readFbo);
+	this->readFbo = 0;
+	for (unsigned int i = 0; i < this->spare.size(); i++)
+		delete this->spare[i];
+	this->spare.clear();
+
+	unsigned int frames = this->captured + this->droppedReadback;
+	char buff[300];
+	sprintf_s(buff, "Video capture: %u frames written, %u dropped waiting on readback, %u dropped behind the encoder, %.3f ms added per frame\n",
+		this->written, this->droppedReadback, this->droppedEncoder, frames ? this->captureMs / frames : 0.0);
+	OutputDebugStringA(buff);
+	printf("%s", buff);
+}
+
+void VideoCapture::capture(GLuint source)
+{
+	if (this->fp == NULL)
+		return;
+	double start = nowMs();
+
+	collect(false);
+	if (this->inFlight == CAPTURE_SLOTS)
+	{
+		this->droppedReadback++;
+		this->captureMs += nowMs() - start;
+		return;
+	}
+
+	// with a pack buffer bound, glReadPixels only queues the copy and returns
+	Slot& slot = this->slots[(this->first + this->inFlight) % CAPTURE_SLOTS];
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, this->readFbo);
+	glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, source, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadPixels(0, 0, this->width, this->height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	this->inFlight++;
+
+	this->captureMs += nowMs() - start;
+}
+
+void VideoCapture::collect(bool wait)
+{
+	while (this->inFlight > 0)
+	{
+		Slot& slot = this->slots[this->first];
+		// flush so a fence that hasn't reached the GPU yet can still signal while waiting on it
+		GLenum status = glClientWaitSync(slot.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000000000ull : 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			break;
+		glDeleteSync(slot.fence);
+		slot.fence = 0;
+		this->first = (this->first + 1) % CAPTURE_SLOTS;
+		this->inFlight--;
+
+		vector<unsigned char>* pixels = NULL;
+		{
+			lock_guard<mutex> guard(this->lock);
+			if (this->queue.size() < CAPTURE_QUEUE_LIMIT)
+			{
+				if (!this->spare.empty())
+				{
+					pixels = this->spare.back();
+					this->spare.pop_back();
+				}
+				else
+				{
+					pixels = new vector<unsigned char>(this->width * this->height * 4);
+				}
+			}
+		}
+		if (pixels == NULL)
+		{
+			this->droppedEncoder++;
+			continue;
+		}
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+		void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, pixels->size(), GL_MAP_READ_BIT);
+		if (mapped == NULL)
+		{
+			// nothing to unmap and no pixels, the frame is lost with its readback
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			this->droppedReadback++;
+			lock_guard<mutex> guard(this->lock);
+			this->spare.push_back(pixels);
+			continue;
+		}
+		memcpy(&(*pixels)[0], mapped, pixels->size());
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		this->captured++;
+
+		{
+			lock_guard<mutex> guard(this->lock);
+			this->queue.push_back(pixels);
+		}
+		this->wake.notify_one();
+	}
+}
+
+void VideoCapture::encode()
+{
+	int w = this->width, h = this->height;
+	vector<unsigned char> y(w * h), cb(w * h / 4), cr(w * h / 4);
+
+	unique_lock<mutex> guard(this->lock);
+	while (true)
+	{
+		this->wake.wait(guard, [this] { return this->finishing || !this->queue.empty(); });
+		if (this->queue.empty())
+			break;
+		vector<unsigned char>* pixels = this->queue.front();
+		this->queue.pop_front();
+		guard.unlock();
+
+		// fixed point BT.601, chroma averaged over each 2x2 block
+		const unsigned char* rgba = &(*pixels)[0];
+		for (int i = 0; i < w * h; i++)
+		{
+			const unsigned char* p = rgba + i * 4;
+			y[i] = (unsigned char)((77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8);
+		}
+		for (int row = 0; row < h / 2; row++)
+		{
+			for (int col = 0; col < w / 2; col++)
+			{
+				int r = 0, g = 0, b = 0;
+				for (int k = 0; k < 4; k++)
+				{
+					const unsigned char* p = rgba + ((row * 2 + k / 2) * w + col * 2 + k % 2) * 4;
+					r += p[0];
+					g += p[1];
+					b += p[2];
+				}
+				int c = row * (w / 2) + col;
+				cb[c] = (unsigned char)((-43 * r - 85 * g + 128 * b + 4 * 128 * 256 + 512) >> 10);
+				cr[c] = (unsigned char)((128 * r - 107 * g - 21 * b + 4 * 128 * 256 + 512) >> 10);
+			}
+		}
+
+		fputs("FRAME\n", this->fp);
+		fwrite(&y[0], 1, y.size(), this->fp);
+		fwrite(&cb[0], 1, cb.size(), this->fp);
+		fwrite(&cr[0], 1, cr.size(), this->fp);
+
+		guard.lock();
+		this->spare.push_back(pixels);
+		this->written++;
+	}
+}
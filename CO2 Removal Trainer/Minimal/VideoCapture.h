@@ -0,0 +1,68 @@
+#ifndef VIDEO_CAPTURE_H_
+#define VIDEO_CAPTURE_H_
+
+#include <stdio.h>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+using namespace std;
+
+#include <GL/glew.h>
+
+// Pixel pack buffers a readback can stay in flight in before the next frame is dropped
+#define CAPTURE_SLOTS 4
+// Frames read back but not yet written before the encoder is considered behind and frames are dropped
+#define CAPTURE_QUEUE_LIMIT 8
+
+// Records a texture to a raw Y4M video. Each frame is read back into a ring of pixel pack
+// buffers behind a fence, so glReadPixels returns right away; a later frame maps the buffer
+// once its fence has signaled, and an encoder thread converts it to YUV 4:2:0 and writes it.
+// A frame whose readback finds every buffer still in flight is dropped instead of waiting.
+class VideoCapture
+{
+public:
+	VideoCapture();
+	~VideoCapture();
+
+	// Opens file and starts the encoder thread. width and height are rounded down to even for the chroma planes.
+	bool start(const char* file, int width, int height, int framesPerSecond);
+	// Waits for the readbacks in flight and the encoder, then logs the frame counts and the time capture added
+	void stop();
+	bool recording() const { return this->fp != NULL; }
+
+	// Reads back source, stored top row first, and queues it. Called on the render thread once per frame.
+	void capture(GLuint source);
+
+private:
+	struct Slot
+	{
+		GLuint pbo;
+		GLsync fence;
+	};
+
+	FILE* fp;
+	int width, height;
+	GLuint readFbo;
+
+	// slots form a FIFO, the oldest readback in flight is at first
+	Slot slots[CAPTURE_SLOTS];
+	int first, inFlight;
+
+	thread encoder;
+	mutex lock;
+	condition_variable wake;
+	bool finishing;
+	deque<vector<unsigned char>*> queue;
+	vector<vector<unsigned char>*> spare;
+
+	unsigned int captured, written, droppedReadback, droppedEncoder;
+	double captureMs;
+
+	// Maps every readback whose fence has signaled, or all of them when wait is set, and queues it for the encoder
+	void collect(bool wait);
+	void encode();
+};
+
+#endif
@@ -35,6 +35,17 @@ limitations under the License.
 #include "Lights.h"
 #include "Molecule.h"
 #include "Remote.h"
+#include "RenderStats.h"
+#include "Frustum.h"
+#include "RenderQueue.h"
+#include "FrameContext.h"
+#include "SessionRecorder.h"
+#include "EyeTarget.h"
+#include "Foveation.h"
+#include "GpuTimer.h"
+#include "DynamicResolution.h"
+#include "Mirror.h"
+#include "VideoCapture.h"
 #include <ctime>
 
 
@@ -302,6 +313,13 @@ protected:
 		glViewport(pos.x, pos.y, size.x, size.y);
 	}
 
+	// Sends the keys and mouse buttons of another window to this app
+	void forwardInput(GLFWwindow * other) {
+		glfwSetWindowUserPointer(other, this);
+		glfwSetKeyCallback(other, KeyCallback);
+		glfwSetMouseButtonCallback(other, MouseButtonCallback);
+	}
+
 private:
 
 	static void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
@@ -434,13 +452,72 @@ public:
 	ovrLayerEyeFov _sceneLayer;
 	ovrViewScaleDesc _viewScaleDesc;
 
+protected:
+	// eye that the current renderScene call is drawing
+	ovrEyeType currentEye{ ovrEye_Left };
+	// pixel rows the projection of the current renderScene call spans, for screen size based choices
+	float currentPassHeight{ 0.0f };
+	// tracking and input of the frame being drawn
+	FrameContext frameContext;
+	// turns the one controller read per frame into snapshots with press and release events
+	InputSystem input;
+
+	// tracking and input can be streamed to a file and fed back in place of the SDK
+	SessionRecorder recorder;
+	SessionPlayer player;
+
 private:
-	GLuint _fbo{ 0 };
-	GLuint _depthBuffer{ 0 };
+	// multisampled target the eyes are drawn into, resolved into the swap chain texture
+	EyeTarget _eyeTarget;
+	GLsizei _eyeSamples{ 4 };
+	GLenum _eyeDepthFormat{ GL_DEPTH_COMPONENT24 };
+	// index into the sample counts being benchmarked by Shift+M and frames left on the current one
+	int _resolveBenchmark{ -1 };
+	int _resolveBenchmarkFrames{ 0 };
+	GLsizei _resolveSamplesBefore{ 4 };
+	// full density inset over a low resolution periphery, F cycles the level
+	Foveation _foveation;
+	// GPU time of all eye rendering, paused while the resolve benchmark times the eye target itself
+	GpuTimer _eyeTimer;
+	unsigned int _eyeTimerSamples{ 0 };
+	// scales the eye viewports inside the swap chain to hold the frame rate, D toggles it
+	DynamicResolution _resolution{ 0.6f, 1.25f };
+	bool _dynamicResolution{ false };
+	ovrSizei _eyeFullSize[2];
+	FILE* _resolutionLog{ nullptr };
+	int _foveationBenchmark{ -1 };
+	int _foveationBenchmarkFrames{ 0 };
+	int _foveationLevelBefore{ 0 };
+	double _fullDensityMs{ 0.0 };
+	// Camera uniform block, rewritten right before each eye is drawn
+	GLuint _cameraUbo{ 0 };
+	// when the eye poses were last read, right before the eyes were drawn
+	double _latchTime{ 0.0 };
+	// predicted display time minus latch time, summed until the next latency report
+	double _latencySum{ 0.0 };
+	int _latencyFrames{ 0 };
+	// set when recording or replay begins, the scene restarts on the next sampled frame
+	bool _restartPending{ false };
+	// frame intervals and CPU time up to ovr_SubmitFrame of every replayed frame, in ms
+	vector<double> _replayFrameMs;
+	vector<double> _replayCpuMs;
+	double _frameStart{ 0.0 };
 	ovrTextureSwapChain _eyeTexture;
 
-	GLuint _mirrorFbo{ 0 };
 	ovrMirrorTexture _mirrorTexture;
+	// presents the mirror texture in the desktop window from its own thread
+	Mirror _mirror;
+	// records the mirror texture to capture.y4m while toggled on with P
+	VideoCapture _capture;
+	// frame interval and CPU time up to the end of ovr_SubmitFrame of the last frame, in ms
+	double _lastFrameMs{ 0.0 };
+	double _lastSubmitMs{ 0.0 };
+	// Shift+X compares the HMD frame with the mirror off and on, phase and frames left in it
+	int _mirrorBenchmark{ -1 };
+	int _mirrorBenchmarkFrames{ 0 };
+	int _mirrorRateBefore{ 1 };
+	vector<double> _mirrorFrameMs;
+	vector<double> _mirrorSubmitMs;
 
 	ovrEyeRenderDesc _eyeRenderDescs[2];
 
@@ -460,6 +537,7 @@ public:
 		_sceneLayer.Header.Type = ovrLayerType_EyeFov;
 		_sceneLayer.Header.Flags = ovrLayerFlag_TextureOriginAtBottomLeft;
 
+		uvec2 fullSize;
 		ovr::for_each_eye([&](ovrEyeType eye) {
 			ovrEyeRenderDesc& erd = _eyeRenderDescs[eye] = ovr_GetRenderDesc(_session, eye, _hmdDesc.DefaultEyeFov[eye]);
 			ovrMatrix4f ovrPerspectiveProjection =
@@ -468,23 +546,52 @@ public:
 			_viewScaleDesc.HmdToEyeOffset[eye] = erd.HmdToEyeOffset;
 
 			ovrFovPort & fov = _sceneLayer.Fov[eye] = _eyeRenderDescs[eye].Fov;
+			// the swap chain has room for the largest scale, the viewport starts at one texel per display pixel
 			auto eyeSize = ovr_GetFovTextureSize(_session, eye, fov, 1.0f);
+			auto maxSize = ovr_GetFovTextureSize(_session, eye, fov, _resolution.maximum());
+			_eyeFullSize[eye] = eyeSize;
 			_sceneLayer.Viewport[eye].Size = eyeSize;
 			_sceneLayer.Viewport[eye].Pos = { (int)_renderTargetSize.x, 0 };
 
-			_renderTargetSize.y = std::max(_renderTargetSize.y, (uint32_t)eyeSize.h);
-			_renderTargetSize.x += eyeSize.w;
+			_renderTargetSize.y = std::max(_renderTargetSize.y, (uint32_t)maxSize.h);
+			_renderTargetSize.x += maxSize.w;
+			fullSize.y = std::max(fullSize.y, (uint32_t)eyeSize.h);
+			fullSize.x += eyeSize.w;
 		});
-		// Make the on screen window 1/4 the resolution of the render target
-		_mirrorSize = _renderTargetSize;
+		_resolution.setBudget(1000.0 / _hmdDesc.DisplayRefreshRate);
+		// Make the on screen window 1/4 the resolution of the eyes at full density
+		_mirrorSize = fullSize;
 		_mirrorSize /= 4;
 	}
 
 protected:
 	GLFWwindow * createRenderingTarget(uvec2 & outSize, ivec2 & outPosition) override {
+		// the HMD is drawn in the context of a hidden window, the desktop window is opened by the mirror
+		glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
 		return glfw::createWindow(_mirrorSize);
 	}
 
+	void shutdownGl() override {
+		// the mirror thread shares this context's textures, so it has to finish first
+		_capture.stop();
+		_mirror.stop();
+	}
+
+	void finishFrame() override {
+		// nothing to swap, the hidden window is never shown
+		if (glfwWindowShouldClose(_mirror.window())) {
+			glfwSetWindowShouldClose(window, 1);
+		}
+	}
+
+	GLFWwindow * desktopWindow() {
+		return _mirror.window();
+	}
+
+	GpuTimer & eyeTimer() {
+		return _eyeTimer;
+	}
+
 	void initGl() override {
 		GlfwApp::initGl();
 
@@ -523,14 +630,7 @@ protected:
 		glBindTexture(GL_TEXTURE_2D, 0);
 
 		// Set up the framebuffer object
-		glGenFramebuffers(1, &_fbo);
-		glGenRenderbuffers(1, &_depthBuffer);
-		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _fbo);
-		glBindRenderbuffer(GL_RENDERBUFFER, _depthBuffer);
-		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, _renderTargetSize.x, _renderTargetSize.y);
-		glBindRenderbuffer(GL_RENDERBUFFER, 0);
-		glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _depthBuffer);
-		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+		_eyeTarget.create(_renderTargetSize.x, _renderTargetSize.y, _eyeSamples, _eyeDepthFormat);
 
 		ovrMirrorTextureDesc mirrorDesc;
 		memset(&mirrorDesc, 0, sizeof(mirrorDesc));
@@ -540,7 +640,155 @@ protected:
 		if (!OVR_SUCCESS(ovr_CreateMirrorTextureGL(_session, &mirrorDesc, &_mirrorTexture))) {
 			FAIL("Could not create mirror texture");
 		}
-		glGenFramebuffers(1, &_mirrorFbo);
+		if (!_mirror.start(window, _mirrorSize.x, _mirrorSize.y, "CO2 Removal Trainer")) {
+			FAIL("Could not create the mirror window");
+		}
+		forwardInput(_mirror.window());
+
+		glGenBuffers(1, &_cameraUbo);
+		glBindBuffer(GL_UNIFORM_BUFFER, _cameraUbo);
+		glBufferData(GL_UNIFORM_BUFFER, 2 * sizeof(mat4), NULL, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_BINDING, _cameraUbo);
+	}
+
+	// Points the Camera block of a program at the buffer RiftApp keeps up to date
+	void useCameraBlock(GLuint program) {
+		GLuint block = glGetUniformBlockIndex(program, "Camera");
+		if (block != GL_INVALID_INDEX) {
+			glUniformBlockBinding(program, block, CAMERA_BINDING);
+		}
+	}
+
+	// Reads tracking and input once at the top of the frame, for input handling, simulation and
+	// culling. The eyes are drawn with poses read again by latchEyePoses once that work is done.
+	// While a session is replayed the recorded frame stands in for the SDK.
+	void sampleFrame() {
+		double previousStart = _frameStart;
+		_frameStart = ovr_GetTimeInSeconds();
+		frameContext.frame = frame;
+
+		ovrInputState raw;
+		bool hasInput = false;
+		_lastFrameMs = (_frameStart - previousStart) * 1000.0;
+		if (player.playing()) {
+			if (player.next(frameContext, raw, hasInput)) {
+				if (player.framesRead() > 1) {
+					_replayFrameMs.push_back(_lastFrameMs);
+				}
+			}
+			else {
+				finishReplay();
+			}
+		}
+		if (!player.playing()) {
+			frameContext.predictedDisplayTime = ovr_GetPredictedDisplayTime(_session, frame);
+			frameContext.sampleTime = ovr_GetTimeInSeconds();
+			ovrTrackingState trackState = ovr_GetTrackingState(_session, frameContext.predictedDisplayTime, ovrTrue);
+
+			frameContext.headPose = trackState.HeadPose.ThePose;
+			ovr_CalcEyePoses(frameContext.headPose, _viewScaleDesc.HmdToEyeOffset, frameContext.eyePoses);
+			for (int hand = 0; hand < 2; hand++) {
+				frameContext.handPoses[hand] = trackState.HandPoses[hand].ThePose;
+				frameContext.handStatusFlags[hand] = trackState.HandStatusFlags[hand];
+			}
+			hasInput = OVR_SUCCESS(ovr_GetInputState(_session, ovrControllerType_Touch, &raw));
+		}
+
+		// recording and replay both start from a freshly seeded scene, so they see the same molecules
+		if (_restartPending) {
+			srand(player.playing() ? player.seed() : recorder.seed());
+			input.reset();
+			restartSession();
+			_restartPending = false;
+		}
+
+		frameContext.input = input.advance(hasInput ? &raw : NULL);
+		recorder.write(frameContext, hasInput ? &raw : NULL);
+	}
+
+	// Reads the head again right before the eyes are drawn, so the views and the layer's render
+	// poses are predicted from sensor data newer than the input handling and culling before them.
+	// The frustum was built from the poses at the top of the frame, a few milliseconds older.
+	// Replay keeps the recorded poses, so it draws the same frames every time.
+	void latchEyePoses(ovrPosef eyePoses[2]) {
+		if (player.playing()) {
+			eyePoses[ovrEye_Left] = frameContext.eyePoses[ovrEye_Left];
+			eyePoses[ovrEye_Right] = frameContext.eyePoses[ovrEye_Right];
+			_latchTime = frameContext.sampleTime;
+			// recorded sample times are from another run, the compositor has to get the real one
+			_sceneLayer.SensorSampleTime = _frameStart;
+			return;
+		}
+		_latchTime = ovr_GetTimeInSeconds();
+		ovrTrackingState trackState = ovr_GetTrackingState(_session, frameContext.predictedDisplayTime, ovrTrue);
+		ovr_CalcEyePoses(trackState.HeadPose.ThePose, _viewScaleDesc.HmdToEyeOffset, eyePoses);
+		_sceneLayer.SensorSampleTime = _latchTime;
+	}
+
+	// Starts or stops streaming every sampled frame to file
+	void toggleRecording(const char* file) {
+		if (recorder.recording()) {
+			recorder.stop();
+			return;
+		}
+		if (recorder.start(file, (unsigned int)time(NULL))) {
+			_restartPending = true;
+		}
+	}
+
+	// Logs the frame time percentiles of the replay, and closes the app when it was started for a benchmark
+	void finishReplay() {
+		unsigned int frames = player.framesRead();
+		player.close();
+
+		char buff[300];
+		sprintf_s(buff, "Replayed %u frames: frame time p50 %.2f, p95 %.2f, p99 %.2f ms; CPU p50 %.2f, p95 %.2f, p99 %.2f ms\n", frames,
+			percentile(_replayFrameMs, 0.50), percentile(_replayFrameMs, 0.95), percentile(_replayFrameMs, 0.99),
+			percentile(_replayCpuMs, 0.50), percentile(_replayCpuMs, 0.95), percentile(_replayCpuMs, 0.99));
+		OutputDebugStringA(buff);
+		printf("%s", buff);
+		glfwSetWindowShouldClose(window, 1);
+	}
+
+	// Nearest-rank percentile, sorts the samples in place
+	static double percentile(vector<double> & samples, double p) {
+		if (samples.empty()) {
+			return 0.0;
+		}
+		std::sort(samples.begin(), samples.end());
+		size_t rank = (size_t)(p * (samples.size() - 1) + 0.5);
+		return samples[rank];
+	}
+
+	// Uploads the matrices of one eye to the Camera block just before that eye's draws are issued
+	void uploadCamera(const mat4 & projection, const mat4 & view) {
+		glBindBuffer(GL_UNIFORM_BUFFER, _cameraUbo);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(mat4), glm::value_ptr(projection));
+		glBufferSubData(GL_UNIFORM_BUFFER, sizeof(mat4), sizeof(mat4), glm::value_ptr(view));
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+	// Logs the average predicted latency every 90 frames next to the compositor's own measurement
+	void reportLatency() {
+		_latencySum += frameContext.predictedDisplayTime - _latchTime;
+		if (++_latencyFrames < 90) {
+			return;
+		}
+
+		float measured = -1.0f;
+		ovrPerfStats perfStats;
+		if (OVR_SUCCESS(ovr_GetPerfStats(_session, &perfStats)) && perfStats.FrameStatsCount > 0) {
+			measured = perfStats.FrameStats[0].AppMotionToPhotonLatency * 1000.0f;
+		}
+
+		char buff[200];
+		sprintf_s(buff, "Motion-to-photon: %.2f ms predicted at sampling, %.2f ms measured by the compositor\n",
+			_latencySum / _latencyFrames * 1000.0, measured);
+		OutputDebugStringA(buff);
+		printf("%s", buff);
+		_latencySum = 0.0;
+		_latencyFrames = 0;
 	}
 
 	void onKey(int key, int scancode, int action, int mods) override {
@@ -548,42 +796,369 @@ protected:
 		case GLFW_KEY_R:
 			ovr_RecenterTrackingOrigin(_session);
 			return;
+		case GLFW_KEY_M: // cycles the eye buffer MSAA through 1, 2, 4 and 8x, Shift+M benchmarks the resolve of each
+			if (mods & GLFW_MOD_SHIFT) {
+				// the eye target's timers and the foveation benchmark's can't run at the same time
+				if (_foveationBenchmark >= 0 || _foveation.enabled()) {
+					return;
+				}
+				_resolveSamplesBefore = _eyeSamples;
+				_resolveBenchmark = 0;
+				_resolveBenchmarkFrames = 1;
+			}
+			else {
+				configureEyeTarget(_eyeSamples >= 8 ? 1 : _eyeSamples * 2, _eyeDepthFormat);
+			}
+			return;
+		case GLFW_KEY_F: // cycles fixed foveation through off, low, medium and high, Shift+F compares the GPU time of each
+			if (mods & GLFW_MOD_SHIFT) {
+				if (_resolveBenchmark >= 0) {
+					return;
+				}
+				_foveationLevelBefore = _foveation.level();
+				_foveationBenchmark = 0;
+				_foveationBenchmarkFrames = 1;
+			}
+			else {
+				configureFoveation((_foveation.level() + 1) % FOVEATION_LEVELS);
+			}
+			return;
+		case GLFW_KEY_X: // cycles the mirror rate, Ctrl+X cycles its downscale, Shift+X compares the HMD frame with it off and on
+			if (mods & GLFW_MOD_SHIFT) {
+				_mirrorRateBefore = _mirror.rate();
+				_mirrorBenchmark = 0;
+				_mirrorBenchmarkFrames = 1;
+			}
+			else if (mods & GLFW_MOD_CONTROL) {
+				_mirror.setDownscale(_mirror.downscale() >= 4 ? 1 : _mirror.downscale() * 2);
+				char buff[100];
+				sprintf_s(buff, "Mirror at 1/%d size\n", _mirror.downscale());
+				OutputDebugStringA(buff);
+				printf("%s", buff);
+			}
+			else {
+				cycleMirrorRate();
+			}
+			return;
+		case GLFW_KEY_P: // starts or stops recording the mirror view to capture.y4m
+			if (_capture.recording()) {
+				_capture.stop();
+			}
+			else if (_capture.start("capture.y4m", _mirrorSize.x, _mirrorSize.y, (int)(_hmdDesc.DisplayRefreshRate + 0.5f))) {
+				printf("Recording video to capture.y4m\n");
+			}
+			return;
+		case GLFW_KEY_D: // toggles the dynamic resolution controller
+			toggleDynamicResolution();
+			return;
+		case GLFW_KEY_Z: // cycles the eye depth buffer through 24 bit, 32 bit float and 16 bit
+			configureEyeTarget(_eyeSamples, _eyeDepthFormat == GL_DEPTH_COMPONENT24 ? GL_DEPTH_COMPONENT32F :
+				(_eyeDepthFormat == GL_DEPTH_COMPONENT32F ? GL_DEPTH_COMPONENT16 : GL_DEPTH_COMPONENT24));
+			return;
 		}
 
 		GlfwApp::onKey(key, scancode, action, mods);
 	}
 
 	void draw() final override {
+		RenderStats::reset();
+
+		sampleFrame();
+		handleInput();
+
+		// one frustum around both eyes, so the scene is culled once per frame instead of once per eye
+		mat4 leftView = glm::inverse(ovr::toGlm(frameContext.eyePoses[ovrEye_Left]));
+		mat4 rightView = glm::inverse(ovr::toGlm(frameContext.eyePoses[ovrEye_Right]));
+		cullScene(Frustum::stereo(_eyeProjections[ovrEye_Left] * leftView, _eyeProjections[ovrEye_Right] * rightView),
+			_eyeProjections[ovrEye_Left], leftView);
+
 		ovrPosef eyePoses[2];
-		ovr_GetEyePoses(_session, frame, true, _viewScaleDesc.HmdToEyeOffset, eyePoses, &_sceneLayer.SensorSampleTime);
+		latchEyePoses(eyePoses);
 
 		int curIndex;
 		ovr_GetTextureSwapChainCurrentIndex(_session, _eyeTexture, &curIndex);
 		GLuint curTexId;
 		ovr_GetTextureSwapChainBufferGL(_session, _eyeTexture, curIndex, &curTexId);
-		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _fbo);
-		glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, curTexId, 0);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		ovr::for_each_eye([&](ovrEyeType eye) {
-			const auto& vp = _sceneLayer.Viewport[eye];
-			glViewport(vp.Pos.x, vp.Pos.y, vp.Size.w, vp.Size.h);
-			_sceneLayer.RenderPose[eye] = eyePoses[eye];
-			renderScene(_eyeProjections[eye], ovr::toGlm(eyePoses[eye]));
-		});
-		glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
-		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+		bool timingEyes = _resolveBenchmark < 0;
+		if (timingEyes) {
+			_eyeTimer.begin();
+		}
+		if (_foveation.enabled()) {
+			ovr::for_each_eye([&](ovrEyeType eye) {
+				const auto& vp = _sceneLayer.Viewport[eye];
+				_sceneLayer.RenderPose[eye] = eyePoses[eye];
+				currentEye = eye;
+				mat4 view = glm::inverse(ovr::toGlm(eyePoses[eye]));
+
+				_foveation.beginPeriphery(_eyeProjections[eye]);
+				currentPassHeight = _foveation.peripheryRows();
+				uploadCamera(_eyeProjections[eye], view);
+				renderScene(_eyeProjections[eye], ovr::toGlm(eyePoses[eye]));
+
+				mat4 insetProjection = _foveation.beginInset(_eyeProjections[eye]);
+				currentPassHeight = _foveation.insetRows();
+				uploadCamera(insetProjection, view);
+				renderScene(insetProjection, ovr::toGlm(eyePoses[eye]));
+
+				_foveation.composite(curTexId, vp.Pos.x, vp.Pos.y, vp.Size.w, vp.Size.h);
+			});
+		}
+		else {
+			_eyeTarget.bind(curTexId);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			ovr::for_each_eye([&](ovrEyeType eye) {
+				const auto& vp = _sceneLayer.Viewport[eye];
+				glViewport(vp.Pos.x, vp.Pos.y, vp.Size.w, vp.Size.h);
+				_sceneLayer.RenderPose[eye] = eyePoses[eye];
+				currentEye = eye;
+				currentPassHeight = (float)vp.Size.h;
+				uploadCamera(_eyeProjections[eye], glm::inverse(ovr::toGlm(eyePoses[eye])));
+				renderScene(_eyeProjections[eye], ovr::toGlm(eyePoses[eye]));
+			});
+			_eyeTarget.resolve();
+		}
+		if (timingEyes) {
+			_eyeTimer.end();
+		}
 		ovr_CommitTextureSwapChain(_session, _eyeTexture);
 		ovrLayerHeader* headerList = &_sceneLayer.Header;
+		if (player.playing()) {
+			_replayCpuMs.push_back((ovr_GetTimeInSeconds() - _frameStart) * 1000.0);
+		}
 		ovr_SubmitFrame(_session, frame, &_viewScaleDesc, &headerList, 1);
+		_lastSubmitMs = (ovr_GetTimeInSeconds() - _frameStart) * 1000.0;
+		reportLatency();
+		// after the submit, the layer has to describe the viewports this frame was drawn with
+		adjustResolution();
 
 		GLuint mirrorTextureId;
 		ovr_GetMirrorTextureBufferGL(_session, _mirrorTexture, &mirrorTextureId);
-		glBindFramebuffer(GL_READ_FRAMEBUFFER, _mirrorFbo);
-		glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mirrorTextureId, 0);
-		glBlitFramebuffer(0, 0, _mirrorSize.x, _mirrorSize.y, 0, _mirrorSize.y, _mirrorSize.x, 0, GL_COLOR_BUFFER_BIT, GL_NEAREST);
-		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+		_mirror.capture(mirrorTextureId, _mirrorSize.x, _mirrorSize.y, frame);
+		_capture.capture(mirrorTextureId);
+
+		stepResolveBenchmark();
+		stepFoveationBenchmark();
+		stepMirrorBenchmark();
+	}
+
+	// Cycles how often the mirror is updated: every frame, every 2nd, every 4th, then off
+	void cycleMirrorRate() {
+		int rate = _mirror.rate();
+		_mirror.setRate(rate == 0 ? 1 : (rate >= 4 ? 0 : rate * 2));
+
+		char buff[100];
+		if (_mirror.rate() == 0) {
+			sprintf_s(buff, "Mirror off\n");
+		}
+		else {
+			sprintf_s(buff, "Mirror every %d frame(s) at 1/%d size\n", _mirror.rate(), _mirror.downscale());
+		}
+		OutputDebugStringA(buff);
+		printf("%s", buff);
+	}
+
+	// Draws MIRROR_BENCHMARK_FRAMES frames with the mirror off and as many with it updated
+	// every frame, and logs the HMD frame interval and the CPU time up to the end of
+	// ovr_SubmitFrame for both
+	void stepMirrorBenchmark() {
+		static const int MIRROR_BENCHMARK_FRAMES = 300;
+		if (_mirrorBenchmark < 0) {
+			return;
+		}
+		if (_mirrorBenchmark > 0) {
+			_mirrorFrameMs.push_back(_lastFrameMs);
+			_mirrorSubmitMs.push_back(_lastSubmitMs);
+		}
+		if (--_mirrorBenchmarkFrames > 0) {
+			return;
+		}
+
+		if (_mirrorBenchmark > 0) {
+			double frameSum = 0.0, submitSum = 0.0;
+			for (size_t i = 0; i < _mirrorFrameMs.size(); i++) {
+				frameSum += _mirrorFrameMs[i];
+				submitSum += _mirrorSubmitMs[i];
+			}
+			size_t n = _mirrorFrameMs.size();
+			char buff[300];
+			sprintf_s(buff, "Mirror benchmark, mirror %s: frame %.3f ms (p99 %.3f), CPU through submit %.3f ms (p99 %.3f)\n",
+				_mirror.rate() ? "on" : "off", frameSum / n, percentile(_mirrorFrameMs, 0.99), submitSum / n, percentile(_mirrorSubmitMs, 0.99));
+			OutputDebugStringA(buff);
+			printf("%s", buff);
+		}
+		_mirrorFrameMs.clear();
+		_mirrorSubmitMs.clear();
+
+		if (_mirrorBenchmark == 2) {
+			_mirrorBenchmark = -1;
+			_mirror.setRate(_mirrorRateBefore);
+			return;
+		}
+		_mirror.setRate(_mirrorBenchmark == 0 ? 0 : 1);
+		_mirrorBenchmark++;
+		_mirrorBenchmarkFrames = MIRROR_BENCHMARK_FRAMES;
+	}
+
+	// Feeds every newly read back eye GPU time to the controller and resizes the eye viewports
+	// to the scale it picks. The foveation layers have a fixed size, so the scale holds while they're on.
+	void adjustResolution() {
+		if (!_dynamicResolution || _eyeTimer.samples() == _eyeTimerSamples || _eyeTimer.last() < 0.0) {
+			return;
+		}
+		_eyeTimerSamples = _eyeTimer.samples();
+		double gpuMs = _eyeTimer.last();
+		float scale = _foveation.enabled() ? _resolution.scale() : _resolution.update(gpuMs);
+		applyResolution(scale);
+
+		if (_resolutionLog) {
+			fprintf(_resolutionLog, "%u,%.3f,%.3f\n", frame, gpuMs, scale);
+		}
+	}
+
+	void applyResolution(float scale) {
+		int x = 0;
+		ovr::for_each_eye([&](ovrEyeType eye) {
+			_sceneLayer.Viewport[eye].Pos = { x, 0 };
+			_sceneLayer.Viewport[eye].Size.w = (int)(_eyeFullSize[eye].w * scale);
+			_sceneLayer.Viewport[eye].Size.h = (int)(_eyeFullSize[eye].h * scale);
+			// the right eye stays where the largest left eye ends, so the layout never moves
+			x += (int)(_eyeFullSize[eye].w * _resolution.maximum() + 0.5f);
+		});
+	}
+
+	// Starts or stops the resolution controller. While it runs every measured frame goes to
+	// resolution.csv as frame, GPU ms of the eyes, and the scale picked for the next frames.
+	void toggleDynamicResolution() {
+		_dynamicResolution = !_dynamicResolution;
+		if (_dynamicResolution) {
+			_resolution.reset(1.0f);
+			_eyeTimerSamples = _eyeTimer.samples();
+			_resolutionLog = fopen("resolution.csv", "w");
+			if (_resolutionLog) {
+				fprintf(_resolutionLog, "frame,gpu_ms,scale\n");
+			}
+		}
+		else {
+			if (_resolutionLog) {
+				fclose(_resolutionLog);
+				_resolutionLog = nullptr;
+			}
+			_resolution.reset(1.0f);
+			applyResolution(1.0f);
+		}
+
+		char buff[100];
+		sprintf_s(buff, "Dynamic resolution %s, target %.2f ms of GPU time\n", _dynamicResolution ? "on" : "off", _resolution.target());
+		OutputDebugStringA(buff);
+		printf("%s", buff);
+	}
+
+	// Switches the foveation level, level 0 draws the eyes straight into the eye target again
+	void configureFoveation(int level) {
+		_foveation.create(_eyeFullSize[ovrEye_Left].w, _eyeFullSize[ovrEye_Left].h, _eyeSamples, _eyeDepthFormat, level);
+
+		char buff[100];
+		sprintf_s(buff, "Foveation: %s\n", Foveation::levels[_foveation.level()].name);
+		OutputDebugStringA(buff);
+		printf("%s", buff);
+	}
+
+	// Draws FOVEATION_BENCHMARK_FRAMES frames at every foveation level and logs the GPU time of
+	// the eyes for each next to the full density time, then goes back to the level it started with
+	void stepFoveationBenchmark() {
+		static const int FOVEATION_BENCHMARK_FRAMES = 180;
+		if (_foveationBenchmark < 0 || --_foveationBenchmarkFrames > 0) {
+			return;
+		}
+
+		if (_foveationBenchmark > 0) {
+			double ms = _eyeTimer.average();
+			if (_foveation.level() == 0) {
+				_fullDensityMs = ms;
+			}
+			char buff[200];
+			sprintf_s(buff, "Foveation benchmark %s: eyes %.3f ms on the GPU, %.0f%% of full density, over %u frames\n",
+				Foveation::levels[_foveation.level()].name, ms, _fullDensityMs > 0.0 ? ms / _fullDensityMs * 100.0 : 100.0, _eyeTimer.samples());
+			OutputDebugStringA(buff);
+			printf("%s", buff);
+		}
+		if (_foveationBenchmark == FOVEATION_LEVELS) {
+			_foveationBenchmark = -1;
+			configureFoveation(_foveationLevelBefore);
+			return;
+		}
+		configureFoveation(_foveationBenchmark);
+		_eyeTimer.reset();
+		_foveationBenchmark++;
+		_foveationBenchmarkFrames = FOVEATION_BENCHMARK_FRAMES;
+	}
+
+	// Recreates the eye target with a new sample count or depth format and logs the choice
+	void configureEyeTarget(GLsizei samples, GLenum depthFormat) {
+		_eyeTarget.create(_renderTargetSize.x, _renderTargetSize.y, samples, depthFormat);
+		_eyeSamples = _eyeTarget.samples();
+		_eyeDepthFormat = depthFormat;
+		if (_foveation.enabled()) {
+			_foveation.create(_eyeFullSize[ovrEye_Left].w, _eyeFullSize[ovrEye_Left].h, _eyeSamples, _eyeDepthFormat, _foveation.level());
+		}
+
+		char buff[100];
+		sprintf_s(buff, "Eye buffers: %dx MSAA, %s depth\n", _eyeSamples,
+			depthFormat == GL_DEPTH_COMPONENT32F ? "32F" : (depthFormat == GL_DEPTH_COMPONENT24 ? "24 bit" : "16 bit"));
+		OutputDebugStringA(buff);
+		printf("%s", buff);
+	}
+
+	// Draws RESOLVE_BENCHMARK_FRAMES frames at every sample count and logs the GPU time of the
+	// scene and of the resolve for each, then goes back to the sample count it started with
+	void stepResolveBenchmark() {
+		static const GLsizei sampleCounts[] = { 1, 2, 4, 8 };
+		static const int RESOLVE_BENCHMARK_FRAMES = 180;
+		if (_resolveBenchmark < 0 || --_resolveBenchmarkFrames > 0) {
+			return;
+		}
+
+		if (_resolveBenchmark == 0) {
+			_eyeTarget.setTiming(true);
+		}
+		else {
+			char buff[200];
+			sprintf_s(buff, "Resolve benchmark %dx MSAA: scene %.3f ms, resolve %.3f ms over %u frames\n", _eyeTarget.samples(),
+				_eyeTarget.averageDrawTime(), _eyeTarget.averageResolveTime(), _eyeTarget.timedFrames());
+			OutputDebugStringA(buff);
+			printf("%s", buff);
+		}
+		if (_resolveBenchmark == sizeof(sampleCounts) / sizeof(sampleCounts[0])) {
+			_resolveBenchmark = -1;
+			_eyeTarget.setTiming(false);
+			configureEyeTarget(_resolveSamplesBefore, _eyeDepthFormat);
+			return;
+		}
+		_eyeTarget.create(_renderTargetSize.x, _renderTargetSize.y, sampleCounts[_resolveBenchmark], _eyeDepthFormat);
+		_resolveBenchmark++;
+		_resolveBenchmarkFrames = RESOLVE_BENCHMARK_FRAMES;
+	}
+
+	// Called once per frame before either eye is drawn with the combined frustum of both eyes
+	virtual void cullScene(const Frustum & frustum, const glm::mat4 & projection, const glm::mat4 & view) {}
+
+	// Called once per frame after tracking and input are sampled, before either eye is drawn
+	virtual void handleInput() {}
+
+	// Called when recording or replay begins, right after rand() is seeded with the session's seed
+	virtual void restartSession() {}
+
+public:
+	// Replays a recorded session instead of the live tracking, then logs frame time percentiles and quits
+	bool replay(const char* file) {
+		if (!player.open(file)) {
+			return false;
+		}
+		_restartPending = true;
+		return true;
 	}
 
+protected:
 	virtual void renderScene(const glm::mat4 & projection, const glm::mat4 & headPose) = 0;
 };
 
@@ -635,15 +1210,38 @@ namespace Attribute {
 
 
 
+// Feature bits of the scene shader variants, each one adds a #define to shader.vert and shader.frag
+#define VARIANT_SPECULAR 1
+#define VARIANT_TEXTURED 2
+// the per vertex inverse transpose the shader used to do, only built for the variant benchmark
+#define VARIANT_VERTEX_INVERSE 4
+#define SHADER_VARIANTS 8
+
 // An example application that renders a simple cube
 class ExampleApp : public RiftApp {
 	//std::shared_ptr<ColorCubeScene> cubeScene;
 
 public:
 	ExampleApp() { }
+	// the scene variant in use, one of variants[]
 	GLint shaderProgram;
 	GLint trackShader;
 
+	// a scene program built with a set of feature bits, and the light uniforms it kept
+	struct SceneVariant {
+		GLuint program;
+		GLint lightIntensity, lightDirection, lightAmbient, lightSpec, cameraPos;
+	};
+	// built the first time they are used, G cycles the features of the scene
+	SceneVariant variants[SHADER_VARIANTS];
+	int sceneFeatures = 0;
+	// Shift+G: position in the benchmarked variants, frames left on the current one and what it measured
+	int variantBenchmark = -1;
+	int variantBenchmarkFrames = 0;
+	int featuresBefore = 0;
+	unsigned long long variantUploads = 0;
+	unsigned int variantFrames = 0;
+
 	Model* factory;
 	Model* co2;
 	Model* o2;
@@ -652,9 +1250,32 @@ public:
 	Lights* light;
 	vector<Remote*> remotes;
 
-	clock_t begin_time;
+	// sample time of the last spawn, tracking time keeps replays spawning on the same frames
+	double spawnTime = 0.0;
 	bool endState = false;
 
+	// number of upcoming frames whose render stats get logged, set by the B key
+	int statsFrames = 0;
+
+	bool lodEnabled = true;
+	GLuint factoryLod[2] = { 0, 0 };
+	// frames left in the LOD benchmark started by the N key, and the triangle count it measured without LOD
+	int lodBenchmark = 0;
+	unsigned int trisWithoutLod = 0;
+
+	// instances that survived cullScene this frame, only these get drawn
+	bool cullingEnabled = true;
+	bool factoryVisible = true;
+	vector<Molecule*> visibleCo2;
+	vector<Molecule*> visibleO2;
+	// instances covering fewer pixels than this are skipped as too far away to matter
+	float cullPixelSize = 2.0f;
+	int lastVisible = -1, lastTotal = -1;
+
+	// draws are sorted and issued through the queue, Q switches back to the immediate path
+	RenderQueue queue;
+	bool useQueue = true;
+
 protected:
 	void initGl() override {
 		RiftApp::initGl();
@@ -671,6 +1292,17 @@ protected:
 		light = new Lights(1);
 		co2 = new Model("../models/co2/co2.obj");
 		o2 = new Model("../models/o2/o2.obj");
+
+		// levels have to exist before batching so every batch gets a run per level
+		factory->generateLods();
+		co2->generateLods();
+		o2->generateLods();
+
+		// none of the models have per-mesh transforms, so merge their meshes by material
+		factory->buildStaticBatch();
+		co2->buildStaticBatch();
+		o2->buildStaticBatch();
+
 		Molecule* temp;
 
 		// adds 5 molecules with random displacement to the scene
@@ -679,21 +1311,27 @@ protected:
 			co2_mols.push_back(temp);
 		}
 
-		shaderProgram = LoadShaders("../shader.vert", "../shader.frag");
+		for (int i = 0; i < SHADER_VARIANTS; i++) {
+			variants[i].program = 0;
+		}
+		useVariant(sceneFeatures);
 		trackShader = LoadShaders("../trackshader.vert", "../trackshader.frag");
-		begin_time = clock();
+		useCameraBlock(trackShader);
+		ShaderManager::reportStartup();
+		spawnTime = ovr_GetTimeInSeconds();
 
 	}
 
 	void shutdownGl() override {
 		//cubeScene.reset();
+		RiftApp::shutdownGl();
 	}
 
 	void resetState() {
 		co2_mols.clear();
 		o2_mols.clear();
 
-		begin_time = clock();
+		spawnTime = frameContext.sampleTime;
 		endState = false;
 
 		// adds 5 molecules with random displacement to the scene
@@ -709,13 +1347,204 @@ protected:
 		ovr_RecenterTrackingOrigin(_session);
 	}
 
+	void restartSession() override {
+		resetState();
+	}
+
+	// Logs the frame draw() just finished, so a toggle reports the first frame of the new mode
+	void finishFrame() override {
+		RiftApp::finishFrame();
+		if (statsFrames > 0) {
+			RenderStats::report(useQueue ? "render queue" : (factory->useBatches ? "static batches" : "per-mesh draws"));
+			statsFrames--;
+		}
+	}
+
+	void update() override {
+		// a rebuilt program starts over without its block binding and may have moved its uniforms
+		if (ShaderManager::poll()) {
+			for (int i = 0; i < SHADER_VARIANTS; i++) {
+				if (variants[i].program != 0) {
+					useCameraBlock(variants[i].program);
+					findLightUniforms(variants[i]);
+				}
+			}
+			useCameraBlock(trackShader);
+			queue.forgetPrograms();
+			factory->forgetProgram();
+			co2->forgetProgram();
+			o2->forgetProgram();
+		}
+
+		// The stats seen here belong to the frame drawn before this update
+		if (lodBenchmark == 2) {
+			trisWithoutLod = RenderStats::frame.triangles;
+			lodEnabled = true;
+			lodBenchmark = 1;
+		}
+		else if (lodBenchmark == 1) {
+			char buff[200];
+			sprintf_s(buff, "LOD benchmark, %d molecules: %u triangles per frame without LOD, %u with LOD\n",
+				(int)(co2_mols.size() + o2_mols.size()), trisWithoutLod, RenderStats::frame.triangles);
+			OutputDebugStringA(buff);
+			printf("%s", buff);
+			lodBenchmark = 0;
+		}
+		else if (lodBenchmark > 2) {
+			lodBenchmark--;
+		}
+
+		stepVariantBenchmark();
+	}
+
+	// Builds the scene program for a set of VARIANT_ bits on first use and draws the scene with it
+	void useVariant(int features) {
+		SceneVariant& variant = variants[features];
+		if (variant.program == 0) {
+			string defines;
+			if (features & VARIANT_SPECULAR) defines += "#define SPECULAR\n";
+			if (features & VARIANT_TEXTURED) defines += "#define TEXTURED\n";
+			if (features & VARIANT_VERTEX_INVERSE) defines += "#define VERTEX_INVERSE\n";
+			variant.program = LoadShaders("../shader.vert", "../shader.frag", defines.c_str());
+			useCameraBlock(variant.program);
+			findLightUniforms(variant);
+		}
+		sceneFeatures = features;
+		shaderProgram = variant.program;
+	}
+
+	// Light uniforms are looked up once per build, the ones a variant doesn't read stay -1 and are never uploaded
+	void findLightUniforms(SceneVariant& variant) {
+		variant.lightIntensity = glGetUniformLocation(variant.program, "light.intensity");
+		variant.lightDirection = glGetUniformLocation(variant.program, "light.direction");
+		variant.lightAmbient = glGetUniformLocation(variant.program, "light.ambient");
+		variant.lightSpec = glGetUniformLocation(variant.program, "light.spec");
+		variant.cameraPos = glGetUniformLocation(variant.program, "cameraPos");
+	}
+
+	static string variantName(int features) {
+		string name = (features & VARIANT_VERTEX_INVERSE) ? "per vertex normals" : "base";
+		if (features & VARIANT_SPECULAR) name += " +specular";
+		if (features & VARIANT_TEXTURED) name += " +textured";
+		return name;
+	}
+
+	// Draws VARIANT_BENCHMARK_FRAMES frames with each variant, the old per vertex normal matrix first,
+	// and logs the active uniforms, the uniform uploads per frame and the GPU time of the eyes for each
+	void stepVariantBenchmark() {
+		static const int VARIANT_BENCHMARK_FRAMES = 180;
+		static const int order[] = { VARIANT_VERTEX_INVERSE, 0, VARIANT_SPECULAR, VARIANT_TEXTURED, VARIANT_SPECULAR | VARIANT_TEXTURED };
+		static const int variantCount = sizeof(order) / sizeof(order[0]);
+		if (variantBenchmark < 0) {
+			return;
+		}
+		// the stats seen here belong to the frame before, so the first frame of a variant is skipped
+		if (variantBenchmark > 0 && variantBenchmarkFrames < VARIANT_BENCHMARK_FRAMES) {
+			variantUploads += RenderStats::frame.uniformUploads;
+			variantFrames++;
+		}
+		if (--variantBenchmarkFrames > 0) {
+			return;
+		}
+
+		if (variantBenchmark > 0) {
+			GLint activeUniforms = 0;
+			glGetProgramiv(shaderProgram, GL_ACTIVE_UNIFORMS, &activeUniforms);
+			char buff[300];
+			sprintf_s(buff, "Variant benchmark %s: %d active uniforms, %.1f uniform uploads per frame, eyes %.3f ms on the GPU\n",
+				variantName(sceneFeatures).c_str(), activeUniforms, variantFrames ? (double)variantUploads / variantFrames : 0.0, eyeTimer().average());
+			OutputDebugStringA(buff);
+			printf("%s", buff);
+		}
+		if (variantBenchmark == variantCount) {
+			variantBenchmark = -1;
+			useVariant(featuresBefore);
+			return;
+		}
+		useVariant(order[variantBenchmark]);
+		eyeTimer().reset();
+		variantUploads = 0;
+		variantFrames = 0;
+		variantBenchmark++;
+		variantBenchmarkFrames = VARIANT_BENCHMARK_FRAMES + 1;
+	}
+
+	// Starts the LOD benchmark: fills the scene with the 300 molecule end state, draws one
+	// frame at full detail and one with LOD selection, and logs the triangles submitted by each
+	void startLodBenchmark() {
+		endState = true;
+		glClearColor(0.25f, 0.5f, 1.0f, 0.0f);
+		while (co2_mols.size() < 300) {
+			co2_mols.push_back(new Molecule(co2));
+		}
+		for (int i = 0; i < co2_mols.size(); i++) {
+			co2_mols[i]->scatter(100.0f);
+		}
+		lodEnabled = false;
+		lodBenchmark = 3;
+	}
+
+	// Level of detail for a model drawn with the given world matrix into the current eye
+	GLuint pickLod(Model* model, const glm::mat4& world, const glm::mat4& projection, const glm::mat4& view, GLuint current) {
+		if (!lodEnabled) {
+			return 0;
+		}
+		return model->selectLod(model->projectedSize(projection, view, world, currentPassHeight), current);
+	}
+
+	// Whether an instance of the model lands in the frustum and is big enough on screen to draw
+	bool passesCull(Model* model, const glm::mat4& world, const Frustum& frustum, const glm::mat4& projection, const glm::mat4& view) {
+		if (!cullingEnabled) {
+			return true;
+		}
+		if (!model->isVisible(frustum, world)) {
+			return false;
+		}
+		float viewportHeight = (float)_sceneLayer.Viewport[ovrEye_Left].Size.h;
+		return model->projectedSize(projection, view, world, viewportHeight) >= cullPixelSize;
+	}
+
+	void cullScene(const Frustum & frustum, const glm::mat4 & projection, const glm::mat4 & view) override {
+		factoryVisible = passesCull(factory, factory->toWorld, frustum, projection, view);
+
+		// simulate() has already spawned this frame's molecules, so they are culled with the rest
+		visibleCo2.clear();
+		for (int i = 0; i < co2_mols.size(); i++) {
+			if (passesCull(co2, co2_mols[i]->modelMatrix(), frustum, projection, view)) {
+				visibleCo2.push_back(co2_mols[i]);
+			}
+		}
+		visibleO2.clear();
+		for (int i = 0; i < o2_mols.size(); i++) {
+			if (passesCull(o2, o2_mols[i]->modelMatrix(), frustum, projection, view)) {
+				visibleO2.push_back(o2_mols[i]);
+			}
+		}
+
+		int visible = (factoryVisible ? 1 : 0) + (int)(visibleCo2.size() + visibleO2.size());
+		int total = 1 + (int)(co2_mols.size() + o2_mols.size());
+		if (visible != lastVisible || total != lastTotal) {
+			char title[100];
+			sprintf_s(title, "CO2 Removal Trainer - %d / %d objects visible%s", visible, total, cullingEnabled ? "" : " (culling off)");
+			glfwSetWindowTitle(desktopWindow(), title);
+			lastVisible = visible;
+			lastTotal = total;
+		}
+	}
+
+	void handleInput() override {
+		updateRemotes();
+		keyCallback();
+		simulate();
+	}
+
 	void keyCallback() {
-		ovrInputState inputState;
+		const InputSnapshot& inputState = frameContext.input;
 
-		if (OVR_SUCCESS(ovr_GetInputState(_session, ovrControllerType_Touch, &inputState))) {
+		if (inputState.valid) {
 
 			// Left Trigger
-			if (inputState.IndexTrigger[ovrHand_Left] > 0.5f) {
+			if (inputState.held(INPUT_LEFT_INDEX_TRIGGER)) {
 				// Change left line to red
 				remotes[0]->colorVal = vec3(1.0f, 0.0f, 0.0f);
 			}
@@ -726,11 +1555,11 @@ protected:
 			}
 
 			// Right Trigger
-			if (inputState.IndexTrigger[ovrHand_Right] > 0.5f) {
+			if (inputState.held(INPUT_RIGHT_INDEX_TRIGGER)) {
 				// Change right line to red
 				remotes[1]->colorVal = vec3(1.0f, 0.0f, 0.0f);
 
-				if (inputState.IndexTrigger[ovrHand_Left] > 0.5f) {
+				if (inputState.held(INPUT_LEFT_INDEX_TRIGGER)) {
 					// Check for intersection
 					detectCollision();
 				}
@@ -743,38 +1572,9 @@ protected:
 
 			// Every other button should restart game if game is over
 			// If game is still going then do nothing
-			if (inputState.Buttons & ovrButton_A & endState)
-			{
-				resetState();
-			}
-			if (inputState.Buttons & ovrButton_B & endState)
-			{
-				resetState();
-			}
-			if (inputState.Buttons & ovrButton_RThumb & endState)
-			{
-				resetState();
-			}
-			if (inputState.Buttons & ovrButton_X & endState)
-			{
-				resetState();
-			}
-			if (inputState.Buttons & ovrButton_Y & endState)
-			{
-				resetState();
-			}
-			if (inputState.Buttons & ovrButton_LThumb & endState)
-			{
-				resetState();
-			}
-			if (inputState.Buttons & ovrButton_Enter & endState)
-			{
-				resetState();
-			}
-			if (inputState.HandTrigger[ovrHand_Left] > 0.5f && endState) {
-				resetState();
-			}
-			if (inputState.HandTrigger[ovrHand_Right] > 0.5f && endState) {
+			const unsigned int restartButtons = ovrButton_A | ovrButton_B | ovrButton_RThumb | ovrButton_X | ovrButton_Y |
+				ovrButton_LThumb | ovrButton_Enter | INPUT_LEFT_HAND_TRIGGER | INPUT_RIGHT_HAND_TRIGGER;
+			if (endState && inputState.wasPressed(restartButtons)) {
 				resetState();
 			}
 
@@ -825,11 +1625,26 @@ protected:
 
 	}
 
-	void renderScene(const glm::mat4 & projection, const glm::mat4 & headPose) override {
+	// Touch controller schtuff
+	void updateRemotes() {
+		ovrPosef leftHandPose = frameContext.handPoses[ovrHand_Left];
+		ovrPosef rightHandPose = frameContext.handPoses[ovrHand_Right];
+
+		glm::quat myQuat(leftHandPose.Orientation.w, leftHandPose.Orientation.x, leftHandPose.Orientation.y, leftHandPose.Orientation.z);
+
+		remotes[0]->position = ovr::toGlm(leftHandPose.Position);
+		remotes[0]->quat = glm::toMat4(myQuat);
+
+		myQuat = glm::quat(rightHandPose.Orientation.w, rightHandPose.Orientation.x, rightHandPose.Orientation.y, rightHandPose.Orientation.z);
+
+		remotes[1]->position = ovr::toGlm(rightHandPose.Position);
+		remotes[1]->quat = glm::toMat4(myQuat);
+	}
 
+	// Spawns and moves the molecules, once per frame however many passes the eyes are drawn in
+	void simulate() {
 		if (!endState) {
-			clock_t end_time = clock();
-			if (double(end_time - begin_time) / CLOCKS_PER_SEC > 1.0) {
+			if (frameContext.sampleTime - spawnTime > 1.0) {
 				co2_mols.push_back(new Molecule(co2));
 
 				if (co2_mols.size() > 10) {
@@ -839,90 +1654,95 @@ protected:
 					}
 				}
 
-				begin_time = clock();
+				spawnTime = frameContext.sampleTime;
 			}
 		}
-		// update all CO2 molecules
-		for (int i = 0; i < co2_mols.size(); i++) {
-			co2_mols[i]->update(endState);
-		}
+		// two steps per frame, the speed the molecules had back when every eye stepped them
+		for (int step = 0; step < 2; step++) {
+			// update all CO2 molecules
+			for (int i = 0; i < co2_mols.size(); i++) {
+				co2_mols[i]->update(endState);
+			}
 
-		for (int i = 0; i < o2_mols.size(); i++) {
-			o2_mols[i]->update(endState);
+			for (int i = 0; i < o2_mols.size(); i++) {
+				o2_mols[i]->update(endState);
+			}
 		}
+	}
 
+	void renderScene(const glm::mat4 & projection, const glm::mat4 & headPose) override {
+		// projection and view come from the Camera block uploaded by RiftApp
 		glUseProgram(shaderProgram);
+		RenderStats::frame.programBinds++;
 
-		GLuint uProjection = glGetUniformLocation(shaderProgram, "projection");
-		GLuint uModelView = glGetUniformLocation(shaderProgram, "view");
-
-		glUniformMatrix4fv(uProjection, 1, GL_FALSE, glm::value_ptr(projection));
-		glUniformMatrix4fv(uModelView, 1, GL_FALSE, glm::value_ptr(glm::inverse(headPose)));
-
-		// lighting block
-		GLuint MatrixID = glGetUniformLocation(shaderProgram, "light.intensity");
-		glUniform3f(MatrixID, (light->intensity.x), (light->intensity.y), (light->intensity.z));
-
-		MatrixID = glGetUniformLocation(shaderProgram, "light.direction");
-		glUniform3f(MatrixID, (light->direction.x), (light->direction.y), (light->direction.z));
-
-		MatrixID = glGetUniformLocation(shaderProgram, "light.ambient");
-		glUniform1f(MatrixID, light->ambient);
-
-		MatrixID = glGetUniformLocation(shaderProgram, "light.pos");
-		glUniform3f(MatrixID, light->position.x, light->position.y, light->position.z);
-
-		MatrixID = glGetUniformLocation(shaderProgram, "light.spec");
-		glUniform1f(MatrixID, light->specular);
-
-		MatrixID = glGetUniformLocation(shaderProgram, "light.theta");
-		glUniform1f(MatrixID, light->theta);
-
-		MatrixID = glGetUniformLocation(shaderProgram, "light.cosExp");
-		glUniform1f(MatrixID, light->cosExp);
-
-		MatrixID = glGetUniformLocation(shaderProgram, "cameraPos");
-		glUniform3f(MatrixID, (0.0f), (0.0f), (0.0f));
-
-
-		factory->Draw(shaderProgram); // Draw the factory
-
-		// draw all active molecules
-		for (int i = 0; i < co2_mols.size(); i++) {
-			co2_mols[i]->Draw(shaderProgram);
+		// lighting block, only what the variant reads
+		const SceneVariant& variant = variants[sceneFeatures];
+		if (variant.lightIntensity != -1) {
+			glUniform3f(variant.lightIntensity, (light->intensity.x), (light->intensity.y), (light->intensity.z));
+			RenderStats::frame.uniformUploads++;
 		}
-
-		for (int i = 0; i < o2_mols.size(); i++) {
-			o2_mols[i]->Draw(shaderProgram);
+		if (variant.lightDirection != -1) {
+			glUniform3f(variant.lightDirection, (light->direction.x), (light->direction.y), (light->direction.z));
+			RenderStats::frame.uniformUploads++;
+		}
+		if (variant.lightAmbient != -1) {
+			glUniform1f(variant.lightAmbient, light->ambient);
+			RenderStats::frame.uniformUploads++;
+		}
+		if (variant.lightSpec != -1) {
+			glUniform1f(variant.lightSpec, light->specular);
+			RenderStats::frame.uniformUploads++;
+		}
+		if (variant.cameraPos != -1) {
+			glm::vec3 eye = glm::vec3(headPose[3]);
+			glUniform3f(variant.cameraPos, eye.x, eye.y, eye.z);
+			RenderStats::frame.uniformUploads++;
 		}
 
-		// Touch controller schtuff
-		double displayMidpointSeconds = ovr_GetPredictedDisplayTime(_session, frame);
-		ovrTrackingState trackState = ovr_GetTrackingState(_session, displayMidpointSeconds, ovrTrue);
-
-		ovrPosef leftHandPose = trackState.HandPoses[ovrHand_Left].ThePose;
-		ovrPosef rightHandPose = trackState.HandPoses[ovrHand_Right].ThePose;
-
-		glm::quat myQuat(leftHandPose.Orientation.w, leftHandPose.Orientation.x, leftHandPose.Orientation.y, leftHandPose.Orientation.z);
 
-		remotes[0]->position = ovr::toGlm(leftHandPose.Position);
-		remotes[0]->quat = glm::toMat4(myQuat);
+		glm::mat4 view = glm::inverse(headPose);
+		if (useQueue) {
+			queue.begin(projection, view);
+			if (factoryVisible) {
+				factoryLod[currentEye] = pickLod(factory, factory->toWorld, projection, view, factoryLod[currentEye]);
+				factory->Submit(queue, shaderProgram, factory->toWorld, factoryLod[currentEye]);
+			}
+			for (int i = 0; i < visibleCo2.size(); i++) {
+				GLuint& lod = visibleCo2[i]->lod[currentEye];
+				lod = pickLod(co2, visibleCo2[i]->modelMatrix(), projection, view, lod);
+				visibleCo2[i]->Submit(queue, shaderProgram, lod);
+			}
+			for (int i = 0; i < visibleO2.size(); i++) {
+				GLuint& lod = visibleO2[i]->lod[currentEye];
+				lod = pickLod(o2, visibleO2[i]->modelMatrix(), projection, view, lod);
+				visibleO2[i]->Submit(queue, shaderProgram, lod);
+			}
+			remotes[0]->Submit(queue, trackShader);
+			remotes[1]->Submit(queue, trackShader);
+			queue.flush();
+			return;
+		}
 
-		myQuat = glm::quat(rightHandPose.Orientation.w, rightHandPose.Orientation.x, rightHandPose.Orientation.y, rightHandPose.Orientation.z);
+		if (factoryVisible) {
+			factoryLod[currentEye] = pickLod(factory, factory->toWorld, projection, view, factoryLod[currentEye]);
+			factory->Draw(shaderProgram, factoryLod[currentEye]); // Draw the factory
+		}
 
-		remotes[1]->position = ovr::toGlm(rightHandPose.Position);
-		remotes[1]->quat = glm::toMat4(myQuat);
+		// draw the molecules that survived culling
+		for (int i = 0; i < visibleCo2.size(); i++) {
+			GLuint& lod = visibleCo2[i]->lod[currentEye];
+			lod = pickLod(co2, visibleCo2[i]->modelMatrix(), projection, view, lod);
+			visibleCo2[i]->Draw(shaderProgram, lod);
+		}
 
-		// key callback
-		keyCallback();
+		for (int i = 0; i < visibleO2.size(); i++) {
+			GLuint& lod = visibleO2[i]->lod[currentEye];
+			lod = pickLod(o2, visibleO2[i]->modelMatrix(), projection, view, lod);
+			visibleO2[i]->Draw(shaderProgram, lod);
+		}
 
 		glUseProgram(trackShader);
-
-		uProjection = glGetUniformLocation(trackShader, "projection");
-		uModelView = glGetUniformLocation(trackShader, "view");
-
-		glUniformMatrix4fv(uProjection, 1, GL_FALSE, glm::value_ptr(projection));
-		glUniformMatrix4fv(uModelView, 1, GL_FALSE, glm::value_ptr(glm::inverse(headPose)));
+		RenderStats::frame.programBinds++;
 		remotes[0]->Draw(trackShader);
 		remotes[1]->Draw(trackShader);
 
@@ -934,7 +1754,7 @@ protected:
 			co2_mols.clear();
 			o2_mols.clear();
 
-			begin_time = clock();
+			spawnTime = frameContext.sampleTime;
 			endState = false;
 
 			// adds 5 molecules with random displacement to the scene
@@ -946,10 +1766,48 @@ protected:
 
 			ovr_RecenterTrackingOrigin(_session);
 			return;
+		case GLFW_KEY_B: // toggles static batching and logs the draw counts of the last frame and the next one
+			RenderStats::report(factory->useBatches ? "static batches" : "per-mesh draws");
+			factory->useBatches = !factory->useBatches;
+			co2->useBatches = factory->useBatches;
+			o2->useBatches = factory->useBatches;
+			statsFrames = 1;
+			return;
+		case GLFW_KEY_G: // cycles the scene shader features, Shift+G benchmarks every variant
+			if (mods & GLFW_MOD_SHIFT) {
+				featuresBefore = sceneFeatures;
+				variantBenchmark = 0;
+				variantBenchmarkFrames = 1;
+			}
+			else {
+				useVariant((sceneFeatures + 1) & (VARIANT_SPECULAR | VARIANT_TEXTURED));
+				printf("Scene shader: %s\n", variantName(sceneFeatures).c_str());
+			}
+			return;
+		case GLFW_KEY_L: // toggles level of detail selection
+			lodEnabled = !lodEnabled;
+			return;
+		case GLFW_KEY_N: // LOD benchmark on the 300 molecule end state
+			startLodBenchmark();
+			return;
+		case GLFW_KEY_Q: // switches between the render queue and immediate draws, logging the binds of both
+			RenderStats::report(useQueue ? "render queue" : "immediate draws");
+			useQueue = !useQueue;
+			statsFrames = 1;
+			return;
+		case GLFW_KEY_V: // starts or stops recording tracking and input to session.rec
+			toggleRecording("session.rec");
+			return;
+		case GLFW_KEY_I: // records a scripted input session to input_check.rec and checks its replayed press and release events
+			checkInputReplay("input_check.rec");
+			return;
+		case GLFW_KEY_C: // toggles frustum and distance culling
+			cullingEnabled = !cullingEnabled;
+			lastVisible = -1;
+			return;
 		case GLFW_KEY_T: // debug key that prints current head position and orientation
 
-			ovrPosef eyePoses[2];
-			ovr_GetEyePoses(_session, frame, true, _viewScaleDesc.HmdToEyeOffset, eyePoses, &_sceneLayer.SensorSampleTime);
+			const ovrPosef* eyePoses = frameContext.eyePoses;
 
 			char buff[100];
 			sprintf_s(buff, "(%f, %f, %f)\n", eyePoses[0].Position.x, eyePoses[0].Position.y, eyePoses[0].Position.z);
@@ -967,7 +1825,7 @@ protected:
 			return;
 		}
 
-		GlfwApp::onKey(key, scancode, action, mods);
+		RiftApp::onKey(key, scancode, action, mods);
 	}
 };
 
@@ -979,7 +1837,12 @@ int __stdcall WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdL
 		if (!OVR_SUCCESS(ovr_Initialize(nullptr))) {
 			FAIL("Failed to initialize the Oculus SDK");
 		}
-		result = ExampleApp().run();
+		ExampleApp app;
+		// "-replay <file>" plays a recorded session back as a benchmark and quits when it ends
+		if (strncmp(lpCmdLine, "-replay ", 8) == 0 && !app.replay(lpCmdLine + 8)) {
+			FAIL("Failed to open the session to replay");
+		}
+		result = app.run();
 	}
 	catch (std::exception & error) {
 		OutputDebugStringA(error.what());
@@ -1,20 +1,20 @@
 #version 330 core
 
-in vec3 fragVert;
 in vec3 fragNormal;
+#ifdef SPECULAR
+in vec3 fragVert;
+#endif
+#ifdef TEXTURED
 in vec2 TexCoords;
+#endif
 
 out vec4 color;
 
+// only the directional terms, the scene has no point or spot lights
 struct Light {
 	vec3 intensity;
 	vec3 direction;
 	float ambient;
-
-	float theta;
-	float cosExp;
-
-	vec3 pos;
 	float spec;
 };
 
@@ -23,46 +23,41 @@ struct Material {
     vec3 diffuse;
     vec3 specular;
     float shininess;
-}; 
+};
 
+// uniforms a variant doesn't read are stripped by the linker, the CPU skips them by their -1 location
 uniform Material material;
 uniform Light light;
+#ifdef SPECULAR
 uniform vec3 cameraPos;
+#endif
+#ifdef TEXTURED
 uniform sampler2D texture_diffuse1;
+#endif
 
 void main()
 {
-
 	//this block calculates the diffuse color
 	vec3 norm = normalize(fragNormal);
 	vec3 lightDir = normalize(light.direction);
 	float diff = max(dot(norm, lightDir), 0.0f);
-	vec3 diffuseColor = diff * light.intensity;
-	diffuseColor.x = diffuseColor.x * material.diffuse.x;
-	diffuseColor.y = diffuseColor.y * material.diffuse.y;
-	diffuseColor.z = diffuseColor.z * material.diffuse.z;
+	vec3 diffuseColor = diff * light.intensity * material.diffuse;
 
 	//this block calculates ambient color
-	vec3 ambColor = light.ambient * light.intensity;
-	ambColor.x = ambColor.x * material.ambient.x;
-	ambColor.y = ambColor.y * material.ambient.y;
-	ambColor.z = ambColor.z * material.ambient.z;
+	vec3 ambColor = light.ambient * light.intensity * material.ambient;
 
+	vec3 tempCo = ambColor + diffuseColor;
+
+#ifdef SPECULAR
 	//this block calculates the spec color
 	vec3 viewDir = normalize(cameraPos - fragVert);
 	vec3 reflectDir = reflect(-lightDir, norm);
 	float specul = pow(max(dot(viewDir, reflectDir), 0.0), 32);
-	//vec3 specColor = light.spec * specul * light.intensity * material.shininess;
-	vec3 specColor = vec3(0.0f,0.0f,0.0f);
-
-	vec3 tempCo = (ambColor + diffuseColor + specColor);
-	//tempCo.x = tempCo.x * material.objColor.x;
-	//tempCo.y = tempCo.y * material.objColor.y;
-	//tempCo.z = tempCo.z * material.objColor.z;
+	tempCo += light.spec * specul * light.intensity * material.specular;
+#endif
+#ifdef TEXTURED
+	tempCo *= texture(texture_diffuse1, TexCoords).rgb;
+#endif
 
 	color = vec4(tempCo, 1.0f);
-
-
-
-    //color = vec4(diffuseColor, 1.0f);
-}
\ No newline at end of file
+}
@@ -4,22 +4,42 @@ layout (location = 1) in vec3 normal;
 layout (location = 2) in vec2 texCoords;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#ifndef VERTEX_INVERSE
+// inverse transpose of the model's upper 3x3, computed once per instance on the CPU
+uniform mat3 normalMatrix;
+#endif
 
+// shared by every program, updated once per eye
+layout (std140) uniform Camera {
+	mat4 projection;
+	mat4 view;
+};
+
+#ifdef TEXTURED
 out vec2 TexCoords;
+#endif
+#ifdef SPECULAR
 out vec3 fragVert;
+#endif
 out vec3 fragNormal;
 
 void main()
 {
-	fragVert = vec3(model * vec4(position, 1.0f));
+	vec4 worldPos = model * vec4(position, 1.0f);
+#ifdef SPECULAR
+	fragVert = vec3(worldPos);
+#endif
+#ifdef VERTEX_INVERSE
+	// what every vertex used to pay, only built for the variant benchmark
 	mat4 modifier = transpose(inverse(model));
-	vec4 thingy = modifier * vec4(normal, 1.0f);
-	thingy = normalize(thingy);
-	fragNormal = vec3(thingy);
+	fragNormal = vec3(normalize(modifier * vec4(normal, 1.0f)));
+#else
+	// the fragment shader normalizes after interpolation anyway
+	fragNormal = normalMatrix * normal;
+#endif
 
-    gl_Position = projection * view * model * vec4(position, 1.0f);
-	//gl_Position = projection * modelView * vec4(position, 1.0f);
-    TexCoords = texCoords;
-}
\ No newline at end of file
+	gl_Position = projection * view * worldPos;
+#ifdef TEXTURED
+	TexCoords = texCoords;
+#endif
+}
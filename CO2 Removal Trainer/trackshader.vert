@@ -2,8 +2,12 @@
 layout (location = 0) in vec3 position;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+// shared by every program, updated once per eye
+layout (std140) uniform Camera {
+	mat4 projection;
+	mat4 view;
+};
 
 out vec3 fragVert;
 
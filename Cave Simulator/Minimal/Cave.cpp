@@ -45,6 +45,8 @@ void Cave::draw(GLuint shaderProgram, GLuint * tex)
 	GLuint uModel = glGetUniformLocation(shaderProgram, "model");
 
 	glUniformMatrix4fv(uModel, 1, GL_FALSE, &toWorld[0][0]);
+	RenderStats::frame.uniformLookups++;
+	RenderStats::frame.uniformUploads++;
 
 	for (int i = 0; i < faces.size(); i++) {
 		faces[i]->draw(shaderProgram, tex[i]);
@@ -52,3 +54,9 @@ void Cave::draw(GLuint shaderProgram, GLuint * tex)
 	
 }
 
+void Cave::submit(RenderQueue& queue, GLuint shaderProgram, GLuint * tex)
+{
+	for (int i = 0; i < faces.size(); i++) {
+		faces[i]->submit(queue, shaderProgram, toWorld, tex[i]);
+	}
+}
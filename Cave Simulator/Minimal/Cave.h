@@ -13,6 +13,9 @@
 
 #include <windows.h>
 
+#include "RenderStats.h"
+#include "RenderQueue.h"
+
 class Face {
 public:
 	GLuint VAO, VBO;
@@ -113,8 +116,16 @@ public:
 		glBindVertexArray(VAO);
 		glDrawArrays(GL_TRIANGLES, 0, 6);
 		glBindVertexArray(0);
+		RenderStats::frame.drawCalls++;
+		RenderStats::frame.triangles += 2;
+		RenderStats::frame.vaoBinds += 2;
+		RenderStats::frame.textureBinds++;
 
 	}
+	void submit(RenderQueue& queue, GLuint shaderProgram, const glm::mat4& model, GLuint tex) {
+		DrawItem& item = queue.submit(shaderProgram, VAO, GL_TRIANGLES, 0, 6, false, model);
+		queue.setTexture(item, GL_TEXTURE_2D, tex, "caveTex");
+	}
 
 };
 
@@ -125,6 +136,8 @@ public:
 	glm::mat4 toWorld;
 	Cave();
 	void draw(GLuint shaderProgram, GLuint * tex);
+	// Records the walls in a render queue, each textured with the matching entry of tex
+	void submit(RenderQueue& queue, GLuint shaderProgram, GLuint * tex);
 private:
 
 	std::vector<Face*> faces;
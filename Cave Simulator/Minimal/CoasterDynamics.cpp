@@ -0,0 +1,184 @@
+#include "CoasterDynamics.h"
+#include "Profiler.h"
+
+#include <stdio.h>
+#include <math.h>
+#include <Windows.h>
+
+CoasterDynamics::CoasterDynamics()
+	: gravity(9.81f), friction(0.0f), distance(0.0f), speed(0.0f), laps(0),
+	previousDistance(0.0f), accumulator(0.0)
+{
+}
+
+void CoasterDynamics::reset(const TrackSpline& spline, float distance, float speed)
+{
+	this->distance = this->previousDistance = spline.wrap(distance);
+	this->speed = speed;
+	this->laps = 0;
+	this->accumulator = 0.0;
+}
+
+int CoasterDynamics::advance(const TrackSpline& spline, double seconds)
+{
+	if (spline.segmentCount() == 0)
+		return 0;
+	this->accumulator += seconds;
+	int steps = 0;
+	while (this->accumulator >= COASTER_STEP && steps < COASTER_MAX_STEPS)
+	{
+		step(spline, (float)COASTER_STEP);
+		this->accumulator -= COASTER_STEP;
+		steps++;
+	}
+	// after a stall, carry on from here instead of running the whole gap in one frame
+	if (steps == COASTER_MAX_STEPS && this->accumulator >= COASTER_STEP)
+		this->accumulator = fmod(this->accumulator, COASTER_STEP);
+	return steps;
+}
+
+float CoasterDynamics::renderDistance(const TrackSpline& spline) const
+{
+	float alpha = (float)(this->accumulator / COASTER_STEP);
+	return spline.wrap(this->previousDistance + (this->distance - this->previousDistance) * alpha);
+}
+
+float CoasterDynamics::energy(const TrackSpline& spline) const
+{
+	return 0.5f * this->speed * this->speed + this->gravity * spline.position(this->distance).y;
+}
+
+void CoasterDynamics::step(const TrackSpline& spline, float dt)
+{
+	// semi-implicit: the new speed moves the car, which keeps the energy from creeping away
+	float acceleration = -this->gravity * spline.slope(this->distance) - this->friction * this->speed;
+	this->speed += acceleration * dt;
+	float moved = this->speed * dt;
+	float next = this->distance + moved;
+
+	float length = spline.length();
+	if (spline.isClosed())
+	{
+		if (next >= length)
+			this->laps++;
+		else if (next < 0.0f)
+			this->laps--;
+	}
+	else if (next < 0.0f || next > length)
+	{
+		// the buffers at the ends of an open track
+		this->speed = 0.0f;
+		moved = spline.wrap(next) - this->distance;
+	}
+	this->distance = spline.wrap(next);
+	this->previousDistance = this->distance - moved;
+}
+
+// The old coaster: a distance every tick from the height below the highest point, whatever
+// time the tick took. Returns the distance covered.
+static double rideOldTicks(const TrackSpline& spline, float start, int ticks)
+{
+	float highest;
+	spline.highest(highest);
+	float lowest = spline.lowestHeight();
+	float distance = start;
+	double covered = 0.0;
+	for (int i = 0; i < ticks; i++)
+	{
+		float height = glm::max(spline.position(distance).y, lowest);
+		float speed = sqrtf(10.0f * (highest + 0.2f - height)) / 1500.0f * spline.length() / spline.segmentCount();
+		distance = spline.wrap(distance + speed);
+		covered += speed;
+	}
+	return covered;
+}
+
+bool benchmarkCoasterDynamics()
+{
+	static const int LAPS = 10000;
+	static const double RIDE_SECONDS = 60.0;
+	static const int RATES[5] = { 30, 60, 90, 144, 0 };
+	const float startSpeed = 2.0f;
+
+	TrackSpline spline;
+	buildDefaultLoop(spline);
+	float highest;
+	float top = spline.highest(highest);
+	float range = 9.81f * (highest - spline.lowestHeight()) + 0.5f * startSpeed * startSpeed;
+
+	// no friction, so everything the energy does is integration error. Started at the highest
+	// point, the car never goes slower than it started, which bounds the steps the laps take;
+	// twice that is the cap, which a car stalled by a broken integrator runs into instead of
+	// hanging the app
+	CoasterDynamics coaster;
+	coaster.reset(spline, top, startSpeed);
+	float initial = coaster.energy(spline);
+	float drift = 0.0f;
+	long long steps = 0;
+	long long maxSteps = 2 * (long long)(LAPS * spline.length() / (startSpeed * COASTER_STEP)) + 1;
+	double start = Profiler::now();
+	while (coaster.laps < LAPS && steps < maxSteps)
+	{
+		coaster.advance(spline, COASTER_STEP);
+		drift = glm::max(drift, fabsf(coaster.energy(spline) - initial));
+		steps++;
+	}
+	double ms = Profiler::now() - start;
+
+	char buff[300];
+	bool passed = coaster.laps >= LAPS && drift / range <= COASTER_ENERGY_TOLERANCE;
+	if (coaster.laps < LAPS)
+	{
+		sprintf_s(buff, "Coaster dynamics FAIL: %d of %d laps in the most steps they can take (%lld), the car stalled\n",
+			coaster.laps, LAPS, maxSteps);
+	}
+	else
+	{
+		sprintf_s(buff, "Coaster dynamics %s: %d laps in %lld steps (%.0f ms), worst energy drift %.4f%% of the ride's range against a %.2f%% tolerance\n",
+			drift / range <= COASTER_ENERGY_TOLERANCE ? "PASS" : "FAIL", LAPS, steps, ms, drift / range * 100.0, COASTER_ENERGY_TOLERANCE * 100.0);
+	}
+	OutputDebugStringA(buff);
+	printf("%s", buff);
+
+	// a minute of riding with some friction at steady frame rates, and at a jittery one for the 0
+	double reference = 0.0;
+	unsigned int seed = 12345;
+	for (int r = 0; r < 5; r++)
+	{
+		coaster.reset(spline, top, startSpeed);
+		coaster.friction = 0.01f;
+		double elapsed = 0.0;
+		int frames = 0;
+		while (elapsed < RIDE_SECONDS)
+		{
+			double dt;
+			if (RATES[r] > 0)
+			{
+				dt = 1.0 / RATES[r];
+			}
+			else
+			{
+				// anything from 5 to 40 ms
+				seed = seed * 1664525u + 1013904223u;
+				dt = 0.005 + (seed >> 8) * (0.035 / 16777216.0);
+			}
+			dt = glm::min(dt, RIDE_SECONDS - elapsed);
+			coaster.advance(spline, dt);
+			elapsed += dt;
+			frames++;
+		}
+		double covered = (double)coaster.laps * spline.length() + coaster.renderDistance(spline) - top;
+		if (r == 0)
+			reference = covered;
+		double old = rideOldTicks(spline, top, frames);
+		bool same = fabs(covered - reference) <= COASTER_DISTANCE_TOLERANCE * reference;
+		passed = passed && same;
+
+		sprintf_s(buff, "Coaster dynamics %s, %s%d fps: %.3f covered in %.0f s (%+.5f against 30 fps, %.1f%% tolerance), the old ticks %.3f\n",
+			same ? "PASS" : "FAIL", RATES[r] > 0 ? "" : "jittery ", RATES[r] > 0 ? RATES[r] : (int)(frames / RIDE_SECONDS), covered, RIDE_SECONDS,
+			covered - reference, COASTER_DISTANCE_TOLERANCE * 100.0, old);
+		OutputDebugStringA(buff);
+		printf("%s", buff);
+	}
+	return passed;
+}
@@ -0,0 +1,52 @@
+#ifndef COASTERDYNAMICS_H_
+#define COASTERDYNAMICS_H_
+
+#include "TrackSpline.h"
+
+// Seconds of one integration step
+#define COASTER_STEP (1.0 / 240.0)
+// Most steps one advance() runs; a longer stall is dropped rather than caught up on
+#define COASTER_MAX_STEPS 24
+// Largest drift of the energy from its start the benchmark accepts, relative to the ride's range
+#define COASTER_ENERGY_TOLERANCE 0.01
+// Largest difference in distance covered between two frame rates the benchmark accepts, relative
+// to the distance
+#define COASTER_DISTANCE_TOLERANCE 0.001
+
+// Moves the car along a TrackSpline by arc length with gravity and friction, in fixed steps of
+// semi-implicit Euler so the ride is the same at any frame rate. Speed is signed: a car that
+// can't crest a hill rolls back down on its own. advance() keeps the time left over from the
+// last step, and renderDistance() places the car that far between the last two steps.
+class CoasterDynamics
+{
+public:
+	CoasterDynamics();
+
+	void reset(const TrackSpline& spline, float distance, float speed);
+	// Runs the steps the elapsed seconds cover and returns how many
+	int advance(const TrackSpline& spline, double seconds);
+	float renderDistance(const TrackSpline& spline) const;
+	// Kinetic plus potential energy per unit mass
+	float energy(const TrackSpline& spline) const;
+
+	float gravity;	// track units per second squared
+	float friction;	// deceleration per unit of speed, per second
+	float distance;	// wrapped onto the track
+	float speed;	// along the track, negative going backwards
+	int laps;	// times distance wrapped forwards, less the times it wrapped backwards
+
+private:
+	float previousDistance;	// before the last step, unwrapped relative to distance
+	double accumulator;
+
+	void step(const TrackSpline& spline, float dt);
+};
+
+// Rides the default loop without friction for 10000 laps and checks the worst energy drift
+// against COASTER_ENERGY_TOLERANCE, then checks that a minute of riding covers the same distance
+// at several frame rates, including a jittery one, against COASTER_DISTANCE_TOLERANCE, next to
+// the old fixed distance per tick. Logs PASS or FAIL for each and returns whether all passed.
+// Needs no GL, run with -coaster-check on the command line.
+bool benchmarkCoasterDynamics();
+
+#endif
@@ -0,0 +1,78 @@
+#include "CoasterScene.h"
+#include "RenderStats.h"
+#include "Profiler.h"
+
+#include <math.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+CoasterScene::CoasterScene()
+	: carNode(-1), seatNode(-1), shader(0), uModel(-1), uView(-1), uProjection(-1), uColor(-1)
+{
+}
+
+void CoasterScene::initialize(GLuint lineShader)
+{
+	this->shader = lineShader;
+	forgetProgram();
+
+	buildDefaultLoop(this->spline);
+	// the only upload, update() finds nothing changed afterwards
+	this->mesh.update(this->spline);
+
+	// from the top with the speed the desktop coaster had there
+	float highest;
+	float top = this->spline.highest(highest);
+	this->dynamics.reset(this->spline, top, sqrtf(2.0f * this->dynamics.gravity * 0.2f));
+	this->camera.build(this->spline);
+	this->camera.reset(this->spline, top);
+
+	this->carNode = this->graph.add(SCENE_ROOT, this->camera.transform());
+	this->seatNode = this->graph.add(this->carNode, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, COASTER_SEAT_HEIGHT, 0.0f)));
+	this->graph.update();
+}
+
+void CoasterScene::update(double seconds)
+{
+	PROFILE_SCOPE("coaster");
+	this->dynamics.advance(this->spline, seconds);
+	this->mesh.update(this->spline);
+	this->camera.update(this->spline, this->dynamics.renderDistance(this->spline), this->dynamics.speed, (float)seconds);
+	this->graph.setLocal(this->carNode, this->camera.transform());
+	this->graph.update();
+}
+
+const glm::mat4& CoasterScene::ride() const
+{
+	return this->graph.world(this->seatNode);
+}
+
+void CoasterScene::draw(const glm::mat4& projection, const glm::mat4& view)
+{
+	if (this->uView == -1)
+	{
+		this->uModel = glGetUniformLocation(this->shader, "model");
+		this->uView = glGetUniformLocation(this->shader, "view");
+		this->uProjection = glGetUniformLocation(this->shader, "projection");
+		this->uColor = glGetUniformLocation(this->shader, "colorVal");
+		RenderStats::frame.uniformLookups += 4;
+	}
+
+	glUseProgram(this->shader);
+	glUniformMatrix4fv(this->uModel, 1, GL_FALSE, glm::value_ptr(glm::mat4(1.0f)));
+	glUniformMatrix4fv(this->uView, 1, GL_FALSE, glm::value_ptr(view));
+	glUniformMatrix4fv(this->uProjection, 1, GL_FALSE, glm::value_ptr(projection));
+	glUniform3f(this->uColor, 0.9f, 0.6f, 0.1f);
+	RenderStats::frame.programBinds++;
+	RenderStats::frame.uniformUploads += 4;
+
+	// core profile lines are one pixel wide, anything wider is an error in a forward compatible context
+	this->mesh.draw();
+	RenderStats::frame.vaoBinds++;
+	RenderStats::frame.drawCalls++;
+}
+
+void CoasterScene::forgetProgram()
+{
+	this->uModel = this->uView = this->uProjection = this->uColor = -1;
+}
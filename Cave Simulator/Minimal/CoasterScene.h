@@ -0,0 +1,51 @@
+#ifndef COASTERSCENE_H_
+#define COASTERSCENE_H_
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "TrackSpline.h"
+#include "TrackMesh.h"
+#include "CoasterDynamics.h"
+#include "SceneGraph.h"
+#include "RideCamera.h"
+
+// Height of the rider's eyes above the rail, the tracking origin sits at eye level
+#define COASTER_SEAT_HEIGHT 1.0f
+// Frames the frame time budget is averaged over before it's logged
+#define COASTER_BUDGET_FRAMES 90
+
+// The roller coaster of the desktop build hosted in the headset: the default loop, ridden by
+// CoasterDynamics, with the whole tracking space carried along on the car. The car and the seat
+// on it are SceneGraph nodes, and the seat's world matrix is what the head pose is composed onto.
+// The car takes its orientation from a RideCamera, so the smoothing is in the seat before any eye
+// is drawn and the frame being rendered is the one just simulated.
+// The track is tessellated into its TrackMesh once and every eye and wall draws that buffer.
+class CoasterScene
+{
+public:
+	CoasterScene();
+
+	void initialize(GLuint lineShader);
+	// Advances the ride by the frame's elapsed seconds, once a frame before any eye is drawn
+	void update(double seconds);
+	// Seat to world, the ride camera
+	const glm::mat4& ride() const;
+	// Draws the track with a view that already has the ride composed in
+	void draw(const glm::mat4& projection, const glm::mat4& view);
+	// Uniform locations are looked up again on the next draw
+	void forgetProgram();
+
+	TrackSpline spline;
+	TrackMesh mesh;
+	CoasterDynamics dynamics;
+	SceneGraph graph;
+	RideCamera camera;
+
+private:
+	int carNode, seatNode;
+	GLuint shader;
+	GLint uModel, uView, uProjection, uColor;
+};
+
+#endif
@@ -1,6 +1,9 @@
 
 #include "Window.h"
 #include "Cube.h"
+#include "RenderStats.h"
+#include "RenderQueue.h"
+#include "UnitCube.h"
 
 unsigned char* loadPPM(const char* filename, int& width, int& height)
 {
@@ -58,53 +61,6 @@ Cube::Cube()
 {
 	toWorld = glm::mat4(1.0f);
 	scaler = 10.0f;
-	float scaleVal = 0.01f;
-
-	GLfloat skyboxVertices[] = {
-		// Positions          
-		-scaleVal,  scaleVal, -scaleVal,
-		-scaleVal, -scaleVal, -scaleVal,
-		scaleVal, -scaleVal, -scaleVal,
-		scaleVal, -scaleVal, -scaleVal,
-		scaleVal,  scaleVal, -scaleVal,
-		-scaleVal,  scaleVal, -scaleVal,
-
-		-scaleVal, -scaleVal,  scaleVal,
-		-scaleVal, -scaleVal, -scaleVal,
-		-scaleVal,  scaleVal, -scaleVal,
-		-scaleVal,  scaleVal, -scaleVal,
-		-scaleVal,  scaleVal,  scaleVal,
-		-scaleVal, -scaleVal,  scaleVal,
-
-		scaleVal, -scaleVal, -scaleVal,
-		scaleVal, -scaleVal,  scaleVal,
-		scaleVal,  scaleVal,  scaleVal,
-		scaleVal,  scaleVal,  scaleVal,
-		scaleVal,  scaleVal, -scaleVal,
-		scaleVal, -scaleVal, -scaleVal,
-
-		-scaleVal, -scaleVal,  scaleVal,
-		-scaleVal,  scaleVal,  scaleVal,
-		scaleVal,  scaleVal,  scaleVal,
-		scaleVal,  scaleVal,  scaleVal,
-		scaleVal, -scaleVal,  scaleVal,
-		-scaleVal, -scaleVal,  scaleVal,
-
-		-scaleVal,  scaleVal, -scaleVal,
-		scaleVal,  scaleVal, -scaleVal,
-		scaleVal,  scaleVal,  scaleVal,
-		scaleVal,  scaleVal,  scaleVal,
-		-scaleVal,  scaleVal,  scaleVal,
-		-scaleVal,  scaleVal, -scaleVal,
-
-		-scaleVal, -scaleVal, -scaleVal,
-		-scaleVal, -scaleVal,  scaleVal,
-		scaleVal, -scaleVal, -scaleVal,
-		scaleVal, -scaleVal, -scaleVal,
-		-scaleVal, -scaleVal,  scaleVal,
-		scaleVal, -scaleVal,  scaleVal
-	};
-
 	//list of names for skybox
 	skybox_faces.push_back("vr_test_pattern.ppm");
 	skybox_faces.push_back("vr_test_pattern.ppm");
@@ -112,15 +68,7 @@ Cube::Cube()
 	skybox_faces.push_back("vr_test_pattern.ppm");
 	skybox_faces.push_back("vr_test_pattern.ppm");
 	skybox_faces.push_back("vr_test_pattern.ppm");
-	// Setup skybox VAO
-	glGenVertexArrays(1, &skyboxVAO);
-	glGenBuffers(1, &skyboxVBO);
-	glBindVertexArray(skyboxVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
-	glBindVertexArray(0);
+	skyboxVAO = UnitCube::vao();
 	skyboxTexture = loadCubemap(skybox_faces);
 }
 
@@ -159,7 +107,7 @@ void Cube::draw(GLuint shaderProgram)
 {
 	GLuint uModel = glGetUniformLocation(shaderProgram, "model");
 	glm::mat4 model = glm::translate(toWorld, glm::vec3(0.0f, 0.0f, -0.3f));
-	model = glm::scale(model, glm::vec3(scaler, scaler, scaler));
+	model = glm::scale(model, glm::vec3(scaler * CUBE_HALF_SIZE));
 
 	glUniformMatrix4fv(uModel, 1, GL_FALSE, &model[0][0]);
 
@@ -169,12 +117,27 @@ void Cube::draw(GLuint shaderProgram)
 	glUniform1i(glGetUniformLocation(shaderProgram, "skybox"), 0);
 
 	glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxTexture);
-	glDrawArrays(GL_TRIANGLES, 0, 36);
+	glDrawArrays(GL_TRIANGLES, 0, UNIT_CUBE_VERTICES);
 	glBindVertexArray(0);
+	RenderStats::frame.drawCalls++;
+	RenderStats::frame.triangles += 12;
+	RenderStats::frame.vaoBinds += 2;
+	RenderStats::frame.textureBinds++;
+	RenderStats::frame.uniformLookups += 2;
+	RenderStats::frame.uniformUploads += 2;
 
 	glDepthMask(GL_TRUE);
 }
 
+void Cube::submit(RenderQueue& queue, GLuint shaderProgram)
+{
+	glm::mat4 model = glm::translate(toWorld, glm::vec3(0.0f, 0.0f, -0.3f));
+	model = glm::scale(model, glm::vec3(scaler * CUBE_HALF_SIZE));
+
+	DrawItem& item = queue.submit(shaderProgram, skyboxVAO, GL_TRIANGLES, 0, UNIT_CUBE_VERTICES, false, model);
+	queue.setTexture(item, GL_TEXTURE_CUBE_MAP, skyboxTexture, "skybox");
+}
+
 void Cube::scale(float scaleVal) {
 	scaler += scaleVal;
 	if (scaler < 1.0f) scaler = 1.0f;
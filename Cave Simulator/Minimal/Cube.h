@@ -6,6 +6,11 @@
 
 #include <vector>
 
+class RenderQueue;
+
+// Half the edge of the cube at a scaler of 1
+#define CUBE_HALF_SIZE 0.01f
+
 class Cube
 {
 
@@ -14,6 +19,7 @@ public:
 	Cube();
 	float scaler;
 	void draw(GLuint shaderProgram);
+	void submit(RenderQueue& queue, GLuint shaderProgram);
 	void scale(float);
 	void translateLEFTRIGHT(float);
 	void translateUPDOWN(float);
@@ -21,7 +27,7 @@ public:
 	void resetScale();
 private:
 
-	GLuint skyboxVAO, skyboxVBO;
+	GLuint skyboxVAO;	// the shared UnitCube
 	GLuint skyboxTexture;
 	std::vector<const GLchar*> skybox_faces;
 
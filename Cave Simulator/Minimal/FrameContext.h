@@ -0,0 +1,23 @@
+#ifndef FRAMECONTEXT_H_
+#define FRAMECONTEXT_H_
+
+#include <OVR_CAPI.h>
+
+#include "Input.h"
+
+// Tracking and input for one frame, sampled once by RiftApp at the top of the frame.
+// Everything that simulates or culls the frame reads from here instead of polling the SDK,
+// so all of it agrees on a single set of poses predicted for the same display time. The eyes
+// themselves are drawn with the head read again just before them.
+struct FrameContext {
+	unsigned int frame;
+	double sampleTime;				// ovr_GetTimeInSeconds when tracking was read
+	double predictedDisplayTime;	// when the frame is expected to reach the display
+	ovrPosef headPose;
+	ovrPosef eyePoses[2];
+	ovrPosef handPoses[2];
+	unsigned int handStatusFlags[2];
+	InputSnapshot input;
+};
+
+#endif
@@ -0,0 +1,54 @@
+#include "Input.h"
+
+#include <string.h>
+
+InputSystem::InputSystem()
+{
+	reset();
+}
+
+void InputSystem::reset()
+{
+	memset(&snapshot, 0, sizeof(snapshot));
+}
+
+const InputSnapshot& InputSystem::poll(ovrSession session)
+{
+	ovrInputState raw;
+	if (OVR_SUCCESS(ovr_GetInputState(session, ovrControllerType_Touch, &raw)))
+		return advance(&raw);
+	return advance(NULL);
+}
+
+const InputSnapshot& InputSystem::advance(const ovrInputState* raw)
+{
+	unsigned int previous = snapshot.buttons;
+	memset(&snapshot, 0, sizeof(snapshot));
+
+	if (raw != NULL)
+	{
+		snapshot.valid = true;
+		snapshot.time = raw->TimeInSeconds;
+		snapshot.buttons = raw->Buttons;
+		snapshot.touches = raw->Touches;
+		for (int hand = 0; hand < ovrHand_Count; hand++)
+		{
+			snapshot.indexTrigger[hand] = raw->IndexTrigger[hand];
+			snapshot.handTrigger[hand] = raw->HandTrigger[hand];
+			snapshot.thumbstick[hand] = raw->Thumbstick[hand];
+		}
+
+		if (raw->IndexTrigger[ovrHand_Left] > INPUT_TRIGGER_THRESHOLD)
+			snapshot.buttons |= INPUT_LEFT_INDEX_TRIGGER;
+		if (raw->IndexTrigger[ovrHand_Right] > INPUT_TRIGGER_THRESHOLD)
+			snapshot.buttons |= INPUT_RIGHT_INDEX_TRIGGER;
+		if (raw->HandTrigger[ovrHand_Left] > INPUT_TRIGGER_THRESHOLD)
+			snapshot.buttons |= INPUT_LEFT_HAND_TRIGGER;
+		if (raw->HandTrigger[ovrHand_Right] > INPUT_TRIGGER_THRESHOLD)
+			snapshot.buttons |= INPUT_RIGHT_HAND_TRIGGER;
+	}
+
+	snapshot.pressed = snapshot.buttons & ~previous;
+	snapshot.released = previous & ~snapshot.buttons;
+	return snapshot;
+}
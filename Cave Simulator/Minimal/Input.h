@@ -0,0 +1,55 @@
+#ifndef INPUT_H_
+#define INPUT_H_
+
+#include <OVR_CAPI.h>
+
+// Trigger travel that counts as pulled, the threshold every trigger check in the app used
+#define INPUT_TRIGGER_THRESHOLD 0.5f
+
+// Triggers pulled past the threshold show up as these bits next to the ovrButton ones,
+// so they get the same press and release events as real buttons
+#define INPUT_LEFT_INDEX_TRIGGER	0x10000000u
+#define INPUT_RIGHT_INDEX_TRIGGER	0x20000000u
+#define INPUT_LEFT_HAND_TRIGGER		0x40000000u
+#define INPUT_RIGHT_HAND_TRIGGER	0x80000000u
+
+// Controller state of one frame. Handed out by InputSystem and never changed afterwards.
+struct InputSnapshot
+{
+	bool valid;					// false when the controllers couldn't be read, everything reads as released then
+	double time;				// ovrInputState::TimeInSeconds
+	unsigned int buttons;		// ovrButton and INPUT_*_TRIGGER bits held this frame
+	unsigned int pressed;		// bits that went down since the previous snapshot
+	unsigned int released;		// bits that went up since the previous snapshot
+	unsigned int touches;		// ovrTouch bits
+	float indexTrigger[ovrHand_Count];
+	float handTrigger[ovrHand_Count];
+	ovrVector2f thumbstick[ovrHand_Count];
+
+	bool held(unsigned int mask) const { return (buttons & mask) != 0; }
+	bool wasPressed(unsigned int mask) const { return (pressed & mask) != 0; }
+	bool wasReleased(unsigned int mask) const { return (released & mask) != 0; }
+};
+
+// Turns one raw controller read per frame into snapshots with edge events. The raw state
+// can come from the Touch controllers or from a recorded stream, so everything that reacts
+// to input behaves the same when a session is replayed.
+class InputSystem
+{
+public:
+	InputSystem();
+
+	// Reads the Touch controllers once and advances to the next snapshot
+	const InputSnapshot& poll(ovrSession session);
+	// Advances with a state read elsewhere, null when no controller could be read
+	const InputSnapshot& advance(const ovrInputState* raw);
+	// Forgets the previous frame, so buttons held right now count as newly pressed
+	void reset();
+
+	const InputSnapshot& current() const { return snapshot; }
+
+private:
+	InputSnapshot snapshot;
+};
+
+#endif
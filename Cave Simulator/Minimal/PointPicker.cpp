@@ -0,0 +1,158 @@
+#include "PointPicker.h"
+#include "Profiler.h"
+
+#include <stdio.h>
+#include <Windows.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+PointPicker::PointPicker()
+	: candidates(0)
+{
+}
+
+int PointPicker::cell(float ndc)
+{
+	int c = (int)((ndc + 1.0f) * 0.5f * PICK_GRID_SIZE);
+	return glm::clamp(c, 0, PICK_GRID_SIZE - 1);
+}
+
+void PointPicker::update(const glm::mat4& viewProjection, const glm::vec3* points, int count)
+{
+	this->screen.resize(count);
+	this->cellOf.resize(count);
+	this->cellStart.assign(PICK_GRID_SIZE * PICK_GRID_SIZE + 1, 0);
+
+	for (int i = 0; i < count; i++)
+	{
+		glm::vec4 clip = viewProjection * glm::vec4(points[i], 1.0f);
+		this->cellOf[i] = -1;
+		if (clip.w <= 0.0f)
+			continue;
+		glm::vec2 ndc(clip.x / clip.w, clip.y / clip.w);
+		this->screen[i] = ndc;
+		if (ndc.x < -1.0f || ndc.x > 1.0f || ndc.y < -1.0f || ndc.y > 1.0f)
+			continue;
+		this->cellOf[i] = cell(ndc.y) * PICK_GRID_SIZE + cell(ndc.x);
+		this->cellStart[this->cellOf[i] + 1]++;
+	}
+
+	// counts into offsets, then every point into its cell's run
+	for (int c = 0; c < PICK_GRID_SIZE * PICK_GRID_SIZE; c++)
+		this->cellStart[c + 1] += this->cellStart[c];
+	this->cellPoints.resize(this->cellStart.back());
+	vector<int> fill(this->cellStart.begin(), this->cellStart.end() - 1);
+	for (int i = 0; i < count; i++)
+	{
+		if (this->cellOf[i] >= 0)
+			this->cellPoints[fill[this->cellOf[i]]++] = i;
+	}
+}
+
+int PointPicker::pick(const glm::vec2& ndc, float radius)
+{
+	this->candidates = 0;
+	if (this->cellStart.empty())
+		return -1;
+	int found = -1;
+	float best = radius * radius;
+	int x0 = cell(ndc.x - radius), x1 = cell(ndc.x + radius);
+	int y0 = cell(ndc.y - radius), y1 = cell(ndc.y + radius);
+	for (int y = y0; y <= y1; y++)
+	{
+		for (int x = x0; x <= x1; x++)
+		{
+			int c = y * PICK_GRID_SIZE + x;
+			for (int k = this->cellStart[c]; k < this->cellStart[c + 1]; k++)
+			{
+				int i = this->cellPoints[k];
+				glm::vec2 diff = this->screen[i] - ndc;
+				float distance = glm::dot(diff, diff);
+				this->candidates++;
+				if (distance < best)
+				{
+					best = distance;
+					found = i;
+				}
+			}
+		}
+	}
+	return found;
+}
+
+void benchmarkPointPicker()
+{
+	static const int POINTS = 10000;
+	static const int FRAMES = 100;
+	static const int PICKS_PER_FRAME = 10;
+	static const float RADIUS = 0.035f;
+
+	// control points scattered through the view, with the projection of the coaster window
+	unsigned int seed = 12345;
+	vector<glm::vec3> points(POINTS);
+	for (int i = 0; i < POINTS; i++)
+	{
+		float v[3];
+		for (int k = 0; k < 3; k++)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			v[k] = (seed >> 8) * (1.0f / 16777216.0f);
+		}
+		points[i] = glm::vec3(v[0] * 40.0f - 20.0f, v[1] * 40.0f - 20.0f, -v[2] * 60.0f);
+	}
+	glm::mat4 viewProjection = glm::perspective(45.0f, 1.0f, 0.1f, 1000.0f) *
+		glm::lookAt(glm::vec3(0.0f, 0.0f, 20.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	PointPicker picker;
+	double linearMs = 0.0, updateMs = 0.0, pickMs = 0.0;
+	unsigned int hits = 0, mismatches = 0, candidates = 0;
+	for (int f = 0; f < FRAMES; f++)
+	{
+		double start = Profiler::now();
+		picker.update(viewProjection, &points[0], POINTS);
+		updateMs += Profiler::now() - start;
+
+		for (int p = 0; p < PICKS_PER_FRAME; p++)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			glm::vec2 mouse((seed >> 20) / 2048.0f - 1.0f, ((seed >> 8) & 0xFFF) / 2048.0f - 1.0f);
+
+			start = Profiler::now();
+			int found = picker.pick(mouse, RADIUS);
+			pickMs += Profiler::now() - start;
+			candidates += picker.candidates;
+
+			// every point projected again for every pick, keeping the closest for the comparison
+			start = Profiler::now();
+			int closest = -1;
+			float best = RADIUS * RADIUS;
+			for (int i = 0; i < POINTS; i++)
+			{
+				glm::vec4 clip = viewProjection * glm::vec4(points[i], 1.0f);
+				if (clip.w <= 0.0f)
+					continue;
+				glm::vec2 ndc(clip.x / clip.w, clip.y / clip.w);
+				if (ndc.x < -1.0f || ndc.x > 1.0f || ndc.y < -1.0f || ndc.y > 1.0f)
+					continue;
+				glm::vec2 diff = ndc - mouse;
+				if (glm::dot(diff, diff) < best)
+				{
+					best = glm::dot(diff, diff);
+					closest = i;
+				}
+			}
+			linearMs += Profiler::now() - start;
+
+			if (found >= 0)
+				hits++;
+			if (found != closest)
+				mismatches++;
+		}
+	}
+
+	int picks = FRAMES * PICKS_PER_FRAME;
+	char buff[300];
+	sprintf_s(buff, "Point picker, %d points: projecting all per pick %.4f ms, grid %.4f ms per frame + %.4f ms per pick over %.1f points, %u of %d picks hit, %u differ\n",
+		POINTS, linearMs / picks, updateMs / FRAMES, pickMs / picks, (double)candidates / picks, hits, picks, mismatches);
+	OutputDebugStringA(buff);
+	printf("%s", buff);
+}
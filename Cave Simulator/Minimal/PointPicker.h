@@ -0,0 +1,41 @@
+#ifndef POINTPICKER_H_
+#define POINTPICKER_H_
+
+#include <vector>
+using namespace std;
+
+#include <glm/glm.hpp>
+
+// Grid cells across normalized device coordinates in each direction
+#define PICK_GRID_SIZE 32
+
+// Finds the control point under the cursor. update() projects every point once a frame and
+// files the ones in front of the camera and on screen into a uniform grid over NDC with a
+// counting sort; pick() then only looks at the few cells the pick radius reaches, and answers
+// with the closest point instead of whichever one was looked at last.
+class PointPicker
+{
+public:
+	PointPicker();
+
+	void update(const glm::mat4& viewProjection, const glm::vec3* points, int count);
+	// Index of the point closest to ndc no further than radius, -1 when there is none
+	int pick(const glm::vec2& ndc, float radius);
+
+	// Points compared by the last pick
+	unsigned int candidates;
+
+private:
+	vector<glm::vec2> screen;	// NDC position of every point from the last update
+	vector<int> cellStart;	// where every cell's points begin in cellPoints, one past the end last
+	vector<int> cellPoints;	// point indices, grouped by cell
+	vector<int> cellOf;	// cell of every point, -1 when it's behind the camera or off screen
+
+	static int cell(float ndc);
+};
+
+// Logs picks against 10000 control points, projecting them all for every pick the way
+// manip_pt did next to the grid, and checks both find the same points
+void benchmarkPointPicker();
+
+#endif
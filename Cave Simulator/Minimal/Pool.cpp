@@ -0,0 +1,156 @@
+#include "Pool.h"
+#include "Profiler.h"
+
+#include <stdio.h>
+#include <list>
+#include <Windows.h>
+#include <glm/glm.hpp>
+
+// Stand-ins for the coaster's Node, Point and Track, the same sizes where it matters
+struct BenchNode {
+	virtual ~BenchNode() {}
+};
+
+struct BenchPoint : BenchNode {
+	glm::mat4 toWorld;
+	glm::vec3 loc;
+};
+
+struct BenchTrack : BenchNode {
+	glm::vec3 vertices[200];
+};
+
+// A control point and where it sits in the track, what the migrated traversals keep
+template <class P>
+struct BenchTrackPoint {
+	P point;
+	int segment;
+	int index;
+};
+
+void benchmarkPools()
+{
+	static const int SEGMENTS = 8000;
+	static const int FRAMES = 200;
+
+	// laid out the way init_tracks builds them, a Track allocated between every segment's Points,
+	// then the same Points entered in the pools with their segment and place in it
+	list<BenchNode*> children;
+	vector<BenchTrack*> tracks;
+	Pool<BenchTrackPoint<BenchPoint*> > pointers;
+	Pool<BenchTrackPoint<BenchPoint> > values;
+	vector<PoolHandle> handles(SEGMENTS * 4);
+	for (int s = 0; s < SEGMENTS; s++)
+	{
+		int first = s == 0 ? 0 : 1;
+		int last = s == SEGMENTS - 1 ? 2 : 3;
+		for (int k = first; k <= last; k++)
+		{
+			BenchPoint* point = new BenchPoint();
+			point->toWorld = glm::mat4(1.0f);
+			point->loc = glm::vec3((float)s, (float)k, 0.0f);
+			children.push_back(point);
+			BenchTrackPoint<BenchPoint*> byPointer = { point, s, k };
+			BenchTrackPoint<BenchPoint> byValue = { *point, s, k };
+			handles[s * 4 + k] = pointers.add(byPointer);
+			values.add(byValue);
+		}
+		// anchors are shared with the neighbouring segment
+		if (s > 0)
+			handles[s * 4] = handles[(s - 1) * 4 + 3];
+		tracks.push_back(new BenchTrack());
+	}
+	handles[(SEGMENTS - 1) * 4 + 3] = handles[0];
+
+	vector<glm::vec3> segments(SEGMENTS * 4), lines, positions;
+	float checksum = 0.0f;
+
+	// before: the skipping walks over the list, every element cast
+	double start = Profiler::now();
+	for (int f = 0; f < FRAMES; f++)
+	{
+		list<BenchNode*>::iterator it = children.begin();
+		for (int k = 0; k < 4; k++, it++)
+			segments[k] = ((BenchPoint*)(*it))->loc;
+		for (int s = 1; s < SEGMENTS; s++)
+		{
+			segments[s * 4] = segments[s * 4 - 1];
+			int last = s == SEGMENTS - 1 ? 2 : 3;
+			for (int k = 1; k <= last; k++, it++)
+				segments[s * 4 + k] = ((BenchPoint*)(*it))->loc;
+		}
+		segments[SEGMENTS * 4 - 1] = segments[0];
+
+		// the handle lines, every third Point from the first segment's second handle on
+		lines.clear();
+		it = children.begin();
+		it++;
+		glm::vec3 first = ((BenchPoint*)(*it))->loc;
+		it++;
+		for (int s = 0; s < SEGMENTS - 1; s++)
+		{
+			lines.push_back(((BenchPoint*)(*it))->loc);
+			it++;
+			it++;
+			lines.push_back(((BenchPoint*)(*it))->loc);
+			it++;
+		}
+		lines.push_back(((BenchPoint*)(*it))->loc);
+		lines.push_back(first);
+
+		positions.clear();
+		for (it = children.begin(); it != children.end(); ++it)
+			positions.push_back(glm::vec3(((BenchPoint*)(*it))->toWorld * glm::vec4(((BenchPoint*)(*it))->loc, 1.0f)));
+		checksum += segments[5].x + lines[3].y + positions[7].z;
+	}
+	double listMs = (Profiler::now() - start) / FRAMES;
+
+	// after, the Points still owned elsewhere: the pool of pointers
+	start = Profiler::now();
+	for (int f = 0; f < FRAMES; f++)
+	{
+		for (int i = 0; i < SEGMENTS * 4; i++)
+			segments[i] = pointers.get(handles[i]).point->loc;
+		lines.clear();
+		for (int s = 0; s < SEGMENTS; s++)
+		{
+			lines.push_back(pointers.get(handles[s * 4 + 2]).point->loc);
+			lines.push_back(pointers.get(handles[(s + 1) % SEGMENTS * 4 + 1]).point->loc);
+		}
+		positions.clear();
+		for (int i = 0; i < pointers.size(); i++)
+			positions.push_back(glm::vec3(pointers[i].point->toWorld * glm::vec4(pointers[i].point->loc, 1.0f)));
+		checksum += segments[5].x + lines[3].y + positions[7].z;
+	}
+	double pointerMs = (Profiler::now() - start) / FRAMES;
+
+	// and with the Point data living in the pool itself
+	start = Profiler::now();
+	for (int f = 0; f < FRAMES; f++)
+	{
+		for (int i = 0; i < SEGMENTS * 4; i++)
+			segments[i] = values.get(handles[i]).point.loc;
+		lines.clear();
+		for (int s = 0; s < SEGMENTS; s++)
+		{
+			lines.push_back(values.get(handles[s * 4 + 2]).point.loc);
+			lines.push_back(values.get(handles[(s + 1) % SEGMENTS * 4 + 1]).point.loc);
+		}
+		positions.clear();
+		for (int i = 0; i < values.size(); i++)
+			positions.push_back(glm::vec3(values[i].point.toWorld * glm::vec4(values[i].point.loc, 1.0f)));
+		checksum += segments[5].x + lines[3].y + positions[7].z;
+	}
+	double valueMs = (Profiler::now() - start) / FRAMES;
+
+	for (list<BenchNode*>::iterator it = children.begin(); it != children.end(); ++it)
+		delete *it;
+	for (unsigned int i = 0; i < tracks.size(); i++)
+		delete tracks[i];
+
+	char buff[300];
+	sprintf_s(buff, "Pools, %d segments / %d points a frame: std::list with casts %.3f ms, pool of Point pointers %.3f ms, pool of Points %.3f ms (%g)\n",
+		SEGMENTS, pointers.size(), listMs, pointerMs, valueMs, checksum);
+	OutputDebugStringA(buff);
+	printf("%s", buff);
+}
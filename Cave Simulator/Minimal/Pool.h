@@ -0,0 +1,88 @@
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <vector>
+using namespace std;
+
+// Names an item in a Pool. The generation tells a handle to a removed item apart from one to
+// whatever later took its place.
+struct PoolHandle {
+	unsigned int entry;
+	unsigned int generation;
+};
+
+// Items of one type in a contiguous array, so iterating them by type is a walk over memory
+// instead of a list of base pointers to downcast. Handles go through a table of entries, so
+// they stay the same when remove() fills the gap with the last item.
+template <class T>
+class Pool
+{
+public:
+	PoolHandle add(const T& item)
+	{
+		unsigned int entry;
+		if (this->freeEntries.empty())
+		{
+			entry = this->entries.size();
+			Entry fresh = { 0, 0 };
+			this->entries.push_back(fresh);
+		}
+		else
+		{
+			entry = this->freeEntries.back();
+			this->freeEntries.pop_back();
+		}
+		this->entries[entry].item = this->items.size();
+		this->items.push_back(item);
+		this->owners.push_back(entry);
+		PoolHandle handle = { entry, this->entries[entry].generation };
+		return handle;
+	}
+
+	void remove(PoolHandle handle)
+	{
+		if (!valid(handle))
+			return;
+		unsigned int item = this->entries[handle.entry].item;
+		unsigned int last = this->items.size() - 1;
+		this->items[item] = this->items[last];
+		this->owners[item] = this->owners[last];
+		this->entries[this->owners[item]].item = item;
+		this->items.pop_back();
+		this->owners.pop_back();
+		this->entries[handle.entry].generation++;
+		this->freeEntries.push_back(handle.entry);
+	}
+
+	bool valid(PoolHandle handle) const
+	{
+		return handle.entry < this->entries.size() && this->entries[handle.entry].generation == handle.generation;
+	}
+
+	T& get(PoolHandle handle) { return this->items[this->entries[handle.entry].item]; }
+	const T& get(PoolHandle handle) const { return this->items[this->entries[handle.entry].item]; }
+
+	// In storage order, which changes when items are removed
+	int size() const { return this->items.size(); }
+	T& operator[](int i) { return this->items[i]; }
+	const T& operator[](int i) const { return this->items[i]; }
+	typename vector<T>::iterator begin() { return this->items.begin(); }
+	typename vector<T>::iterator end() { return this->items.end(); }
+
+private:
+	struct Entry {
+		unsigned int item;	// where the item is in items while the entry is in use
+		unsigned int generation;
+	};
+
+	vector<T> items;
+	vector<unsigned int> owners;	// entry of every item
+	vector<Entry> entries;
+	vector<unsigned int> freeEntries;
+};
+
+// Logs the per frame point traversals of a long track both ways: Points under a Group's
+// std::list<Node*> walked with index math and downcasts, and the same data in typed Pools
+void benchmarkPools();
+
+#endif
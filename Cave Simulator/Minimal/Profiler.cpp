@@ -0,0 +1,343 @@
+#include "Profiler.h"
+#include "shader.h"
+
+#include <stdio.h>
+#include <Windows.h>
+
+// Frame budget of the Rift at 90 Hz, the overlay is scaled so one budget spans its full width
+#define OVERLAY_BUDGET_MS (1000.0 / 90.0)
+
+bool Profiler::enabled = true;
+bool Profiler::showOverlay = false;
+
+ProfileFrame Profiler::history[PROFILER_HISTORY];
+unsigned int Profiler::current = 0;
+unsigned int Profiler::recorded = 0;
+bool Profiler::inFrame = false;
+vector<unsigned int> Profiler::openScopes;
+int Profiler::openPass = -1;
+
+vector<GLuint> Profiler::freeQueries;
+vector<Profiler::PendingQuery> Profiler::pending;
+
+GLuint Profiler::overlayShader = 0;
+GLuint Profiler::overlayVAO = 0;
+GLuint Profiler::overlayVBO = 0;
+vector<GLfloat> Profiler::overlayVertices;
+
+double Profiler::now()
+{
+	static LARGE_INTEGER frequency = { 0 };
+	static LARGE_INTEGER origin;
+	if (frequency.QuadPart == 0)
+	{
+		QueryPerformanceFrequency(&frequency);
+		QueryPerformanceCounter(&origin);
+	}
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return (double)(counter.QuadPart - origin.QuadPart) * 1000.0 / (double)frequency.QuadPart;
+}
+
+void Profiler::initialize()
+{
+	now();
+
+	overlayShader = LoadShaders("../profiler.vert", "../profiler.frag");
+	glGenVertexArrays(1, &overlayVAO);
+	glGenBuffers(1, &overlayVBO);
+	glBindVertexArray(overlayVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, overlayVBO);
+	// x, y in normalized device coordinates followed by r, g, b
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)(2 * sizeof(GLfloat)));
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+}
+
+void Profiler::beginFrame(unsigned int frame)
+{
+	if (!enabled)
+		return;
+	collectQueries(false);
+
+	current = (recorded == 0) ? 0 : (current + 1) % PROFILER_HISTORY;
+	if (recorded < PROFILER_HISTORY)
+		recorded++;
+
+	ProfileFrame& entry = history[current];
+	entry.frame = frame;
+	entry.start = now();
+	entry.cpuTime = 0.0;
+	entry.gpuTime = 0.0;
+	entry.pendingPasses = 0;
+	entry.samples.clear();
+
+	openScopes.clear();
+	openPass = -1;
+	inFrame = true;
+}
+
+void Profiler::endFrame()
+{
+	if (!inFrame)
+		return;
+	// close anything left open by an early return
+	if (openPass >= 0)
+		endPass();
+	while (!openScopes.empty())
+		popScope();
+
+	history[current].cpuTime = now() - history[current].start;
+	inFrame = false;
+}
+
+void Profiler::pushScope(const char* name)
+{
+	if (!inFrame)
+		return;
+	ProfileFrame& entry = history[current];
+	ProfileSample sample;
+	sample.name = name;
+	sample.depth = openScopes.size();
+	sample.gpu = false;
+	sample.begin = now() - entry.start;
+	sample.duration = 0.0;
+	openScopes.push_back(entry.samples.size());
+	entry.samples.push_back(sample);
+}
+
+void Profiler::popScope()
+{
+	if (!inFrame || openScopes.empty())
+		return;
+	ProfileFrame& entry = history[current];
+	ProfileSample& sample = entry.samples[openScopes.back()];
+	sample.duration = now() - entry.start - sample.begin;
+	openScopes.pop_back();
+}
+
+void Profiler::beginPass(const char* name)
+{
+	if (!inFrame || openPass >= 0)
+		return;
+	ProfileFrame& entry = history[current];
+
+	GLuint query;
+	if (freeQueries.empty())
+	{
+		glGenQueries(1, &query);
+	}
+	else
+	{
+		query = freeQueries.back();
+		freeQueries.pop_back();
+	}
+
+	ProfileSample sample;
+	sample.name = name;
+	sample.depth = openScopes.size();
+	sample.gpu = true;
+	sample.begin = now() - entry.start;
+	sample.duration = -1.0;
+	openPass = entry.samples.size();
+	entry.samples.push_back(sample);
+
+	PendingQuery waiting;
+	waiting.query = query;
+	waiting.frame = entry.frame;
+	waiting.slot = current;
+	waiting.sample = openPass;
+	pending.push_back(waiting);
+	entry.pendingPasses++;
+
+	glBeginQuery(GL_TIME_ELAPSED, query);
+}
+
+void Profiler::endPass()
+{
+	if (!inFrame || openPass < 0)
+		return;
+	glEndQuery(GL_TIME_ELAPSED);
+	openPass = -1;
+}
+
+void Profiler::collectQueries(bool force)
+{
+	unsigned int newest = (recorded == 0) ? 0 : history[current].frame;
+	for (unsigned int i = 0; i < pending.size();)
+	{
+		PendingQuery& waiting = pending[i];
+		GLint available = 0;
+		glGetQueryObjectiv(waiting.query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available && !force && waiting.frame + PROFILER_QUERY_LATENCY > newest)
+		{
+			i++;
+			continue;
+		}
+
+		ProfileFrame& entry = history[waiting.slot];
+		// the entry may have been reused by a newer frame while the query was in flight
+		bool owned = entry.frame == waiting.frame && waiting.sample < entry.samples.size();
+		if (available || force)
+		{
+			GLuint64 elapsed = 0;
+			glGetQueryObjectui64v(waiting.query, GL_QUERY_RESULT, &elapsed);
+			if (owned)
+			{
+				double ms = (double)elapsed / 1.0e6;
+				entry.samples[waiting.sample].duration = ms;
+				entry.gpuTime += ms;
+			}
+			freeQueries.push_back(waiting.query);
+		}
+		else
+		{
+			// still not done after PROFILER_QUERY_LATENCY frames, dropped rather than waited on; the
+			// pass keeps its negative duration, and the query is deleted since it may still be running
+			glDeleteQueries(1, &waiting.query);
+		}
+		if (owned)
+			entry.pendingPasses--;
+		pending.erase(pending.begin() + i);
+	}
+}
+
+const ProfileFrame* Profiler::latestComplete()
+{
+	for (unsigned int k = 0; k < recorded; k++)
+	{
+		unsigned int slot = (current + PROFILER_HISTORY - k) % PROFILER_HISTORY;
+		if (slot == current && inFrame)
+			continue;
+		if (history[slot].pendingPasses == 0)
+			return &history[slot];
+	}
+	return NULL;
+}
+
+void Profiler::addBar(float x0, float x1, float y, float height, const float* color)
+{
+	GLfloat corners[6][2] = {
+		{ x0, y }, { x0, y - height }, { x1, y - height },
+		{ x1, y - height }, { x1, y }, { x0, y }
+	};
+	for (int i = 0; i < 6; i++)
+	{
+		overlayVertices.push_back(corners[i][0]);
+		overlayVertices.push_back(corners[i][1]);
+		overlayVertices.push_back(color[0]);
+		overlayVertices.push_back(color[1]);
+		overlayVertices.push_back(color[2]);
+	}
+}
+
+void Profiler::drawOverlay()
+{
+	if (!showOverlay || overlayShader == 0)
+		return;
+	const ProfileFrame* frame = latestComplete();
+	if (frame == NULL)
+		return;
+
+	static const float palette[6][3] = {
+		{ 0.9f, 0.6f, 0.1f }, { 0.2f, 0.7f, 0.9f }, { 0.5f, 0.9f, 0.3f },
+		{ 0.9f, 0.3f, 0.6f }, { 0.6f, 0.5f, 0.9f }, { 0.9f, 0.9f, 0.4f }
+	};
+	static const float budgetColor[3] = { 1.0f, 0.1f, 0.1f };
+
+	// CPU scopes on one row per nesting level, the GPU passes packed back to back on the row below
+	const float left = -0.45f, width = 0.9f, top = -0.25f, row = 0.045f, height = 0.035f;
+	float scale = (float)(width / OVERLAY_BUDGET_MS);
+
+	overlayVertices.clear();
+	int rows = 0;
+	for (unsigned int i = 0; i < frame->samples.size(); i++)
+	{
+		const ProfileSample& sample = frame->samples[i];
+		if (sample.gpu)
+			continue;
+		float x0 = left + (float)sample.begin * scale;
+		float x1 = left + (float)(sample.begin + sample.duration) * scale;
+		addBar(x0, x1, top - sample.depth * row, height, palette[i % 6]);
+		if (sample.depth + 1 > rows)
+			rows = sample.depth + 1;
+	}
+	float gpuTop = top - rows * row - row * 0.5f;
+	double cursor = 0.0;
+	for (unsigned int i = 0; i < frame->samples.size(); i++)
+	{
+		const ProfileSample& sample = frame->samples[i];
+		if (!sample.gpu || sample.duration < 0.0)
+			continue;
+		addBar(left + (float)cursor * scale, left + (float)(cursor + sample.duration) * scale, gpuTop, height, palette[i % 6]);
+		cursor += sample.duration;
+	}
+	addBar(left + width, left + width + 0.005f, top + row * 0.5f, top - gpuTop + height + row, budgetColor);
+
+	glDisable(GL_DEPTH_TEST);
+	glUseProgram(overlayShader);
+	glBindVertexArray(overlayVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, overlayVBO);
+	glBufferData(GL_ARRAY_BUFFER, overlayVertices.size() * sizeof(GLfloat), &overlayVertices[0], GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glDrawArrays(GL_TRIANGLES, 0, overlayVertices.size() / 5);
+	glBindVertexArray(0);
+	glEnable(GL_DEPTH_TEST);
+}
+
+bool Profiler::writeChromeTrace(const char* file)
+{
+	// the frame in progress has unbalanced scopes and unread queries, so make everything final first
+	collectQueries(true);
+
+	FILE* fp = fopen(file, "w");
+	if (fp == NULL)
+	{
+		printf("Unable to write profile to %s\n", file);
+		return false;
+	}
+
+	fprintf(fp, "{\"traceEvents\":[\n");
+	fprintf(fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"CPU\"}},\n");
+	fprintf(fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":1,\"args\":{\"name\":\"GPU\"}}");
+
+	// GPU passes only have a duration, so each one starts when it was issued or when the previous one finished
+	double gpuEnd = 0.0;
+	unsigned int oldest = (recorded < PROFILER_HISTORY) ? 0 : (current + 1) % PROFILER_HISTORY;
+	for (unsigned int k = 0; k < recorded; k++)
+	{
+		unsigned int slot = (oldest + k) % PROFILER_HISTORY;
+		if (slot == current && inFrame)
+			continue;
+		const ProfileFrame& frame = history[slot];
+
+		fprintf(fp, ",\n{\"name\":\"frame\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%u,\"gpu_ms\":%.3f}}",
+			frame.start * 1000.0, frame.cpuTime * 1000.0, frame.frame, frame.gpuTime);
+		for (unsigned int i = 0; i < frame.samples.size(); i++)
+		{
+			const ProfileSample& sample = frame.samples[i];
+			if (sample.duration < 0.0)
+				continue;
+			double start = frame.start + sample.begin;
+			if (sample.gpu)
+			{
+				if (start < gpuEnd)
+					start = gpuEnd;
+				gpuEnd = start + sample.duration;
+			}
+			fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+				sample.name, sample.gpu ? 1 : 0, start * 1000.0, sample.duration * 1000.0);
+		}
+	}
+	fprintf(fp, "\n]}\n");
+	fclose(fp);
+
+	char buff[300];
+	sprintf_s(buff, "Wrote %u frames of profile to %s\n", recorded, file);
+	OutputDebugStringA(buff);
+	printf("%s", buff);
+	return true;
+}
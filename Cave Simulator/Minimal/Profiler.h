@@ -0,0 +1,96 @@
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <vector>
+using namespace std;
+
+#include <GL/glew.h>
+
+// Frames of timings kept for the overlay and the trace dump
+#define PROFILER_HISTORY 300
+// Frames a GPU query may stay in flight. One that isn't done by then is dropped instead of waited
+// on, so reading the queries back never stalls; only writing a trace forces the rest.
+#define PROFILER_QUERY_LATENCY 3
+
+struct ProfileSample {
+	const char* name;	// has to be a string literal, only the pointer is kept
+	int depth;			// nesting level of CPU scopes
+	bool gpu;
+	double begin;		// ms since the frame started, for GPU passes the time the pass was issued
+	double duration;	// ms, GPU passes stay negative until their query is read back, or if it was dropped
+};
+
+struct ProfileFrame {
+	unsigned int frame;
+	double start;		// ms since the profiler was initialized
+	double cpuTime;		// ms from beginFrame to endFrame
+	double gpuTime;		// sum of all GPU passes
+	int pendingPasses;	// GPU queries of this frame not read back yet
+	vector<ProfileSample> samples;
+};
+
+// Nested CPU scopes and GL_TIME_ELAPSED queries around render passes, kept for the last
+// PROFILER_HISTORY frames. GL only allows one time query at a time, so passes can't nest.
+class Profiler
+{
+public:
+	static bool enabled;
+	static bool showOverlay;
+
+	static void initialize();
+	static void beginFrame(unsigned int frame);
+	static void endFrame();
+
+	static void pushScope(const char* name);
+	static void popScope();
+	static void beginPass(const char* name);
+	static void endPass();
+
+	// Newest frame whose GPU passes have all been read back, null until there is one
+	static const ProfileFrame* latestComplete();
+	// Draws the latest complete frame as timing bars into the bound framebuffer's viewport
+	static void drawOverlay();
+	// Writes the whole history in the Chrome trace event format, for chrome://tracing
+	static bool writeChromeTrace(const char* file);
+
+	// ms on the performance counter since the first call, also used by the benchmarks
+	static double now();
+
+private:
+	struct PendingQuery {
+		GLuint query;
+		unsigned int frame;
+		unsigned int slot;		// history entry the pass belongs to
+		unsigned int sample;
+	};
+
+	static ProfileFrame history[PROFILER_HISTORY];
+	static unsigned int current;		// history entry being recorded
+	static unsigned int recorded;		// frames in the history
+	static bool inFrame;
+	static vector<unsigned int> openScopes;
+	static int openPass;
+
+	static vector<GLuint> freeQueries;
+	static vector<PendingQuery> pending;
+
+	static GLuint overlayShader, overlayVAO, overlayVBO;
+	static vector<GLfloat> overlayVertices;
+
+	static void collectQueries(bool force);
+	static void addBar(float x0, float x1, float y, float height, const float* color);
+};
+
+// Times the enclosing block as a CPU scope
+class ProfileScope
+{
+public:
+	ProfileScope(const char* name) { Profiler::pushScope(name); }
+	~ProfileScope() { Profiler::popScope(); }
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+
+#endif
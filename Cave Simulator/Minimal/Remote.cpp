@@ -1,4 +1,6 @@
 #include "Remote.h"
+#include "RenderStats.h"
+#include "RenderQueue.h"
 
 Remote::Remote() {
 	colorVal = glm::vec3(0.0f, 1.0f, 0.0f);
@@ -34,6 +36,17 @@ Remote::Remote() {
 
 	glBindVertexArray(0); // Unbind VAO (it's always a good thing to unbind any buffer/array to prevent strange bugs), remember: do NOT unbind the EBO, keep it bound to this VAO
 
+	GLfloat segment[] = { 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f };
+	glGenVertexArrays(1, &segmentVAO);
+	glGenBuffers(1, &segmentVBO);
+	glBindVertexArray(segmentVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, segmentVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(segment), segment, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
+	glEnableVertexAttribArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+
 }
 
 vector<glm::vec3> Remote::calcCoords() {
@@ -65,7 +78,6 @@ void Remote::Draw(GLuint shaderProgram, glm::vec3 pta, glm::vec3 ptb) {
 
 									  //toWorld = glm::translate(quat, position);
 	toWorld = glm::mat4(1.0f);
-	glLineWidth(10.0f);
 	// draw lines
 	GLuint MatrixID = glGetUniformLocation(shaderProgram, "model");
 	glUniformMatrix4fv(MatrixID, 1, GL_FALSE, &toWorld[0][0]);
@@ -76,4 +88,19 @@ void Remote::Draw(GLuint shaderProgram, glm::vec3 pta, glm::vec3 ptb) {
 	glBindVertexArray(VAO);
 	glDrawArrays(GL_LINES, 0, 2);
 	glBindVertexArray(0);
+	RenderStats::frame.drawCalls++;
+	RenderStats::frame.vaoBinds += 2;
+	RenderStats::frame.uniformLookups += 2;
+	RenderStats::frame.uniformUploads += 2;
+}
+
+void Remote::Submit(RenderQueue& queue, GLuint shaderProgram, glm::vec3 pta, glm::vec3 ptb) {
+	// x axis runs from pta to ptb, the other axes are irrelevant for points on the x axis
+	glm::mat4 model(1.0f);
+	model[0] = glm::vec4(ptb - pta, 0.0f);
+	model[3] = glm::vec4(pta, 1.0f);
+
+	DrawItem& item = queue.submit(shaderProgram, segmentVAO, GL_LINES, 0, 2, false, model);
+	item.hasColor = true;
+	item.color = colorVal;
 }
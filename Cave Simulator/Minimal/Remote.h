@@ -16,6 +16,8 @@ class Remote
 public:
 
 	GLuint VBO, VAO, EBO;
+	// unit segment from the origin along x, stretched onto the endpoints by the model matrix when queued
+	GLuint segmentVBO, segmentVAO;
 	glm::mat4 toWorld;
 
 	glm::vec3 position;
@@ -31,5 +33,8 @@ public:
 	vector<glm::vec3> calcCoords();
 	// Draws the model, and thus all its meshes
 	void Draw(GLuint shader, glm::vec3, glm::vec3);
+	// Records a line from pta to ptb in a render queue. The shared VBO can't be rewritten per line
+	// once draws are deferred, so the queued line is the unit segment placed by its model matrix.
+	void Submit(RenderQueue& queue, GLuint shader, glm::vec3 pta, glm::vec3 ptb);
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,242 @@
+#include "RideCamera.h"
+#include "CoasterDynamics.h"
+#include "Profiler.h"
+
+#include <stdio.h>
+#include <math.h>
+#include <Windows.h>
+
+// Axis times angle of a rotation, the short way round
+static glm::vec3 rotationVector(glm::quat q)
+{
+	if (q.w < 0.0f)
+		q = -q;
+	glm::vec3 axis(q.x, q.y, q.z);
+	float half = glm::length(axis);
+	if (half < 1e-6f)
+		return 2.0f * axis;
+	return axis * (2.0f * atan2f(half, q.w) / half);
+}
+
+static glm::quat rotationFromVector(const glm::vec3& v)
+{
+	float angle = glm::length(v);
+	if (angle < 1e-6f)
+		return glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+	return glm::angleAxis(angle, v / angle);
+}
+
+// Turns v by the least rotation that takes the unit vector from onto to
+static glm::vec3 transport(const glm::vec3& v, const glm::vec3& from, const glm::vec3& to)
+{
+	glm::vec3 axis = glm::cross(from, to);
+	float sine = glm::length(axis);
+	if (sine < 1e-7f)
+		return v;
+	return glm::angleAxis(atan2f(sine, glm::dot(from, to)), axis / sine) * v;
+}
+
+// Columns binormal, normal and the tangent down -z, like a camera
+static glm::quat viewOrientation(const glm::vec3& tangent, const glm::vec3& normal)
+{
+	return glm::quat_cast(glm::mat3(glm::cross(tangent, normal), normal, -tangent));
+}
+
+RideCamera::RideCamera()
+	: stiffness(RIDE_STIFFNESS), lookAhead(true), position(0.0f), orientation(1.0f, 0.0f, 0.0f, 0.0f),
+	angularVelocity(0.0f), spacing(RIDE_FRAME_SPACING), closed(false)
+{
+}
+
+void RideCamera::build(const TrackSpline& spline)
+{
+	PROFILE_SCOPE("ride camera frames");
+	this->closed = spline.isClosed();
+	int count = glm::max(2, (int)ceilf(spline.length() / RIDE_FRAME_SPACING));
+	this->spacing = spline.length() / count;
+	// a closed track's last frame is its first again
+	int samples = this->closed ? count : count + 1;
+	this->tangents.resize(samples);
+	this->normals.resize(samples);
+
+	TrackFrame first = spline.frame(0.0f);
+	this->tangents[0] = first.tangent;
+	this->normals[0] = first.normal;
+	for (int i = 1; i < samples; i++)
+	{
+		glm::vec3 tangent = spline.tangent(i * this->spacing);
+		glm::vec3 normal = transport(this->normals[i - 1], this->tangents[i - 1], tangent);
+		this->tangents[i] = tangent;
+		this->normals[i] = glm::normalize(normal - tangent * glm::dot(normal, tangent));
+	}
+
+	if (this->closed)
+	{
+		// around the loop the normal comes back turned about the tangent, undo that evenly
+		glm::vec3 end = transport(this->normals[count - 1], this->tangents[count - 1], this->tangents[0]);
+		float twist = atan2f(glm::dot(glm::cross(end, this->normals[0]), this->tangents[0]), glm::dot(end, this->normals[0]));
+		for (int i = 1; i < count; i++)
+			this->normals[i] = glm::angleAxis(twist * i / count, this->tangents[i]) * this->normals[i];
+	}
+}
+
+void RideCamera::reset(const TrackSpline& spline, float distance)
+{
+	this->position = spline.position(distance);
+	this->orientation = frameAt(spline, distance, false);
+	this->angularVelocity = glm::vec3(0.0f);
+}
+
+void RideCamera::update(const TrackSpline& spline, float distance, float speed, float seconds)
+{
+	this->position = spline.position(distance);
+	float lead = this->lookAhead && this->stiffness > 0.0f ? 2.0f / this->stiffness : 0.0f;
+	glm::quat target = frameAt(spline, distance + speed * lead, speed < 0.0f);
+	if (this->stiffness <= 0.0f)
+	{
+		this->orientation = target;
+		this->angularVelocity = glm::vec3(0.0f);
+		return;
+	}
+
+	while (seconds > 0.0f)
+	{
+		float dt = glm::min(seconds, RIDE_SPRING_STEP);
+		glm::vec3 error = rotationVector(target * glm::inverse(this->orientation));
+		this->angularVelocity += (this->stiffness * this->stiffness * error - 2.0f * this->stiffness * this->angularVelocity) * dt;
+		this->orientation = glm::normalize(rotationFromVector(this->angularVelocity * dt) * this->orientation);
+		seconds -= dt;
+	}
+}
+
+glm::mat4 RideCamera::transform() const
+{
+	glm::mat4 camera = glm::mat4_cast(this->orientation);
+	camera[3] = glm::vec4(this->position, 1.0f);
+	return camera;
+}
+
+glm::quat RideCamera::frameAt(const TrackSpline& spline, float distance, bool backwards) const
+{
+	int samples = this->tangents.size();
+	if (samples < 2)
+		return glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+
+	distance = spline.wrap(distance);
+	float f = distance / this->spacing;
+	int i0, i1;
+	if (this->closed)
+	{
+		i0 = glm::min((int)f, samples - 1);
+		i1 = (i0 + 1) % samples;
+	}
+	else
+	{
+		i0 = glm::min((int)f, samples - 2);
+		i1 = i0 + 1;
+	}
+	float w = f - i0;
+
+	glm::vec3 tangent = spline.tangent(distance);
+	glm::vec3 normal = transport(this->normals[i0], this->tangents[i0], tangent) * (1.0f - w)
+		+ transport(this->normals[i1], this->tangents[i1], tangent) * w;
+	normal = glm::normalize(normal - tangent * glm::dot(normal, tangent));
+	return viewOrientation(backwards ? -tangent : tangent, normal);
+}
+
+// RMS and worst angular jerk of views a frame apart, from the second difference of the angular
+// velocity between them
+static void angularJerk(const vector<glm::quat>& views, float dt, int skip, float& rms, float& worst)
+{
+	vector<glm::vec3> velocity(views.size() - 1);
+	for (unsigned int i = 0; i + 1 < views.size(); i++)
+		velocity[i] = rotationVector(views[i + 1] * glm::inverse(views[i])) / dt;
+
+	double sum = 0.0;
+	int count = 0;
+	worst = 0.0f;
+	for (unsigned int i = skip + 1; i + 1 < velocity.size(); i++)
+	{
+		float jerk = glm::length(velocity[i + 1] - 2.0f * velocity[i] + velocity[i - 1]) / (dt * dt);
+		sum += jerk * jerk;
+		worst = glm::max(worst, jerk);
+		count++;
+	}
+	rms = count > 0 ? (float)sqrt(sum / count) : 0.0f;
+}
+
+void benchmarkRideCamera()
+{
+	static const int RATE = 90;
+	static const float RIDE_SECONDS = 60.0f;
+	static const int VARIANTS = 4;
+	static const char* NAMES[VARIANTS] = { "direction between frames", "parallel transport", "smoothed", "smoothed ahead" };
+	const float dt = 1.0f / RATE;
+	// the first second, while the spring takes up the turning of the track
+	const int skip = RATE;
+
+	TrackSpline spline;
+	buildDefaultLoop(spline);
+	float highest;
+	float top = spline.highest(highest);
+
+	double start = Profiler::now();
+	RideCamera cameras[VARIANTS];
+	for (int v = 1; v < VARIANTS; v++)
+		cameras[v].build(spline);
+	double buildMs = (Profiler::now() - start) / (VARIANTS - 1);
+	cameras[1].stiffness = 0.0f;
+	cameras[1].lookAhead = false;
+	cameras[2].lookAhead = false;
+
+	CoasterDynamics coaster;
+	coaster.reset(spline, top, sqrtf(2.0f * coaster.gravity * 0.2f));
+	coaster.friction = 0.01f;
+	for (int v = 1; v < VARIANTS; v++)
+		cameras[v].reset(spline, top);
+
+	int frames = (int)(RIDE_SECONDS * RATE);
+	vector<glm::quat> views[VARIANTS];
+	double lag[VARIANTS] = { 0.0, 0.0, 0.0, 0.0 };
+	float last = top;
+	start = Profiler::now();
+	for (int f = 0; f < frames; f++)
+	{
+		coaster.advance(spline, dt);
+		float distance = coaster.renderDistance(spline);
+
+		// what the desktop build did: face from the last car position to this one, world up
+		glm::vec3 travel = spline.position(distance) - spline.position(last);
+		glm::vec3 forward = glm::length(travel) > 1e-6f ? glm::normalize(travel) : spline.tangent(distance);
+		glm::vec3 binormal = glm::normalize(glm::cross(forward, glm::vec3(0.0f, 1.0f, 0.0f)));
+		views[0].push_back(viewOrientation(forward, glm::cross(binormal, forward)));
+		last = distance;
+
+		for (int v = 1; v < VARIANTS; v++)
+		{
+			cameras[v].update(spline, distance, coaster.speed, dt);
+			views[v].push_back(cameras[v].orientation);
+		}
+
+		glm::quat exact = cameras[1].orientation;
+		if (f >= skip)
+			for (int v = 0; v < VARIANTS; v++)
+				lag[v] += glm::length(rotationVector(views[v].back() * glm::inverse(exact)));
+	}
+	double rideMs = (Profiler::now() - start) / frames;
+
+	char buff[300];
+	sprintf_s(buff, "Ride camera, %d parallel transport frames along the default loop built in %.3f ms, %.4f ms a frame for all four views\n",
+		(int)ceilf(spline.length() / RIDE_FRAME_SPACING), buildMs, rideMs);
+	OutputDebugStringA(buff);
+	printf("%s", buff);
+	for (int v = 0; v < VARIANTS; v++)
+	{
+		float rms, worst;
+		angularJerk(views[v], dt, skip, rms, worst);
+		sprintf_s(buff, "Ride camera, %s at %d fps: angular jerk RMS %.1f rad/s^3, worst %.1f, %.3f degrees off the parallel transport frame on average\n",
+			NAMES[v], RATE, rms, worst, lag[v] / (frames - skip) * (180.0 / 3.14159265358979));
+		OutputDebugStringA(buff);
+		printf("%s", buff);
+	}
+}
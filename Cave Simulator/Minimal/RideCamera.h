@@ -0,0 +1,69 @@
+#ifndef RIDECAMERA_H_
+#define RIDECAMERA_H_
+
+#include <vector>
+using namespace std;
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "TrackSpline.h"
+
+// Track distance between the precomputed frames
+#define RIDE_FRAME_SPACING 0.05f
+// Longest step the smoothing spring takes, longer frames are split up
+#define RIDE_SPRING_STEP (1.0f / 240.0f)
+// Angular frequency of the spring by default, in radians per second
+#define RIDE_STIFFNESS 8.0f
+
+// The rider's view along a TrackSpline. Orientations come from parallel transport frames
+// computed once per track: each frame is the previous one turned by the least rotation that
+// lines its tangent up with the next, so the view never spins about the track the way a Frenet
+// or world-up frame does where the curvature jumps between segments. On a closed track the twist
+// left over after a lap is spread evenly along it.
+//
+// The view then follows that orientation through a critically damped spring, which filters the
+// curvature steps at segment boundaries out of the angular acceleration. A critically damped
+// spring trails a steadily turning target by 2 / stiffness seconds, so the target is taken that
+// far ahead along the track at the current speed and the smoothed view arrives on time. Rolling
+// backwards, the rider faces the way the car goes, and the spring turns the view around.
+class RideCamera
+{
+public:
+	RideCamera();
+
+	// Computes the frames of a track, again whenever it changes
+	void build(const TrackSpline& spline);
+	// Jumps straight to the frame at a distance
+	void reset(const TrackSpline& spline, float distance);
+	void update(const TrackSpline& spline, float distance, float speed, float seconds);
+
+	// Camera to world: looking down -z, y up, at the track under the car
+	glm::mat4 transform() const;
+	// Parallel transport orientation at a distance, before any smoothing: the spline's own
+	// tangent, and the normal interpolated between the two frames around it. Backwards faces
+	// down the track the other way, turned half around the normal.
+	glm::quat frameAt(const TrackSpline& spline, float distance, bool backwards) const;
+
+	// Angular frequency of the spring, 0 follows the frames directly
+	float stiffness;
+	// Looks 2 / stiffness seconds ahead, which cancels the spring's lag
+	bool lookAhead;
+
+	glm::vec3 position;
+	glm::quat orientation;
+	glm::vec3 angularVelocity;	// radians per second, world axis
+
+private:
+	vector<glm::vec3> tangents, normals;	// every spacing along the track from its start
+	float spacing;
+	bool closed;
+};
+
+// Rides the default loop for a minute at 90 Hz and logs the angular jerk of the view, RMS and
+// worst, with the direction between consecutive car positions the desktop build used, parallel
+// transport frames, and those smoothed with and without looking ahead, next to how far each
+// trails the unsmoothed frames. Needs no GL.
+void benchmarkRideCamera();
+
+#endif
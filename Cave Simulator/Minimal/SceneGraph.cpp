@@ -0,0 +1,231 @@
+#include "SceneGraph.h"
+#include "Profiler.h"
+
+#include <stdio.h>
+#include <math.h>
+#include <list>
+#include <algorithm>
+#include <Windows.h>
+
+SceneGraph::SceneGraph()
+	: firstDirty(0), sorted(true)
+{
+}
+
+int SceneGraph::add(int parent, const glm::mat4& local)
+{
+	int slot = this->parents.size();
+	int depth = parent == SCENE_ROOT ? 0 : this->depths[this->slots[parent]] + 1;
+	if (slot > 0 && depth < this->depths[slot - 1])
+		this->sorted = false;
+
+	this->parents.push_back(parent == SCENE_ROOT ? SCENE_ROOT : this->slots[parent]);
+	this->depths.push_back(depth);
+	this->locals.push_back(local);
+	this->worlds.push_back(local);
+	this->dirty.push_back(1);
+	int handle = this->slots.size();
+	this->handles.push_back(handle);
+	this->slots.push_back(slot);
+	this->firstDirty = glm::min(this->firstDirty, slot);
+	return handle;
+}
+
+void SceneGraph::setLocal(int node, const glm::mat4& local)
+{
+	int slot = this->slots[node];
+	this->locals[slot] = local;
+	this->dirty[slot] = 1;
+	this->firstDirty = glm::min(this->firstDirty, slot);
+}
+
+const glm::mat4& SceneGraph::local(int node) const
+{
+	return this->locals[this->slots[node]];
+}
+
+const glm::mat4& SceneGraph::world(int node) const
+{
+	return this->worlds[this->slots[node]];
+}
+
+int SceneGraph::parent(int node) const
+{
+	int p = this->parents[this->slots[node]];
+	return p == SCENE_ROOT ? SCENE_ROOT : this->handles[p];
+}
+
+int SceneGraph::size() const
+{
+	return this->parents.size();
+}
+
+void SceneGraph::invalidate()
+{
+	fill(this->dirty.begin(), this->dirty.end(), 1);
+	this->firstDirty = 0;
+}
+
+int SceneGraph::update()
+{
+	if (!this->sorted)
+		sort();
+	int count = this->parents.size();
+	if (this->firstDirty >= count)
+		return 0;
+
+	// nothing before the first dirty node can change; past it, a node's dirty flag tells its
+	// children, which always come later, that they have to follow
+	int recomputed = 0;
+	for (int i = this->firstDirty; i < count; i++)
+	{
+		int p = this->parents[i];
+		if (!this->dirty[i] && (p == SCENE_ROOT || !this->dirty[p]))
+			continue;
+		this->worlds[i] = p == SCENE_ROOT ? this->locals[i] : this->worlds[p] * this->locals[i];
+		this->dirty[i] = 1;
+		recomputed++;
+	}
+	fill(this->dirty.begin() + this->firstDirty, this->dirty.end(), 0);
+	this->firstDirty = count;
+	return recomputed;
+}
+
+void SceneGraph::sort()
+{
+	// a stable counting sort by depth keeps siblings in the order they were added
+	int count = this->parents.size();
+	int deepest = 0;
+	for (int i = 0; i < count; i++)
+		deepest = glm::max(deepest, this->depths[i]);
+	vector<int> start(deepest + 2, 0);
+	for (int i = 0; i < count; i++)
+		start[this->depths[i] + 1]++;
+	for (int d = 0; d <= deepest; d++)
+		start[d + 1] += start[d];
+	vector<int> moved(count);
+	for (int i = 0; i < count; i++)
+		moved[i] = start[this->depths[i]]++;
+
+	vector<int> parents(count), depths(count), handles(count);
+	vector<glm::mat4> locals(count), worlds(count);
+	vector<unsigned char> dirty(count);
+	for (int i = 0; i < count; i++)
+	{
+		int to = moved[i];
+		parents[to] = this->parents[i] == SCENE_ROOT ? SCENE_ROOT : moved[this->parents[i]];
+		depths[to] = this->depths[i];
+		locals[to] = this->locals[i];
+		worlds[to] = this->worlds[i];
+		dirty[to] = this->dirty[i];
+		handles[to] = this->handles[i];
+		this->slots[this->handles[i]] = to;
+	}
+	this->parents.swap(parents);
+	this->depths.swap(depths);
+	this->locals.swap(locals);
+	this->worlds.swap(worlds);
+	this->dirty.swap(dirty);
+	this->handles.swap(handles);
+
+	this->firstDirty = count;
+	for (int i = 0; i < count && this->firstDirty == count; i++)
+	{
+		if (this->dirty[i])
+			this->firstDirty = i;
+	}
+	this->sorted = true;
+}
+
+// The way Group and Node hold the coaster: every node on the heap, children in a std::list,
+// and every world matrix recomputed by recursion each frame
+struct ListNode {
+	glm::mat4 local, toWorld;
+	list<ListNode*> children;
+
+	void update(const glm::mat4& parent)
+	{
+		this->toWorld = parent * this->local;
+		for (list<ListNode*>::iterator it = this->children.begin(); it != this->children.end(); ++it)
+			(*it)->update(this->toWorld);
+	}
+};
+
+static glm::mat4 offset(float x, float y, float z)
+{
+	glm::mat4 m(1.0f);
+	m[3] = glm::vec4(x, y, z, 1.0f);
+	return m;
+}
+
+void benchmarkSceneGraph()
+{
+	static const int NODES = 100000;
+	static const int CHANGES = NODES / 100;
+	static const int FRAMES = 100;
+	static const int BRANCHING = 8;
+
+	// the same eight way tree both ways, node i hanging off node (i - 1) / 8
+	SceneGraph graph;
+	vector<ListNode*> nodes(NODES);
+	for (int i = 0; i < NODES; i++)
+	{
+		glm::mat4 local = offset(0.001f * (i % 7), 0.002f * (i % 5), 0.001f * (i % 3));
+		nodes[i] = new ListNode();
+		nodes[i]->local = local;
+		if (i == 0)
+		{
+			graph.add(SCENE_ROOT, local);
+		}
+		else
+		{
+			graph.add((i - 1) / BRANCHING, local);
+			nodes[(i - 1) / BRANCHING]->children.push_back(nodes[i]);
+		}
+	}
+	graph.update();
+
+	unsigned int seed = 12345;
+	double recursiveMs = 0.0, fullMs = 0.0, dirtyMs = 0.0;
+	long long recomputed = 0;
+	for (int f = 0; f < FRAMES; f++)
+	{
+		for (int c = 0; c < CHANGES; c++)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			int node = (seed >> 8) % NODES;
+			glm::mat4 local = offset(sinf(f * 0.1f + c), 0.0f, cosf(f * 0.1f + c));
+			nodes[node]->local = local;
+			graph.setLocal(node, local);
+		}
+
+		double start = Profiler::now();
+		recomputed += graph.update();
+		dirtyMs += Profiler::now() - start;
+
+		start = Profiler::now();
+		nodes[0]->update(glm::mat4(1.0f));
+		recursiveMs += Profiler::now() - start;
+
+		start = Profiler::now();
+		graph.invalidate();
+		graph.update();
+		fullMs += Profiler::now() - start;
+	}
+
+	// both have to land on the same matrices
+	float error = 0.0f;
+	for (int i = 0; i < NODES; i++)
+	{
+		for (int k = 0; k < 4; k++)
+			error = glm::max(error, glm::length(graph.world(i)[k] - nodes[i]->toWorld[k]));
+	}
+	for (int i = 0; i < NODES; i++)
+		delete nodes[i];
+
+	char buff[300];
+	sprintf_s(buff, "Scene graph, %d nodes with %d changing a frame: recursive list %.3f ms, flat all %.3f ms, flat dirty %.3f ms for %.0f nodes, largest difference %g\n",
+		NODES, CHANGES, recursiveMs / FRAMES, fullMs / FRAMES, dirtyMs / FRAMES, (double)recomputed / FRAMES, error);
+	OutputDebugStringA(buff);
+	printf("%s", buff);
+}
@@ -0,0 +1,58 @@
+#ifndef SCENEGRAPH_H_
+#define SCENEGRAPH_H_
+
+#include <vector>
+using namespace std;
+
+#include <glm/glm.hpp>
+
+// Parent of a node at the top of the graph
+#define SCENE_ROOT -1
+
+// A transform hierarchy kept in flat arrays instead of a tree of Group/Node pointers. Nodes are
+// stored sorted by depth, so every parent comes before its children and one front to back pass
+// can compute world matrices. setLocal() only marks a node dirty; update() starts at the first
+// dirty node and recomputes exactly the dirty nodes and the subtrees under them, passing a
+// changed flag down from parent to child instead of recursing.
+//
+// Nodes are named by the handle add() returns, which stays the same when the arrays are sorted
+// again because a node was added above deeper ones.
+class SceneGraph
+{
+public:
+	SceneGraph();
+
+	int add(int parent, const glm::mat4& local);
+	void setLocal(int node, const glm::mat4& local);
+	const glm::mat4& local(int node) const;
+	// As of the last update()
+	const glm::mat4& world(int node) const;
+	int parent(int node) const;
+	int size() const;
+
+	// Marks every node dirty, for when something moved all of them
+	void invalidate();
+	// Brings every world matrix up to date and returns how many were recomputed
+	int update();
+
+private:
+	// everything below is indexed by slot, in depth order
+	vector<int> parents;	// slot of the parent, SCENE_ROOT at the top
+	vector<int> depths;
+	vector<glm::mat4> locals, worlds;
+	vector<unsigned char> dirty;	// local changed, or the node is new
+	vector<int> handles;	// handle of every slot
+
+	vector<int> slots;	// slot of every handle
+	int firstDirty;	// lowest dirty slot, size() when none
+	bool sorted;
+
+	void sort();
+};
+
+// Logs the cost of bringing 100000 node transforms up to date with 1% of the locals changing
+// every frame: the old recursive update over a std::list tree, the flat arrays recomputing
+// everything, and the flat arrays recomputing only what changed
+void benchmarkSceneGraph();
+
+#endif
@@ -1,6 +1,9 @@
 
 #include "Window.h"
 #include "Skybox.h"
+#include "RenderStats.h"
+#include "RenderQueue.h"
+#include "UnitCube.h"
 
 unsigned char* Skybox::loadPPM(const char* filename, int& width, int& height)
 {
@@ -57,53 +60,6 @@ unsigned char* Skybox::loadPPM(const char* filename, int& width, int& height)
 Skybox::Skybox(bool lorr)
 {
 	toWorld = glm::mat4(1.0f);
-	float scaleVal = 300.0f;
-
-	GLfloat skyboxVertices[] = {
-		// Positions          
-		-scaleVal,  scaleVal, -scaleVal,
-		-scaleVal, -scaleVal, -scaleVal,
-		scaleVal, -scaleVal, -scaleVal,
-		scaleVal, -scaleVal, -scaleVal,
-		scaleVal,  scaleVal, -scaleVal,
-		-scaleVal,  scaleVal, -scaleVal,
-
-		-scaleVal, -scaleVal,  scaleVal,
-		-scaleVal, -scaleVal, -scaleVal,
-		-scaleVal,  scaleVal, -scaleVal,
-		-scaleVal,  scaleVal, -scaleVal,
-		-scaleVal,  scaleVal,  scaleVal,
-		-scaleVal, -scaleVal,  scaleVal,
-
-		scaleVal, -scaleVal, -scaleVal,
-		scaleVal, -scaleVal,  scaleVal,
-		scaleVal,  scaleVal,  scaleVal,
-		scaleVal,  scaleVal,  scaleVal,
-		scaleVal,  scaleVal, -scaleVal,
-		scaleVal, -scaleVal, -scaleVal,
-
-		-scaleVal, -scaleVal,  scaleVal,
-		-scaleVal,  scaleVal,  scaleVal,
-		scaleVal,  scaleVal,  scaleVal,
-		scaleVal,  scaleVal,  scaleVal,
-		scaleVal, -scaleVal,  scaleVal,
-		-scaleVal, -scaleVal,  scaleVal,
-
-		-scaleVal,  scaleVal, -scaleVal,
-		scaleVal,  scaleVal, -scaleVal,
-		scaleVal,  scaleVal,  scaleVal,
-		scaleVal,  scaleVal,  scaleVal,
-		-scaleVal,  scaleVal,  scaleVal,
-		-scaleVal,  scaleVal, -scaleVal,
-
-		-scaleVal, -scaleVal, -scaleVal,
-		-scaleVal, -scaleVal,  scaleVal,
-		scaleVal, -scaleVal, -scaleVal,
-		scaleVal, -scaleVal, -scaleVal,
-		-scaleVal, -scaleVal,  scaleVal,
-		scaleVal, -scaleVal,  scaleVal
-	};
-
 	if (lorr) {
 		//list of names for skybox
 		skybox_faces.push_back("pt6/left-ppm/px.ppm");
@@ -123,15 +79,8 @@ Skybox::Skybox(bool lorr)
 		skybox_faces.push_back("pt6/right-ppm/nz.ppm");
 	}
 
-	// Setup skybox VAO
-	glGenVertexArrays(1, &skyboxVAO);
-	glGenBuffers(1, &skyboxVBO);
-	glBindVertexArray(skyboxVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
-	glBindVertexArray(0);
+	// sky.vert takes the positions as directions, so the cube's size doesn't matter
+	skyboxVAO = UnitCube::vao();
 	skyboxTexture = loadCubemap(skybox_faces);
 }
 
@@ -165,18 +114,26 @@ GLuint Skybox::loadCubemap(std::vector<const GLchar*> faces)
 
 void Skybox::draw(GLuint shaderProgram)
 {
-	GLuint uModel = glGetUniformLocation(shaderProgram, "model");
-
-	glUniformMatrix4fv(uModel, 1, GL_FALSE, &toWorld[0][0]);
-
-
+	// sky.vert has no model matrix, the sky is only ever turned by the view
 	glBindVertexArray(skyboxVAO);
 	glActiveTexture(GL_TEXTURE0);
 	glUniform1i(glGetUniformLocation(shaderProgram, "skybox"), 0);
 
 	glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxTexture);
-	glDrawArrays(GL_TRIANGLES, 0, 36);
+	glDrawArrays(GL_TRIANGLES, 0, UNIT_CUBE_VERTICES);
 	glBindVertexArray(0);
+	RenderStats::frame.drawCalls++;
+	RenderStats::frame.triangles += 12;
+	RenderStats::frame.vaoBinds += 2;
+	RenderStats::frame.textureBinds++;
+	RenderStats::frame.uniformLookups++;
+	RenderStats::frame.uniformUploads++;
 
 	glDepthMask(GL_TRUE);
 }
+
+void Skybox::submit(RenderQueue& queue, GLuint shaderProgram)
+{
+	DrawItem& item = queue.submit(shaderProgram, skyboxVAO, GL_TRIANGLES, 0, UNIT_CUBE_VERTICES, false, toWorld);
+	queue.setTexture(item, GL_TEXTURE_CUBE_MAP, skyboxTexture, "skybox");
+}
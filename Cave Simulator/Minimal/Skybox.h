@@ -6,6 +6,8 @@
 
 #include <vector>
 
+class RenderQueue;
+
 class Skybox
 {
 
@@ -13,9 +15,10 @@ public:
 	glm::mat4 toWorld;
 	Skybox(bool);
 	void draw(GLuint shaderProgram);
+	void submit(RenderQueue& queue, GLuint shaderProgram);
 private:
 
-	GLuint skyboxVAO, skyboxVBO;
+	GLuint skyboxVAO;	// the shared UnitCube
 	GLuint skyboxTexture;
 	std::vector<const GLchar*> skybox_faces;
 
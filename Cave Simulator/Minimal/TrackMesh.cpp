@@ -0,0 +1,330 @@
+#include "TrackMesh.h"
+#include "Profiler.h"
+
+#include <stdio.h>
+#include <math.h>
+#include <xmmintrin.h>
+#include <Windows.h>
+
+TrackMesh::TrackMesh()
+	: vao(0), vbo(0), segmentsWritten(0), bytesWritten(0)
+{
+}
+
+TrackMesh::~TrackMesh()
+{
+	if (this->vbo != 0)
+		glDeleteBuffers(1, &this->vbo);
+	if (this->vao != 0)
+		glDeleteVertexArrays(1, &this->vao);
+}
+
+int TrackMesh::update(const TrackSpline& spline, const TrackView& view)
+{
+	int count = spline.segmentCount();
+	const int slot = TRACK_MESH_MAX_STEPS + 1;
+	if (this->vao == 0)
+	{
+		glGenVertexArrays(1, &this->vao);
+		glGenBuffers(1, &this->vbo);
+		glBindVertexArray(this->vao);
+		glBindBuffer(GL_ARRAY_BUFFER, this->vbo);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (GLvoid*)0);
+		glBindVertexArray(0);
+	}
+
+	this->wanted.resize(count);
+	for (int i = 0; i < count; i++)
+		this->wanted[i] = steps(spline.controlPoints(i), view);
+
+	if (count != (int)this->revisions.size())
+	{
+		this->revisions.resize(count);
+		this->firsts.resize(count);
+		this->counts.resize(count);
+		for (int i = 0; i < count; i++)
+			this->firsts[i] = i * slot;
+		if (count == 0)
+			return 0;
+
+		// a new buffer is written straight through a mapping, without a copy on the side
+		GLsizeiptr bytes = count * slot * sizeof(glm::vec3);
+		glBindBuffer(GL_ARRAY_BUFFER, this->vbo);
+		glBufferData(GL_ARRAY_BUFFER, bytes, NULL, GL_DYNAMIC_DRAW);
+		glm::vec3* mapped = (glm::vec3*)glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		if (mapped != NULL)
+		{
+			for (int i = 0; i < count; i++)
+			{
+				tessellate(spline.controlPoints(i), this->wanted[i], mapped + i * slot);
+				this->revisions[i] = spline.revision(i);
+				this->counts[i] = this->wanted[i] + 1;
+			}
+		}
+		bool written = mapped != NULL && glUnmapBuffer(GL_ARRAY_BUFFER) == GL_TRUE;
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		if (written)
+		{
+			this->segmentsWritten += count;
+			this->bytesWritten += bytes;
+			return count;
+		}
+		// nothing in the buffer matches any revision, the loop below writes it all
+		this->revisions.assign(count, 0);
+	}
+
+	int written = 0;
+	int i = 0;
+	while (i < count)
+	{
+		if (this->revisions[i] == spline.revision(i) && this->counts[i] == this->wanted[i] + 1)
+		{
+			i++;
+			continue;
+		}
+		int last = i;
+		while (last + 1 < count && (this->revisions[last + 1] != spline.revision(last + 1) || this->counts[last + 1] != this->wanted[last + 1] + 1))
+			last++;
+		upload(spline, i, last);
+		written += last - i + 1;
+		i = last + 1;
+	}
+	this->segmentsWritten += written;
+	return written;
+}
+
+void TrackMesh::draw()
+{
+	if (this->revisions.empty())
+		return;
+	glBindVertexArray(this->vao);
+	glMultiDrawArrays(GL_LINE_STRIP, &this->firsts[0], &this->counts[0], (GLsizei)this->revisions.size());
+	glBindVertexArray(0);
+}
+
+int TrackMesh::steps(const glm::vec3* points, const TrackView& view)
+{
+	if (view.pixelAngle <= 0.0f)
+		return TRACK_MESH_MAX_STEPS;
+
+	// chords over n even steps stay within |B''| / (8 n^2) of a curve, and B'' of a cubic is
+	// linear in t, so its largest length is at one of the ends
+	float curvature = 6.0f * glm::max(glm::length(points[0] - 2.0f * points[1] + points[2]),
+		glm::length(points[1] - 2.0f * points[2] + points[3]));
+
+	// the error allowed grows with distance, measured to the nearest point of a sphere around the hull
+	glm::vec3 center = (points[0] + points[1] + points[2] + points[3]) * 0.25f;
+	float radius = 0.0f;
+	for (int i = 0; i < 4; i++)
+		radius = glm::max(radius, glm::length(points[i] - center));
+	float distance = glm::max(glm::length(view.eye - center) - radius, 0.1f);
+	float tolerance = view.maxPixels * view.pixelAngle * distance;
+
+	int n = (int)ceilf(sqrtf(curvature / (8.0f * tolerance)));
+	return glm::clamp(n, 1, TRACK_MESH_MAX_STEPS);
+}
+
+void TrackMesh::tessellate(const glm::vec3* points, int steps, glm::vec3* out)
+{
+	__m128 px[4], py[4], pz[4];
+	for (int k = 0; k < 4; k++)
+	{
+		px[k] = _mm_set1_ps(points[k].x);
+		py[k] = _mm_set1_ps(points[k].y);
+		pz[k] = _mm_set1_ps(points[k].z);
+	}
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 three = _mm_set1_ps(3.0f);
+	const __m128 lanes = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+	const __m128 step = _mm_set1_ps(1.0f / steps);
+
+	__declspec(align(16)) float x[4], y[4], z[4];
+	for (int i = 0; i <= steps; i += 4)
+	{
+		__m128 t = _mm_mul_ps(_mm_add_ps(_mm_set1_ps((float)i), lanes), step);
+		__m128 u = _mm_sub_ps(one, t);
+		__m128 tt = _mm_mul_ps(t, t);
+		__m128 uu = _mm_mul_ps(u, u);
+		// Bernstein weights of the four lanes
+		__m128 b0 = _mm_mul_ps(uu, u);
+		__m128 b1 = _mm_mul_ps(_mm_mul_ps(three, uu), t);
+		__m128 b2 = _mm_mul_ps(_mm_mul_ps(three, u), tt);
+		__m128 b3 = _mm_mul_ps(tt, t);
+
+		_mm_store_ps(x, _mm_add_ps(_mm_add_ps(_mm_mul_ps(b0, px[0]), _mm_mul_ps(b1, px[1])), _mm_add_ps(_mm_mul_ps(b2, px[2]), _mm_mul_ps(b3, px[3]))));
+		_mm_store_ps(y, _mm_add_ps(_mm_add_ps(_mm_mul_ps(b0, py[0]), _mm_mul_ps(b1, py[1])), _mm_add_ps(_mm_mul_ps(b2, py[2]), _mm_mul_ps(b3, py[3]))));
+		_mm_store_ps(z, _mm_add_ps(_mm_add_ps(_mm_mul_ps(b0, pz[0]), _mm_mul_ps(b1, pz[1])), _mm_add_ps(_mm_mul_ps(b2, pz[2]), _mm_mul_ps(b3, pz[3]))));
+
+		int lanesUsed = glm::min(4, steps + 1 - i);
+		for (int k = 0; k < lanesUsed; k++)
+			out[i + k] = glm::vec3(x[k], y[k], z[k]);
+	}
+	// exactly on the anchors, so neighbouring strips meet
+	out[0] = points[0];
+	out[steps] = points[3];
+}
+
+void TrackMesh::upload(const TrackSpline& spline, int first, int last)
+{
+	const int slot = TRACK_MESH_MAX_STEPS + 1;
+	int segments = last - first + 1;
+	this->vertices.resize(segments * slot);
+	for (int s = 0; s < segments; s++)
+	{
+		tessellate(spline.controlPoints(first + s), this->wanted[first + s], &this->vertices[s * slot]);
+		this->revisions[first + s] = spline.revision(first + s);
+		this->counts[first + s] = this->wanted[first + s] + 1;
+	}
+
+	// the unused ends of the ranges go along, one call for the run beats one per segment
+	GLsizeiptr bytes = segments * slot * sizeof(glm::vec3);
+	glBindBuffer(GL_ARRAY_BUFFER, this->vbo);
+	glBufferSubData(GL_ARRAY_BUFFER, first * slot * sizeof(glm::vec3), bytes, &this->vertices[0]);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	this->bytesWritten += bytes;
+}
+
+// A ring of segments with hills, each segment's first handle mirrored through its anchor
+static void buildStressTrack(TrackSpline& spline, int segments)
+{
+	spline.clear();
+	spline.setClosed(true);
+	float radius = segments * 0.5f;
+	glm::vec3 anchors[2], handles[2];
+	for (int i = 0; i <= segments; i++)
+	{
+		float angle = 6.2831853f * i / segments;
+		glm::vec3 anchor(radius * cosf(angle), 3.0f * sinf(angle * 37.0f), radius * sinf(angle));
+		glm::vec3 direction(-sinf(angle), 0.0f, cosf(angle));
+		anchors[1] = anchor;
+		handles[1] = anchor - direction * 0.5f;
+		if (i > 0)
+		{
+			glm::vec3 points[4] = { anchors[0], anchors[0] + (anchors[0] - handles[0]), handles[1], anchors[1] };
+			if (i == segments)
+				points[3] = spline.controlPoints(0)[0];
+			spline.addSegment(points);
+		}
+		anchors[0] = anchors[1];
+		handles[0] = handles[1];
+	}
+}
+
+void benchmarkTrackMesh()
+{
+	static const int SEGMENTS = 1000;
+	static const int EDITS = 500;
+	static const int REBUILDS = 50;
+
+	TrackSpline spline;
+	buildStressTrack(spline, SEGMENTS);
+	TrackMesh mesh;
+	mesh.update(spline);
+	glFinish();
+
+	// one control point dragged per edit, the way the mouse moves them, and waited on so the
+	// upload is part of what's measured
+	unsigned int seed = 12345;
+	double total = 0.0, worst = 0.0;
+	mesh.segmentsWritten = mesh.bytesWritten = 0;
+	for (int i = 0; i < EDITS; i++)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		int segment = (seed >> 8) % SEGMENTS;
+		int index = (seed >> 4) % 4;
+		double start = Profiler::now();
+		spline.moveControlPoint(segment, index, glm::vec3(0.0f, 0.05f, 0.0f));
+		mesh.update(spline);
+		glFinish();
+		double ms = Profiler::now() - start;
+		total += ms;
+		worst = ms > worst ? ms : worst;
+	}
+	unsigned int editSegments = mesh.segmentsWritten, editBytes = mesh.bytesWritten;
+
+	// what every drag used to cost, everything tessellated and uploaded again
+	double rebuild = 0.0;
+	for (int i = 0; i < REBUILDS; i++)
+	{
+		TrackMesh full;
+		double start = Profiler::now();
+		full.update(spline);
+		glFinish();
+		rebuild += Profiler::now() - start;
+	}
+
+	char buff[300];
+	sprintf_s(buff, "Track mesh, %d segments: edit %.3f ms (max %.3f) writing %.1f segments / %.0f bytes, full rebuild %.3f ms\n",
+		SEGMENTS, total / EDITS, worst, (double)editSegments / EDITS, (double)editBytes / EDITS, rebuild / REBUILDS);
+	OutputDebugStringA(buff);
+	printf("%s", buff);
+}
+
+void benchmarkTrackTessellation()
+{
+	static const int SIZES[3] = { 8, 1000, 100000 };
+	const int slot = TRACK_MESH_MAX_STEPS + 1;
+
+	for (int n = 0; n < 3; n++)
+	{
+		int segments = SIZES[n];
+		// small tracks are run again until every case evaluates about the same number of points
+		int repeats = glm::max(1, 100000 / segments);
+		TrackSpline spline;
+		buildStressTrack(spline, segments);
+		vector<glm::vec3> out(segments * slot);
+
+		double start = Profiler::now();
+		for (int r = 0; r < repeats; r++)
+		{
+			for (int s = 0; s < segments; s++)
+			{
+				const glm::vec3* points = spline.controlPoints(s);
+				for (int i = 0; i <= TRACK_MESH_MAX_STEPS; i++)
+					out[s * slot + i] = TrackSpline::bezier(points, (float)i / TRACK_MESH_MAX_STEPS);
+			}
+		}
+		double scalarMs = (Profiler::now() - start) / repeats;
+
+		start = Profiler::now();
+		for (int r = 0; r < repeats; r++)
+		{
+			for (int s = 0; s < segments; s++)
+				TrackMesh::tessellate(spline.controlPoints(s), TRACK_MESH_MAX_STEPS, &out[s * slot]);
+		}
+		double batchMs = (Profiler::now() - start) / repeats;
+
+		// standing on the track a little above it, with about the pixel size of the headset
+		TrackView view;
+		view.eye = spline.controlPoints(0)[0] + glm::vec3(0.0f, 2.0f, 0.0f);
+		view.pixelAngle = glm::radians(90.0f) / 1200.0f;
+		view.maxPixels = 0.5f;
+		long long vertices = 0;
+		start = Profiler::now();
+		for (int r = 0; r < repeats; r++)
+		{
+			vertices = 0;
+			for (int s = 0; s < segments; s++)
+			{
+				int steps = TrackMesh::steps(spline.controlPoints(s), view);
+				TrackMesh::tessellate(spline.controlPoints(s), steps, &out[vertices]);
+				vertices += steps + 1;
+			}
+		}
+		double adaptiveMs = (Profiler::now() - start) / repeats;
+
+		// and the whole path, mapped and written straight into the shared buffer
+		TrackMesh mesh;
+		start = Profiler::now();
+		mesh.update(spline, view);
+		glFinish();
+		double bufferMs = Profiler::now() - start;
+
+		char buff[300];
+		sprintf_s(buff, "Track tessellation, %d segments: one at a time %.3f ms, SSE %.3f ms, adaptive SSE %.3f ms at %.1f steps a segment, into the buffer %.3f ms\n",
+			segments, scalarMs, batchMs, adaptiveMs, (double)(vertices - segments) / segments, bufferMs);
+		OutputDebugStringA(buff);
+		printf("%s", buff);
+	}
+}
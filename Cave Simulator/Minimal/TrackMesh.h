@@ -0,0 +1,72 @@
+#ifndef TRACKMESH_H_
+#define TRACKMESH_H_
+
+#include <GL/glew.h>
+
+#include <vector>
+using namespace std;
+
+#include <glm/glm.hpp>
+
+#include "TrackSpline.h"
+
+// Most line strip steps a segment is cut into, its range in the buffer holds one vertex more
+#define TRACK_MESH_MAX_STEPS 32
+
+// What the adaptive tessellation aims for: no chord further than maxPixels from the curve it
+// stands in for, seen from eye with pixelAngle radians per pixel. A pixelAngle of 0 always
+// uses TRACK_MESH_MAX_STEPS.
+struct TrackView {
+	glm::vec3 eye;
+	float pixelAngle;
+	float maxPixels;
+
+	TrackView() : eye(0.0f), pixelAngle(0.0f), maxPixels(1.0f) {}
+};
+
+// The line strips of a TrackSpline in one vertex buffer, every segment in its own fixed range
+// with room for TRACK_MESH_MAX_STEPS steps. update() compares the revision of every segment
+// against the one it last uploaded, so after a control point is dragged only the one or two
+// segments around it are tessellated again and written with glBufferSubData; runs of
+// neighbouring changed segments go up in one call. Each segment gets as many steps as its
+// curvature needs at its distance from the view, and is written again when that changes.
+class TrackMesh
+{
+public:
+	TrackMesh();
+	~TrackMesh();
+
+	// Brings the buffer up to date with the spline and returns the number of segments written.
+	// A different segment count reallocates the buffer and writes everything straight into it.
+	int update(const TrackSpline& spline, const TrackView& view = TrackView());
+	// Draws every segment as a line strip with whatever program is bound
+	void draw();
+
+	GLuint vao, vbo;
+	unsigned int segmentsWritten, bytesWritten;
+
+	// Steps a segment needs so its chords stay within the view's error, from the bound on the
+	// second derivative of a cubic Bezier
+	static int steps(const glm::vec3* points, const TrackView& view);
+	// Writes steps + 1 points evenly spaced in the Bezier parameter, four at a time with SSE
+	static void tessellate(const glm::vec3* points, int steps, glm::vec3* out);
+
+private:
+	vector<unsigned int> revisions;	// revision of every segment as it is in the buffer
+	vector<int> wanted;	// steps every segment needs from the current view
+	vector<glm::vec3> vertices;	// scratch for one run of segments
+	vector<GLint> firsts;
+	vector<GLsizei> counts;
+
+	void upload(const TrackSpline& spline, int first, int last);
+};
+
+// Builds a 1000 segment track and logs how long dragging one control point takes to reach the
+// GPU, next to tessellating and uploading the whole track again. Needs a current GL context.
+void benchmarkTrackMesh();
+
+// Logs tessellation time for 8, 1000 and 100000 segments: one point at a time, the SSE batch
+// at the same fixed step count, and the SSE batch with adaptive steps. Needs a GL context.
+void benchmarkTrackTessellation();
+
+#endif
@@ -0,0 +1,452 @@
+#include "TrackSpline.h"
+#include "Profiler.h"
+
+#include <stdio.h>
+#include <math.h>
+#include <cfloat>
+#include <algorithm>
+#include <Windows.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+TrackSpline::TrackSpline()
+	: cacheHits(0), cacheMisses(0), closed(true), nextRevision(1), tick(1), nextEntry(0)
+{
+	this->starts.push_back(0.0f);
+	for (int i = 0; i < TRACK_CACHE_SIZE; i++)
+		this->cache[i].tick = 0;
+}
+
+void TrackSpline::clear()
+{
+	this->segments.clear();
+	this->starts.assign(1, 0.0f);
+	beginTick();
+}
+
+int TrackSpline::addSegment(const glm::vec3* points)
+{
+	Segment segment;
+	for (int i = 0; i < 4; i++)
+		segment.points[i] = points[i];
+	measure(segment);
+	segment.revision = this->nextRevision++;
+	this->segments.push_back(segment);
+	this->starts.push_back(0.0f);
+	updateStarts(this->segments.size() - 1);
+	beginTick();
+	return this->segments.size() - 1;
+}
+
+void TrackSpline::setSegment(int segment, const glm::vec3* points)
+{
+	Segment& target = this->segments[segment];
+	for (int i = 0; i < 4; i++)
+		target.points[i] = points[i];
+	measure(target);
+	target.revision = this->nextRevision++;
+	updateStarts(segment);
+	beginTick();
+}
+
+void TrackSpline::moveControlPoint(int segment, int index, const glm::vec3& offset)
+{
+	// the end anchor of a segment is the start anchor of the next one
+	if (index == 3 && neighbour(segment, 1) >= 0)
+	{
+		segment = neighbour(segment, 1);
+		index = 0;
+	}
+	int previous = neighbour(segment, -1);
+	int next = neighbour(segment, 1);
+	glm::vec3* p = this->segments[segment].points;
+	int first = segment, other = -1;
+
+	if (index == 0)
+	{
+		p[0] += offset;
+		p[1] += offset;
+		if (previous >= 0)
+		{
+			this->segments[previous].points[3] = p[0];
+			this->segments[previous].points[2] += offset;
+			other = previous;
+		}
+	}
+	else if (index == 1)
+	{
+		p[1] += offset;
+		if (previous >= 0)
+		{
+			this->segments[previous].points[2] = p[0] - (p[1] - p[0]);
+			other = previous;
+		}
+	}
+	else if (index == 2)
+	{
+		p[2] += offset;
+		if (next >= 0)
+		{
+			this->segments[next].points[1] = p[3] - (p[2] - p[3]);
+			other = next;
+		}
+	}
+	else
+	{
+		// the end of an open track
+		p[3] += offset;
+		p[2] += offset;
+	}
+
+	measure(this->segments[segment]);
+	this->segments[segment].revision = this->nextRevision++;
+	if (other >= 0)
+	{
+		measure(this->segments[other]);
+		this->segments[other].revision = this->nextRevision++;
+		// starting from the lower one also covers the last segment moving along with the first
+		first = glm::min(first, other);
+	}
+	updateStarts(first);
+	beginTick();
+}
+
+void TrackSpline::setClosed(bool closed)
+{
+	this->closed = closed;
+	beginTick();
+}
+
+bool TrackSpline::isClosed() const
+{
+	return this->closed;
+}
+
+int TrackSpline::segmentCount() const
+{
+	return this->segments.size();
+}
+
+float TrackSpline::length() const
+{
+	return this->starts.back();
+}
+
+const glm::vec3* TrackSpline::controlPoints(int segment) const
+{
+	return this->segments[segment].points;
+}
+
+unsigned int TrackSpline::revision(int segment) const
+{
+	return this->segments[segment].revision;
+}
+
+float TrackSpline::wrap(float distance) const
+{
+	float total = length();
+	if (total <= 0.0f)
+		return 0.0f;
+	if (!this->closed)
+		return glm::clamp(distance, 0.0f, total);
+	distance = fmodf(distance, total);
+	return distance < 0.0f ? distance + total : distance;
+}
+
+void TrackSpline::locate(float distance, int& segment, float& t) const
+{
+	if (this->segments.empty())
+	{
+		segment = 0;
+		t = 0.0f;
+		return;
+	}
+	distance = wrap(distance);
+
+	// last segment starting at or before the distance
+	segment = (int)(upper_bound(this->starts.begin(), this->starts.end() - 1, distance) - this->starts.begin()) - 1;
+	segment = glm::clamp(segment, 0, (int)this->segments.size() - 1);
+	const Segment& s = this->segments[segment];
+	float local = distance - this->starts[segment];
+
+	// then the table entries around it
+	int entry = (int)(upper_bound(s.table, s.table + TRACK_TABLE_SIZE + 1, local) - s.table) - 1;
+	entry = glm::clamp(entry, 0, TRACK_TABLE_SIZE - 1);
+	float span = s.table[entry + 1] - s.table[entry];
+	float f = span > 0.0f ? (local - s.table[entry]) / span : 0.0f;
+	t = (entry + glm::clamp(f, 0.0f, 1.0f)) / TRACK_TABLE_SIZE;
+}
+
+float TrackSpline::distanceAt(int segment, float t) const
+{
+	const Segment& s = this->segments[segment];
+	float scaled = glm::clamp(t, 0.0f, 1.0f) * TRACK_TABLE_SIZE;
+	int entry = glm::min((int)scaled, TRACK_TABLE_SIZE - 1);
+	float f = scaled - entry;
+	return this->starts[segment] + s.table[entry] + (s.table[entry + 1] - s.table[entry]) * f;
+}
+
+glm::vec3 TrackSpline::position(float distance) const
+{
+	int segment;
+	float t;
+	locate(distance, segment, t);
+	return bezier(this->segments[segment].points, t);
+}
+
+glm::vec3 TrackSpline::tangent(float distance) const
+{
+	int segment;
+	float t;
+	locate(distance, segment, t);
+	return glm::normalize(bezierDerivative(this->segments[segment].points, t));
+}
+
+float TrackSpline::slope(float distance) const
+{
+	int segment;
+	float t;
+	locate(distance, segment, t);
+	const Segment& s = this->segments[segment];
+	int entry = glm::min((int)(t * TRACK_TABLE_SIZE), TRACK_TABLE_SIZE - 1);
+	float span = s.table[entry + 1] - s.table[entry];
+	if (span <= 0.0f)
+		return 0.0f;
+	// dy/dt of the curve times dt/ds of the table entry the distance falls in
+	return bezierDerivative(s.points, t).y / (span * TRACK_TABLE_SIZE);
+}
+
+TrackFrame TrackSpline::frame(float distance) const
+{
+	int segment;
+	float t;
+	locate(distance, segment, t);
+	return frameAt(segment, t);
+}
+
+float TrackSpline::highest(float& height) const
+{
+	height = -FLT_MAX;
+	float distance = 0.0f;
+	for (unsigned int i = 0; i < this->segments.size(); i++)
+	{
+		if (this->segments[i].highest > height)
+		{
+			height = this->segments[i].highest;
+			distance = distanceAt(i, this->segments[i].highestT);
+		}
+	}
+	return distance;
+}
+
+float TrackSpline::lowestHeight() const
+{
+	float height = FLT_MAX;
+	for (unsigned int i = 0; i < this->segments.size(); i++)
+		height = glm::min(height, this->segments[i].lowest);
+	return height;
+}
+
+void TrackSpline::beginTick()
+{
+	this->tick++;
+}
+
+const TrackFrame& TrackSpline::cachedFrame(float distance)
+{
+	for (int i = 0; i < TRACK_CACHE_SIZE; i++)
+	{
+		if (this->cache[i].tick == this->tick && this->cache[i].distance == distance)
+		{
+			this->cacheHits++;
+			return this->cache[i].frame;
+		}
+	}
+	this->cacheMisses++;
+	CacheEntry& entry = this->cache[this->nextEntry];
+	this->nextEntry = (this->nextEntry + 1) % TRACK_CACHE_SIZE;
+	entry.tick = this->tick;
+	entry.distance = distance;
+	entry.frame = frame(distance);
+	return entry.frame;
+}
+
+glm::vec3 TrackSpline::bezier(const glm::vec3* p, float t)
+{
+	float u = 1.0f - t;
+	return (u * u * u) * p[0] + (3.0f * u * u * t) * p[1] + (3.0f * u * t * t) * p[2] + (t * t * t) * p[3];
+}
+
+glm::vec3 TrackSpline::bezierDerivative(const glm::vec3* p, float t)
+{
+	float u = 1.0f - t;
+	return (3.0f * u * u) * (p[1] - p[0]) + (6.0f * u * t) * (p[2] - p[1]) + (3.0f * t * t) * (p[3] - p[2]);
+}
+
+void TrackSpline::measure(Segment& segment)
+{
+	const int steps = TRACK_TABLE_SIZE * TRACK_TABLE_STEPS;
+	glm::vec3 previous = segment.points[0];
+	float length = 0.0f;
+	segment.table[0] = 0.0f;
+	segment.highest = segment.lowest = previous.y;
+	segment.highestT = 0.0f;
+	for (int i = 1; i <= steps; i++)
+	{
+		float t = (float)i / steps;
+		glm::vec3 point = bezier(segment.points, t);
+		length += glm::length(point - previous);
+		previous = point;
+		if (i % TRACK_TABLE_STEPS == 0)
+			segment.table[i / TRACK_TABLE_STEPS] = length;
+		if (point.y > segment.highest)
+		{
+			segment.highest = point.y;
+			segment.highestT = t;
+		}
+		segment.lowest = glm::min(segment.lowest, point.y);
+	}
+	segment.length = length;
+}
+
+void TrackSpline::updateStarts(int from)
+{
+	for (unsigned int i = from; i < this->segments.size(); i++)
+		this->starts[i + 1] = this->starts[i] + this->segments[i].length;
+}
+
+int TrackSpline::neighbour(int segment, int step) const
+{
+	int count = this->segments.size();
+	int other = segment + step;
+	if (other < 0 || other >= count)
+		return this->closed ? (other + count) % count : -1;
+	return other;
+}
+
+TrackFrame TrackSpline::frameAt(int segment, float t) const
+{
+	const glm::vec3* p = this->segments[segment].points;
+	TrackFrame frame;
+	frame.position = bezier(p, t);
+	frame.tangent = glm::normalize(bezierDerivative(p, t));
+	// straight up or down has no sideways direction of its own, borrow one
+	glm::vec3 up = fabsf(frame.tangent.y) > 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	frame.binormal = glm::normalize(glm::cross(frame.tangent, up));
+	frame.normal = glm::cross(frame.binormal, frame.tangent);
+	return frame;
+}
+
+void buildDefaultLoop(TrackSpline& spline)
+{
+	spline.clear();
+	spline.setClosed(true);
+
+	glm::vec3 a1(-4.142135624f, 0.0f, 10.0f);
+	glm::vec3 s1(-2.0f, 2.0f, 10.0f);
+	glm::vec3 ay2(4.142135624f, 0.0f, 10.0f);
+	glm::vec3 es2(2.0f, -2.0f, 10.0f);
+	glm::vec3 points[4] = { a1, s1, es2, ay2 };
+	spline.addSegment(points);
+
+	// every following segment is the first turned another 45 degrees, with its first control
+	// point mirrored through the shared anchor so the track stays C1 continuous
+	glm::mat4 rotation = glm::rotate(glm::mat4(1.0f), glm::radians(45.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	for (int i = 0; i < 7; i++)
+	{
+		glm::vec3 ay1 = ay2;
+		glm::vec3 es1 = ay1 - (es2 - ay1);
+		if (i == 6)
+		{
+			es2 = a1 - (s1 - a1);
+			ay2 = a1;
+		}
+		else
+		{
+			es2 = glm::vec3(rotation * glm::vec4(es2, 1.0f));
+			ay2 = glm::vec3(rotation * glm::vec4(ay2, 1.0f));
+		}
+		glm::vec3 next[4] = { ay1, es1, es2, ay2 };
+		spline.addSegment(next);
+	}
+}
+
+// Coefficient of variation and extremes of the distance moved per step, relative to the mean
+static void logSteps(const char* label, const vector<glm::vec3>& positions)
+{
+	vector<float> steps;
+	for (unsigned int i = 1; i < positions.size(); i++)
+		steps.push_back(glm::length(positions[i] - positions[i - 1]));
+	double sum = 0.0, squares = 0.0;
+	float lo = FLT_MAX, hi = 0.0f;
+	for (unsigned int i = 0; i < steps.size(); i++)
+	{
+		sum += steps[i];
+		squares += (double)steps[i] * steps[i];
+		lo = glm::min(lo, steps[i]);
+		hi = glm::max(hi, steps[i]);
+	}
+	double mean = sum / steps.size();
+	double deviation = sqrt(glm::max(0.0, squares / steps.size() - mean * mean));
+
+	char buff[300];
+	sprintf_s(buff, "Track spline, %s: step %.4f, min %.0f%% max %.0f%% of it, variation %.2f%%\n",
+		label, mean, lo / mean * 100.0, hi / mean * 100.0, deviation / mean * 100.0);
+	OutputDebugStringA(buff);
+	printf("%s", buff);
+}
+
+void benchmarkTrackSpline()
+{
+	static const int QUERIES = 1000000;
+	static const int LAP_STEPS = 2000;
+
+	TrackSpline spline;
+	buildDefaultLoop(spline);
+
+	// random distances so neither search can ride on the previous answer
+	unsigned int seed = 12345;
+	float checksum = 0.0f;
+	double start = Profiler::now();
+	for (int i = 0; i < QUERIES; i++)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		float distance = (seed >> 8) * (1.0f / 16777216.0f) * spline.length();
+		checksum += spline.frame(distance).position.y;
+	}
+	double frameMs = Profiler::now() - start;
+
+	// the old tick: two positions, each asked for four times
+	start = Profiler::now();
+	float distance = 0.0f;
+	for (int i = 0; i < QUERIES / 8; i++)
+	{
+		spline.beginTick();
+		float previous = distance;
+		distance = spline.wrap(distance + 0.05f);
+		for (int k = 0; k < 4; k++)
+		{
+			checksum += spline.cachedFrame(distance).position.x;
+			checksum += spline.cachedFrame(previous).position.x;
+		}
+	}
+	double tickMs = Profiler::now() - start;
+
+	char buff[300];
+	sprintf_s(buff, "Track spline, %d segments %.2f long: %.2f M frame queries/s, %.2f M ticks/s with %u of %u frames from the cache (%g)\n",
+		spline.segmentCount(), spline.length(), QUERIES / frameMs / 1000.0, QUERIES / 8 / tickMs / 1000.0,
+		spline.cacheHits, spline.cacheHits + spline.cacheMisses, checksum);
+	OutputDebugStringA(buff);
+	printf("%s", buff);
+
+	// one lap at a fixed distance per step, against one lap at a fixed parameter per step
+	vector<glm::vec3> byDistance, byParameter;
+	for (int i = 0; i <= LAP_STEPS; i++)
+	{
+		byDistance.push_back(spline.position(spline.length() * i / LAP_STEPS));
+		float u = (float)i * spline.segmentCount() / LAP_STEPS;
+		int segment = glm::min((int)u, spline.segmentCount() - 1);
+		byParameter.push_back(TrackSpline::bezier(spline.controlPoints(segment), u - segment));
+	}
+	logSteps("fixed distance", byDistance);
+	logSteps("fixed Bezier parameter", byParameter);
+}
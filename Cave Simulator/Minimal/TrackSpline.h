@@ -0,0 +1,116 @@
+#ifndef TRACKSPLINE_H_
+#define TRACKSPLINE_H_
+
+#include <vector>
+using namespace std;
+
+#include <glm/glm.hpp>
+
+// Arc length samples kept per segment, at evenly spaced Bezier parameters
+#define TRACK_TABLE_SIZE 64
+// Chords measured between two table entries when a segment is built
+#define TRACK_TABLE_STEPS 8
+// Distinct frames remembered per tick
+#define TRACK_CACHE_SIZE 4
+
+// Where the car is and which way it faces
+struct TrackFrame {
+	glm::vec3 position;
+	glm::vec3 tangent;	// unit direction of travel
+	glm::vec3 normal;	// unit, as close to world up as the tangent allows
+	glm::vec3 binormal;	// unit, tangent x normal
+};
+
+// A chain of cubic Bezier segments queried by distance along the track instead of by Bezier
+// parameter, so moving a fixed distance per step gives the same speed everywhere. Every segment
+// keeps a table of arc length at evenly spaced parameters; a query finds its segment with a
+// binary search over the segment start distances and its parameter with a second one over that
+// table, then interpolates between the two entries around it.
+class TrackSpline
+{
+public:
+	TrackSpline();
+
+	void clear();
+	// Appends a segment through four control points and returns its index
+	int addSegment(const glm::vec3* points);
+	// Replaces the control points of one segment and measures it again
+	void setSegment(int segment, const glm::vec3* points);
+	// Moves one control point (0 to 3) of a segment and keeps the track C1 continuous: an anchor
+	// takes both handles around it along and is shared with the neighbouring segment, a handle
+	// mirrors the opposite one through its anchor. At most two segments are measured again.
+	void moveControlPoint(int segment, int index, const glm::vec3& offset);
+	// A closed track wraps distances around, an open one clamps them to its ends
+	void setClosed(bool closed);
+	bool isClosed() const;
+
+	int segmentCount() const;
+	float length() const;
+	const glm::vec3* controlPoints(int segment) const;
+	// Changes every time the segment's control points do, never repeats within a spline
+	unsigned int revision(int segment) const;
+
+	float wrap(float distance) const;
+	// Segment and Bezier parameter at a distance along the track
+	void locate(float distance, int& segment, float& t) const;
+	// Distance along the track of a Bezier parameter on a segment
+	float distanceAt(int segment, float t) const;
+
+	glm::vec3 position(float distance) const;
+	glm::vec3 tangent(float distance) const;
+	// Rate of change of position(distance).y with distance, taken through the arc length table
+	// so integrating it around a closed track comes back to exactly zero
+	float slope(float distance) const;
+	TrackFrame frame(float distance) const;
+
+	// Distance of the highest point on the track, found while the segments were measured
+	float highest(float& height) const;
+	float lowestHeight() const;
+
+	// Frames asked for again within the same tick come out of a small cache instead of
+	// being evaluated again; beginTick forgets them
+	void beginTick();
+	const TrackFrame& cachedFrame(float distance);
+	unsigned int cacheHits, cacheMisses;
+
+	static glm::vec3 bezier(const glm::vec3* p, float t);
+	static glm::vec3 bezierDerivative(const glm::vec3* p, float t);
+
+private:
+	struct Segment {
+		glm::vec3 points[4];
+		float length;
+		float table[TRACK_TABLE_SIZE + 1];	// arc length from the segment start at t = i / TRACK_TABLE_SIZE
+		float highest, highestT, lowest;
+		unsigned int revision;
+	};
+
+	struct CacheEntry {
+		unsigned int tick;
+		float distance;
+		TrackFrame frame;
+	};
+
+	vector<Segment> segments;
+	vector<float> starts;	// distance at the start of every segment, followed by the total length
+	bool closed;
+	unsigned int nextRevision;
+
+	CacheEntry cache[TRACK_CACHE_SIZE];
+	unsigned int tick, nextEntry;
+
+	void measure(Segment& segment);
+	void updateStarts(int from);
+	// Neighbouring segment, -1 past the ends of an open track
+	int neighbour(int segment, int step) const;
+	TrackFrame frameAt(int segment, float t) const;
+};
+
+// Lays out the eight segment loop Window::init_tracks builds for the coaster
+void buildDefaultLoop(TrackSpline& spline);
+
+// Logs frame queries per second and how evenly a fixed distance step moves along the loop,
+// next to stepping the raw Bezier parameter the way the coaster used to
+void benchmarkTrackSpline();
+
+#endif
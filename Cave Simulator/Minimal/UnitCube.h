@@ -0,0 +1,24 @@
+#ifndef UNITCUBE_H_
+#define UNITCUBE_H_
+
+#include <GL/glew.h>
+
+// Positions in the cube, two triangles a face
+#define UNIT_CUBE_VERTICES 36
+
+// The cube from -1 to 1 as positions at attribute 0, in one VAO shared by the skyboxes and the
+// test pattern cube, which size it with their model matrices instead of baking their own copies.
+// The VAO is made on first use in the current context.
+class UnitCube
+{
+public:
+	static GLuint vao();
+	static void release();
+
+	static const GLfloat positions[UNIT_CUBE_VERTICES * 3];
+
+private:
+	static GLuint array, buffer;
+};
+
+#endif
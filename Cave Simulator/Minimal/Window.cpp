@@ -3,6 +3,7 @@
 
 GLint Window::shaderProgram;
 GLint skyboxShader;
+GLint skyShader;
 GLint caveShader;
 GLuint Window::lineShader;
 Model* Window::factory;
@@ -15,6 +16,10 @@ Skybox* Window::skybox;
 Cube* Window::cube;
 Cave* Window::cave;
 
+RenderQueue Window::queue;
+bool Window::useQueue = true;
+bool Window::skyFirst = false;
+
 void Window::initialize(ovrSession& _session) {
 	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
 	glEnable(GL_DEPTH_TEST);
@@ -30,8 +35,10 @@ void Window::initialize(ovrSession& _session) {
 
 	lineShader = LoadShaders("../trackshader.vert", "../trackshader.frag");
 	skyboxShader = LoadShaders("../skybox.vert", "../skybox.frag");
+	skyShader = LoadShaders("../sky.vert", "../skybox.frag");
 	caveShader = LoadShaders("../caveShader.vert", "../caveShader.frag");
 	shaderProgram = caveShader;
+	ShaderManager::reportStartup();
 }
 
 void Window::reset(ovrSession& _session) {
@@ -43,14 +50,56 @@ void Window::reset(ovrSession& _session) {
 
 void Window::displayCallback(const glm::mat4 & projection, const glm::mat4 & headPose) {
 
+	if (skyFirst) {
+		drawSky(projection, headPose);
+	}
+
+	if (useQueue) {
+		queue.begin(projection, glm::inverse(headPose));
+		cube->submit(queue, skyboxShader);
+		queue.flush();
+		return;
+	}
 
 	glUseProgram(skyboxShader);
+	RenderStats::frame.programBinds++;
 	GLuint uProjection = glGetUniformLocation(skyboxShader, "projection");
 	GLuint uModelView = glGetUniformLocation(skyboxShader, "view");
 
 	glUniformMatrix4fv(uProjection, 1, GL_FALSE, glm::value_ptr(projection));
 	glUniformMatrix4fv(uModelView, 1, GL_FALSE, glm::value_ptr(glm::inverse(headPose)));
-	skybox->draw(skyboxShader);
+	RenderStats::frame.uniformLookups += 2;
+	RenderStats::frame.uniformUploads += 2;
 	cube->draw(skyboxShader);
 
+}
+
+void Window::drawSky(const glm::mat4 & projection, const glm::mat4 & headPose) {
+
+	// the sky's depth equals the cleared depth; drawn first it mustn't hide the scene behind it
+	glDepthFunc(GL_LEQUAL);
+	if (skyFirst) {
+		glDepthMask(GL_FALSE);
+	}
+
+	if (useQueue) {
+		queue.begin(projection, glm::inverse(headPose));
+		skybox->submit(queue, skyShader);
+		queue.flush();
+	}
+	else {
+		glUseProgram(skyShader);
+		RenderStats::frame.programBinds++;
+		GLuint uProjection = glGetUniformLocation(skyShader, "projection");
+		GLuint uModelView = glGetUniformLocation(skyShader, "view");
+
+		glUniformMatrix4fv(uProjection, 1, GL_FALSE, glm::value_ptr(projection));
+		glUniformMatrix4fv(uModelView, 1, GL_FALSE, glm::value_ptr(glm::inverse(headPose)));
+		RenderStats::frame.uniformLookups += 2;
+		RenderStats::frame.uniformUploads += 2;
+		skybox->draw(skyShader);
+	}
+
+	glDepthMask(GL_TRUE);
+	glDepthFunc(GL_LESS);
 }
\ No newline at end of file
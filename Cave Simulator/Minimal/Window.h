@@ -9,6 +9,8 @@
 #include "Cube.h"
 #include "Cave.h"
 #include "Skybox.h"
+#include "RenderStats.h"
+#include "RenderQueue.h"
 #include <ctime>
 
 #include <OVR_CAPI.h>
@@ -130,10 +132,20 @@ public:
 	static Skybox* skybox;
 	static Cave* cave;
 
+	// every pass is sorted and issued through the queue unless useQueue is off
+	static RenderQueue queue;
+	static bool useQueue;
+	// draws the sky at the start of displayCallback under everything, the way it used to be,
+	// instead of leaving it to drawSky once the rest of the scene is in
+	static bool skyFirst;
+
 	// methods
 	static void initialize(ovrSession&);
 	static void reset(ovrSession&);
 	static void displayCallback(const glm::mat4 &, const glm::mat4 &);
+	// The sky at depth 1 with GL_LEQUAL, after every other draw of the eye so early depth
+	// testing skips whatever is covered
+	static void drawSky(const glm::mat4 &, const glm::mat4 &);
 private:
 
 
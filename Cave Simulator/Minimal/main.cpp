@@ -31,6 +31,16 @@ limitations under the License.
 
 // HERES MY INCLUDES
 #include "Window.h"
+#include "Profiler.h"
+#include "FrameContext.h"
+#include "TrackSpline.h"
+#include "TrackMesh.h"
+#include "PointPicker.h"
+#include "CoasterDynamics.h"
+#include "SceneGraph.h"
+#include "Pool.h"
+#include "CoasterScene.h"
+#include "RideCamera.h"
 
 
 
@@ -200,9 +210,20 @@ public:
 		while (!glfwWindowShouldClose(window)) {
 			++frame;
 			glfwPollEvents();
-			update();
-			draw();
-			finishFrame();
+			Profiler::beginFrame(frame);
+			{
+				PROFILE_SCOPE("update");
+				update();
+			}
+			{
+				PROFILE_SCOPE("draw");
+				draw();
+			}
+			{
+				PROFILE_SCOPE("finishFrame");
+				finishFrame();
+			}
+			Profiler::endFrame();
 		}
 
 		shutdownGl();
@@ -346,9 +367,6 @@ public:
 	int aMode = 0;
 	int bMode = 0;
 
-	bool aPress = false;
-	bool bPress = false;
-
 	// Holds Position and Orientation
 	ovrVector3f headPosition;
 
@@ -369,7 +387,26 @@ public:
 
 	Remote* remote;
 
+	// number of upcoming frames whose render stats get logged, set by the Q key
+	int statsFrames = 0;
+	// wall FBO passes left to count fragments of, the sky drawn first and then last; set by the S key
+	int skyFrames = 0;
+	GLuint fragmentQuery = 0;
+	GLuint64 skyFragments[2];
+
+protected:
+	// tracking and input of the frame being drawn
+	FrameContext frameContext;
+	// turns the one controller read per frame into snapshots with press and release events
+	InputSystem input;
+
 private:
+	// when the eye poses were last read, right before the eyes were drawn
+	double _latchTime{ 0.0 };
+	// predicted display time minus latch time, summed until the next latency report
+	double _latencySum{ 0.0 };
+	int _latencyFrames{ 0 };
+
 	GLuint _fbo{ 0 };
 	GLuint _depthBuffer{ 0 };
 	ovrTextureSwapChain _eyeTexture;
@@ -549,6 +586,8 @@ protected:
 
 		remote = new Remote();
 
+		Profiler::initialize();
+
 	}
 
 	void onKey(int key, int scancode, int action, int mods) override {
@@ -561,14 +600,72 @@ protected:
 		GlfwApp::onKey(key, scancode, action, mods);
 	}
 
+	// Reads tracking and input once at the top of the frame, for input handling and the wall
+	// FBOs. The headset view is drawn with poses read again by latchEyePoses after those.
+	void sampleFrame() {
+		frameContext.frame = frame;
+		frameContext.predictedDisplayTime = ovr_GetPredictedDisplayTime(_session, frame);
+		frameContext.sampleTime = ovr_GetTimeInSeconds();
+		ovrTrackingState trackState = ovr_GetTrackingState(_session, frameContext.predictedDisplayTime, ovrTrue);
+
+		frameContext.headPose = trackState.HeadPose.ThePose;
+		ovr_CalcEyePoses(frameContext.headPose, _viewScaleDesc.HmdToEyeOffset, frameContext.eyePoses);
+		for (int hand = 0; hand < 2; hand++) {
+			frameContext.handPoses[hand] = trackState.HandPoses[hand].ThePose;
+			frameContext.handStatusFlags[hand] = trackState.HandStatusFlags[hand];
+		}
+		frameContext.input = input.poll(_session);
+	}
+
+	// Reads the head again right before the eyes are drawn, so the views and the layer's render
+	// poses are predicted from sensor data newer than the wall FBOs rendered before them
+	void latchEyePoses(ovrPosef eyePoses[2]) {
+		_latchTime = ovr_GetTimeInSeconds();
+		ovrTrackingState trackState = ovr_GetTrackingState(_session, frameContext.predictedDisplayTime, ovrTrue);
+		ovr_CalcEyePoses(trackState.HeadPose.ThePose, _viewScaleDesc.HmdToEyeOffset, eyePoses);
+		_sceneLayer.SensorSampleTime = _latchTime;
+	}
+
+	// Logs the average predicted latency every 90 frames next to the compositor's own measurement
+	void reportLatency() {
+		_latencySum += frameContext.predictedDisplayTime - _latchTime;
+		if (++_latencyFrames < 90) {
+			return;
+		}
+
+		float measured = -1.0f;
+		ovrPerfStats perfStats;
+		if (OVR_SUCCESS(ovr_GetPerfStats(_session, &perfStats)) && perfStats.FrameStatsCount > 0) {
+			measured = perfStats.FrameStats[0].AppMotionToPhotonLatency * 1000.0f;
+		}
+
+		char buff[200];
+		sprintf_s(buff, "Motion-to-photon: %.2f ms predicted at sampling, %.2f ms measured by the compositor\n",
+			_latencySum / _latencyFrames * 1000.0, measured);
+		OutputDebugStringA(buff);
+		printf("%s", buff);
+		_latencySum = 0.0;
+		_latencyFrames = 0;
+	}
+
 	// after generating frame buffer textures, render the cave to the final default frame buffer
 	void renderCave(const glm::mat4 & projection, const glm::mat4 & headPose, GLuint * texes) {
+		if (Window::useQueue) {
+			Window::queue.begin(projection, glm::inverse(headPose));
+			Window::cave->submit(Window::queue, Window::shaderProgram, texes);
+			Window::queue.flush();
+			return;
+		}
+
 		glUseProgram(Window::shaderProgram);
 		GLuint uProjection = glGetUniformLocation(Window::shaderProgram, "projection");
 		GLuint uModelView = glGetUniformLocation(Window::shaderProgram, "view");
 
 		glUniformMatrix4fv(uProjection, 1, GL_FALSE, glm::value_ptr(projection));
 		glUniformMatrix4fv(uModelView, 1, GL_FALSE, glm::value_ptr(glm::inverse(headPose)));
+		RenderStats::frame.programBinds++;
+		RenderStats::frame.uniformLookups += 2;
+		RenderStats::frame.uniformUploads += 2;
 		Window::cave->draw(Window::shaderProgram, texes);
 	}
 
@@ -642,20 +739,20 @@ protected:
 	}
 
 	void draw() final override {
-		ovrPosef eyePoses[2];
+		RenderStats::reset();
 
-		ovr_GetEyePoses(_session, frame, true, _viewScaleDesc.HmdToEyeOffset, eyePoses, &_sceneLayer.SensorSampleTime);
+		sampleFrame();
+		handleInput();
 
-		double displayMidpointSeconds = ovr_GetPredictedDisplayTime(_session, frame);
-		ovrTrackingState trackState = ovr_GetTrackingState(_session, displayMidpointSeconds, ovrTrue);
-		ovrPosef handPoses[2];
+		// copies, the hand view shifts the controller pose per eye
+		ovrPosef eyePoses[2] = { frameContext.eyePoses[0], frameContext.eyePoses[1] };
+		ovrPosef handPoses[2] = { frameContext.handPoses[0], frameContext.handPoses[1] };
 		ovrPosef headState;
 
 		// Grab head and hand poses
-		headState = trackState.HeadPose.ThePose;
+		headState = frameContext.headPose;
 		ovrVector3f headPos = headState.Position;
 
-		handPoses[ovrHand_Right] = trackState.HandPoses[ovrHand_Right].ThePose;
 		ovrQuatf rightOrient = handPoses[ovrHand_Right].Orientation;
 		ovrVector3f rightPos = handPoses[ovrHand_Right].Position;
 
@@ -667,12 +764,36 @@ protected:
 
 		// VIRTUAL CAVE SPACE MOTHERFUCKER
 		if (!freezeMode) {
+			PROFILE_SCOPE("wall FBOs");
+			Profiler::beginPass("wall FBOs");
+			if (skyFrames > 0) {
+				Window::skyFirst = skyFrames == 2;
+				if (fragmentQuery == 0) {
+					glGenQueries(1, &fragmentQuery);
+				}
+				glBeginQuery(GL_SAMPLES_PASSED, fragmentQuery);
+			}
 			oneFrameBuffer(0, eyePoses, handPoses);
 			oneFrameBuffer(1, eyePoses, handPoses);
 			oneFrameBuffer(2, eyePoses, handPoses);
+			if (skyFrames > 0) {
+				glEndQuery(GL_SAMPLES_PASSED);
+				// waits on the GPU, but only for the two frames being measured
+				glGetQueryObjectui64v(fragmentQuery, GL_QUERY_RESULT, &skyFragments[2 - skyFrames]);
+				if (--skyFrames == 0) {
+					Window::skyFirst = false;
+					char buff[200];
+					sprintf_s(buff, "Wall FBOs, fragments passing the depth test: %llu with the sky first, %llu with it last (%.1f%% fewer)\n",
+						skyFragments[0], skyFragments[1], skyFragments[0] > 0 ? 100.0 - 100.0 * skyFragments[1] / skyFragments[0] : 0.0);
+					OutputDebugStringA(buff);
+					printf("%s", buff);
+				}
+			}
+			Profiler::endPass();
 		}
 
 		// REAL RIFT SPACE MOTHERFUCKER
+		latchEyePoses(eyePoses);
 		int curIndex;
 		ovr_GetTextureSwapChainCurrentIndex(_session, _eyeTexture, &curIndex);
 		GLuint curTexId;
@@ -693,18 +814,32 @@ protected:
 			eyePositions[eye] = eyePoses[eye].Position;
 			eyeOrientations[eye] = eyePoses[eye].Orientation;
 
+			Profiler::pushScope("CAVE composite");
+			Profiler::beginPass("CAVE composite");
 			if(eye == ovrEye_Left) renderCave(_eyeProjections[eye], ovr::toGlm(eyePoses[eye]), left_texes);
 			else  renderCave(_eyeProjections[eye], ovr::toGlm(eyePoses[eye]), right_texes);
+			Profiler::endPass();
+			Profiler::popScope();
 
 			//Draw lines (pyramids)
 
 
-			glUseProgram(Window::lineShader);
-			GLuint uProjection = glGetUniformLocation(Window::lineShader, "projection");
-			GLuint uModelView = glGetUniformLocation(Window::lineShader, "view");
-
-			glUniformMatrix4fv(uProjection, 1, GL_FALSE, glm::value_ptr(_eyeProjections[eye]));
-			glUniformMatrix4fv(uModelView, 1, GL_FALSE, glm::value_ptr(glm::inverse(ovr::toGlm(eyePoses[eye]))));
+			Profiler::pushScope("debug lines");
+			Profiler::beginPass("debug lines");
+			if (Window::useQueue) {
+				Window::queue.begin(_eyeProjections[eye], glm::inverse(ovr::toGlm(eyePoses[eye])));
+			}
+			else {
+				glUseProgram(Window::lineShader);
+				GLuint uProjection = glGetUniformLocation(Window::lineShader, "projection");
+				GLuint uModelView = glGetUniformLocation(Window::lineShader, "view");
+
+				glUniformMatrix4fv(uProjection, 1, GL_FALSE, glm::value_ptr(_eyeProjections[eye]));
+				glUniformMatrix4fv(uModelView, 1, GL_FALSE, glm::value_ptr(glm::inverse(ovr::toGlm(eyePoses[eye]))));
+				RenderStats::frame.programBinds++;
+				RenderStats::frame.uniformLookups += 2;
+				RenderStats::frame.uniformUploads += 2;
+			}
 
 
 			if (debugMode) {
@@ -822,102 +957,100 @@ protected:
 					}
 
 					for (int j = 0; j < linesToDraw.size(); j += 2) {
-						remote->Draw(Window::lineShader, linesToDraw[j], linesToDraw[j + 1]);
+						if (Window::useQueue) remote->Submit(Window::queue, Window::lineShader, linesToDraw[j], linesToDraw[j + 1]);
+						else remote->Draw(Window::lineShader, linesToDraw[j], linesToDraw[j + 1]);
 					}
 
 				}
 					
 			}
 
+			if (Window::useQueue) Window::queue.flush();
+			Profiler::endPass();
+			Profiler::popScope();
 
-
+			Profiler::drawOverlay();
 		});
 
 		glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
 		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
 		ovr_CommitTextureSwapChain(_session, _eyeTexture);
 		ovrLayerHeader* headerList = &_sceneLayer.Header;
+		Profiler::pushScope("ovr_SubmitFrame");
 		ovr_SubmitFrame(_session, frame, &_viewScaleDesc, &headerList, 1);
+		Profiler::popScope();
+		reportLatency();
 
+		Profiler::pushScope("mirror blit");
+		Profiler::beginPass("mirror blit");
 		GLuint mirrorTextureId;
 		ovr_GetMirrorTextureBufferGL(_session, _mirrorTexture, &mirrorTextureId);
 		glBindFramebuffer(GL_READ_FRAMEBUFFER, _mirrorFbo);
 		glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mirrorTextureId, 0);
 		glBlitFramebuffer(0, 0, _mirrorSize.x, _mirrorSize.y, 0, _mirrorSize.y, _mirrorSize.x, 0, GL_COLOR_BUFFER_BIT, GL_NEAREST);
 		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+		Profiler::endPass();
+		Profiler::popScope();
+
+		if (statsFrames > 0) {
+			RenderStats::report(Window::useQueue ? "render queue" : "immediate draws");
+			statsFrames--;
+		}
 	}
 
-	void update() final override
+	// Applies the controller snapshot of this frame, called once right after it is sampled
+	void handleInput()
 	{
-		ovrInputState inputState;
+		const InputSnapshot& inputState = frameContext.input;
 
-		if (OVR_SUCCESS(ovr_GetInputState(_session, ovrControllerType_Touch, &inputState)))
+		if (inputState.valid)
 		{
 
 			// RIGHT HAND TRIGGER: Switch Viewpoint Between Head/Eyes and Right Controller
-			if (inputState.HandTrigger[ovrHand_Right] > 0.5f) {
-
-				// Switch viewpoint to right controller
-				handView = true;
-			}
-			else {
-				// Switch viewpoint back to User's head
-				handView = false;
-			}
+			handView = inputState.held(INPUT_RIGHT_HAND_TRIGGER);
 
 			// B BUTTON: Toggle Viewpoint Freezing
-			if (inputState.Buttons & ovrButton_B) {
-				bPress = true;
-			}
-			else if (bPress) {
-				// Toggle Freeze Mode
+			if (inputState.wasReleased(ovrButton_B)) {
 				freezeMode = !freezeMode;
-				bPress = false;
 			}
 
 			// A BUTTON: Toggle Debug Mode
-			if (inputState.Buttons & ovrButton_A)
-			{
-				aPress = true;
-			}
-			else if (aPress) {
-				// Toggle Debug Mode
+			if (inputState.wasReleased(ovrButton_A)) {
 				debugMode = !debugMode;
-				aPress = false;
 			}
 
 			// RIGHT THUMBSTICK: Move Cube Back/Forth and Scale Bigger/Smaller
-			if (inputState.Thumbstick[ovrHand_Right].x > 0.0f && inputState.Thumbstick[ovrHand_Right].y < 0.2f && inputState.Thumbstick[ovrHand_Right].y > -0.2f) {
+			if (inputState.thumbstick[ovrHand_Right].x > 0.0f && inputState.thumbstick[ovrHand_Right].y < 0.2f && inputState.thumbstick[ovrHand_Right].y > -0.2f) {
 				// Grow the cube
 				Window::cube->scale(0.05f);
 			}
-			else if (inputState.Thumbstick[ovrHand_Right].x < 0.0f && inputState.Thumbstick[ovrHand_Right].y < 0.2f && inputState.Thumbstick[ovrHand_Right].y > -0.2f) {
+			else if (inputState.thumbstick[ovrHand_Right].x < 0.0f && inputState.thumbstick[ovrHand_Right].y < 0.2f && inputState.thumbstick[ovrHand_Right].y > -0.2f) {
 				// Shrink the cube
 				Window::cube->scale(-0.05f);
 			}
-			if (inputState.Thumbstick[ovrHand_Right].y > 0.0f && inputState.Thumbstick[ovrHand_Right].x < 0.3f && inputState.Thumbstick[ovrHand_Right].x > -0.3f) {
+			if (inputState.thumbstick[ovrHand_Right].y > 0.0f && inputState.thumbstick[ovrHand_Right].x < 0.3f && inputState.thumbstick[ovrHand_Right].x > -0.3f) {
 				// Translate cube FORWARD
 				Window::cube->translateBACKFORTH(-0.005f);
 			}
-			else if (inputState.Thumbstick[ovrHand_Right].y < 0.0f && inputState.Thumbstick[ovrHand_Right].x < 0.3f && inputState.Thumbstick[ovrHand_Right].x > -0.3f) {
+			else if (inputState.thumbstick[ovrHand_Right].y < 0.0f && inputState.thumbstick[ovrHand_Right].x < 0.3f && inputState.thumbstick[ovrHand_Right].x > -0.3f) {
 				// Translate cube BACKWARD
 				Window::cube->translateBACKFORTH(0.005f);
 			}
 
 			// LEFT THUMBSTICK: Move Cube Left/Right and Up/Down
-			if (inputState.Thumbstick[ovrHand_Left].x > 0.0f && inputState.Thumbstick[ovrHand_Left].y < 0.2f && inputState.Thumbstick[ovrHand_Left].y > -0.2f) {
+			if (inputState.thumbstick[ovrHand_Left].x > 0.0f && inputState.thumbstick[ovrHand_Left].y < 0.2f && inputState.thumbstick[ovrHand_Left].y > -0.2f) {
 				// Translate cube RIGHT
 				Window::cube->translateLEFTRIGHT(0.005f);
 			}
-			else if (inputState.Thumbstick[ovrHand_Left].x < 0.0f && inputState.Thumbstick[ovrHand_Left].y < 0.2f && inputState.Thumbstick[ovrHand_Left].y > -0.2f) {
+			else if (inputState.thumbstick[ovrHand_Left].x < 0.0f && inputState.thumbstick[ovrHand_Left].y < 0.2f && inputState.thumbstick[ovrHand_Left].y > -0.2f) {
 				// Translate cube LEFT
 				Window::cube->translateLEFTRIGHT(-0.005f);
 			}
-			if (inputState.Thumbstick[ovrHand_Left].y > 0.0f && inputState.Thumbstick[ovrHand_Left].x < 0.3f && inputState.Thumbstick[ovrHand_Left].x > -0.3f) {
+			if (inputState.thumbstick[ovrHand_Left].y > 0.0f && inputState.thumbstick[ovrHand_Left].x < 0.3f && inputState.thumbstick[ovrHand_Left].x > -0.3f) {
 				// Translate cube FORWARD
 				Window::cube->translateUPDOWN(0.005f);
 			}
-			else if (inputState.Thumbstick[ovrHand_Left].y < 0.0f && inputState.Thumbstick[ovrHand_Left].x < 0.3f && inputState.Thumbstick[ovrHand_Left].x > -0.3f) {
+			else if (inputState.thumbstick[ovrHand_Left].y < 0.0f && inputState.thumbstick[ovrHand_Left].x < 0.3f && inputState.thumbstick[ovrHand_Left].x > -0.3f) {
 				// Translate cube BACKWARD
 				Window::cube->translateUPDOWN(-0.005f);
 			}
@@ -1059,6 +1192,14 @@ namespace Attribute {
 // An example application that renders a simple cube
 class ExampleApp : public RiftApp {
 
+	CoasterScene coaster;
+	bool riding = false;
+	double lastUpdate = 0.0;
+	double coasterMs = 0.0;
+	double budgetCpu = 0.0, budgetGpu = 0.0;
+	int budgetFrames = 0, budgetMissed = 0;
+	unsigned int budgetLastFrame = 0;
+
 public:
 	ExampleApp() { }
 
@@ -1067,7 +1208,8 @@ protected:
 	void initGl() override {
 		RiftApp::initGl();
 		Window::initialize(_session);
-
+		coaster.initialize(Window::lineShader);
+		lastUpdate = Profiler::now();
 	}
 
 	void shutdownGl() override {
@@ -1078,38 +1220,122 @@ protected:
 		Window::reset(_session);
 	}
 
+	void update() override {
+		// a rebuilt program may have moved its uniforms
+		if (ShaderManager::poll()) {
+			Window::queue.forgetPrograms();
+			coaster.forgetProgram();
+		}
 
-	void keyCallback() {
-		ovrInputState inputState;
-
-		ovrPosef eyePoses[2];
-		ovr_GetEyePoses(_session, frame, true, _viewScaleDesc.HmdToEyeOffset, eyePoses, &_sceneLayer.SensorSampleTime);
-		
-		if (OVR_SUCCESS(ovr_GetInputState(_session, ovrControllerType_Touch, &inputState))) {
-			
-
+		double now = Profiler::now();
+		double elapsed = now - lastUpdate;
+		lastUpdate = now;
+		if (riding) {
+			coaster.update(elapsed / 1000.0);
+			coasterMs += Profiler::now() - now;
+			logBudget();
 		}
 	}
 
-	
 
 	void renderScene(const glm::mat4 & projection, const glm::mat4 & headPose) override {
-		
+		glm::mat4 pose = headPose;
+		if (!riding) {
+			Window::displayCallback(projection, pose);
+		}
+		else {
+			// the whole tracking space rides along, so the head pose is relative to the seat;
+			// only the coaster's own work counts towards its share of the budget, not the scene
+			double start = Profiler::now();
+			pose = coaster.ride() * headPose;
+			coasterMs += Profiler::now() - start;
+			Window::displayCallback(projection, pose);
+			start = Profiler::now();
+			coaster.draw(projection, glm::inverse(pose));
+			coasterMs += Profiler::now() - start;
+		}
 
-		Window::displayCallback(projection, headPose);
-		
-		//Window::displayCallback(projection, headPose, _session, frame);
-		//keyCallback();
+		// last, so it only fills what the scene left empty
+		if (!Window::skyFirst) {
+			Window::drawSky(projection, pose);
+		}
+	}
 
+	// Averages the frames whose GPU passes are back over COASTER_BUDGET_FRAMES and logs them
+	// against the 11.1 ms a frame has at 90 Hz, with the part the coaster's own work took
+	void logBudget() {
+		const ProfileFrame* latest = Profiler::latestComplete();
+		if (latest == nullptr || latest->frame == budgetLastFrame) {
+			return;
+		}
+		budgetLastFrame = latest->frame;
+		double budget = 1000.0 / 90.0;
+		budgetCpu += latest->cpuTime;
+		budgetGpu += latest->gpuTime;
+		if (latest->cpuTime > budget || latest->gpuTime > budget) {
+			budgetMissed++;
+		}
+		if (++budgetFrames < COASTER_BUDGET_FRAMES) {
+			return;
+		}
+
+		char buff[200];
+		sprintf_s(buff, "Coaster at 90 Hz: cpu %.2f ms, gpu %.2f ms of %.2f ms, coaster %.2f ms, %d of %d frames over\n",
+			budgetCpu / budgetFrames, budgetGpu / budgetFrames, budget, coasterMs / budgetFrames, budgetMissed, budgetFrames);
+		OutputDebugStringA(buff);
+		printf("%s", buff);
+		budgetFrames = budgetMissed = 0;
+		budgetCpu = budgetGpu = coasterMs = 0.0;
 	}
+
 	void onKey(int key, int scancode, int action, int mods) override {
 		if (GLFW_PRESS == action) switch (key) {
+		case GLFW_KEY_C: // gets on or off the roller coaster, logging the frame budget while riding
+			riding = !riding;
+			budgetFrames = budgetMissed = 0;
+			budgetCpu = budgetGpu = coasterMs = 0.0;
+			return;
+		case GLFW_KEY_H: // benchmarks picking among 10000 control points
+			benchmarkPointPicker();
+			return;
+		case GLFW_KEY_J: // times dragging one control point of a 1000 segment track through to the GPU,
+			// with shift tessellating whole tracks of 8 to 100000 segments
+			if (mods & GLFW_MOD_SHIFT)
+				benchmarkTrackTessellation();
+			else
+				benchmarkTrackMesh();
+			return;
+		case GLFW_KEY_K: // benchmarks the arc length track spline against stepping the Bezier parameter
+			benchmarkTrackSpline();
+			return;
+		case GLFW_KEY_N: // benchmarks transform updates over 100000 scene nodes, 1% changing a frame
+			benchmarkSceneGraph();
+			return;
+		case GLFW_KEY_U: // benchmarks the per frame control point walks, std::list against typed pools
+			benchmarkPools();
+			return;
+		case GLFW_KEY_V: // rides the loop headless for a minute, logging the angular jerk of the ride camera
+			benchmarkRideCamera();
+			return;
+		case GLFW_KEY_O: // toggles the profiler overlay in the headset
+			Profiler::showOverlay = !Profiler::showOverlay;
+			return;
+		case GLFW_KEY_P: // dumps the profiler history as a Chrome trace
+			Profiler::writeChromeTrace("profile.json");
+			return;
+		case GLFW_KEY_Q: // switches between the render queue and immediate draws, logging the binds of both
+			RenderStats::report(Window::useQueue ? "render queue" : "immediate draws");
+			Window::useQueue = !Window::useQueue;
+			statsFrames = 1;
+			return;
+		case GLFW_KEY_S: // counts the fragments of the next two wall passes, the sky drawn first and then last
+			skyFrames = 2;
+			return;
 		case GLFW_KEY_R:
 			
 		case GLFW_KEY_T: // debug key that prints current head position and orientation
 
-			ovrPosef eyePoses[2];
-			ovr_GetEyePoses(_session, frame, true, _viewScaleDesc.HmdToEyeOffset, eyePoses, &_sceneLayer.SensorSampleTime);
+			const ovrPosef* eyePoses = frameContext.eyePoses;
 
 			char buff[100];
 			sprintf_s(buff, "(%f, %f, %f)\n", eyePoses[0].Position.x, eyePoses[0].Position.y, eyePoses[0].Position.z);
@@ -1134,6 +1360,11 @@ protected:
 // Execute our example class
 int __stdcall WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nCmdShow) {
 
+	// "-coaster-check" runs the coaster dynamics checks without a headset or GL and exits, 0 when they pass
+	if (strncmp(lpCmdLine, "-coaster-check", 14) == 0) {
+		return benchmarkCoasterDynamics() ? 0 : 1;
+	}
+
 	int result = -1;
 	try {
 		if (!OVR_SUCCESS(ovr_Initialize(nullptr))) {
@@ -3,7 +3,13 @@
 #include <vector>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <algorithm>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#include <Windows.h>
+#endif
 using namespace std;
 
 #define GLFW_INCLUDE_GLEXT
@@ -16,115 +22,310 @@ using namespace std;
 
 #include "shader.h"
 
-GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path){
-
-	// Create the shaders
-	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
-	GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
-
-	// Read the Vertex Shader code from the file
-	std::string VertexShaderCode;
-	std::ifstream VertexShaderStream(vertex_file_path, std::ios::in);
-	if(VertexShaderStream.is_open()){
-		std::string Line = "";
-		while(getline(VertexShaderStream, Line))
-			VertexShaderCode += "\n" + Line;
-		VertexShaderStream.close();
-	}else{
-		glClearColor(1.0f, 0.0f, 1.0f, 0.0f);
-		printf("Impossible to open %s. Check to make sure the file exists and you passed in the right filepath!\n", vertex_file_path);
-		printf("The current working directory is:");
-		// Please for the love of whatever deity/ies you believe in never do something like the next line of code,
-		// Especially on non-Windows systems where you can have the system happily execute "rm -rf ~"
-#ifdef _WIN32
-		system("CD");
+#ifdef _DEBUG
+bool ShaderManager::watch = true;
 #else
-		system("pwd");
+bool ShaderManager::watch = false;
 #endif
-		getchar();
+
+vector<ShaderManager::Program> ShaderManager::programs;
+unsigned int ShaderManager::frames = 0;
+double ShaderManager::loadTime = 0.0;
+unsigned int ShaderManager::cached = 0;
+unsigned int ShaderManager::compiled = 0;
+
+GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path, const char * defines){
+	return ShaderManager::load(vertex_file_path, fragment_file_path, defines);
+}
+
+GLuint ShaderManager::load(const char* vertexPath, const char* fragmentPath, const char* defines)
+{
+	double start = glfwGetTime();
+
+	string vertexSource, fragmentSource;
+	if (!readFile(vertexPath, defines, vertexSource) || !readFile(fragmentPath, defines, fragmentSource))
+	{
+		glClearColor(1.0f, 0.0f, 1.0f, 0.0f);
 		return 0;
 	}
 
-	// Read the Fragment Shader code from the file
-	std::string FragmentShaderCode;
-	std::ifstream FragmentShaderStream(fragment_file_path, std::ios::in);
-	if(FragmentShaderStream.is_open()){
-		std::string Line = "";
-		while(getline(FragmentShaderStream, Line))
-			FragmentShaderCode += "\n" + Line;
-		FragmentShaderStream.close();
+	string binaryPath = cachePath(vertexSource, fragmentSource);
+	GLuint program = glCreateProgram();
+	if (loadBinary(program, binaryPath))
+	{
+		cached++;
+	}
+	else
+	{
+		glDeleteProgram(program);
+		program = build(vertexSource, fragmentSource, vertexPath, fragmentPath);
+		if (program == 0)
+		{
+			glClearColor(1.0f, 0.0f, 1.0f, 0.0f);
+			return 0;
+		}
+		saveBinary(program, binaryPath);
+		compiled++;
 	}
 
-	GLint Result = GL_FALSE;
-	int InfoLogLength;
+	Program entry;
+	entry.id = program;
+	entry.vertexPath = vertexPath;
+	entry.fragmentPath = fragmentPath;
+	entry.defines = defines;
+	entry.vertexTime = modifiedTime(entry.vertexPath);
+	entry.fragmentTime = modifiedTime(entry.fragmentPath);
+	programs.push_back(entry);
 
+	loadTime += glfwGetTime() - start;
+	return program;
+}
 
-	// Compile Vertex Shader
-	printf("Compiling shader : %s\n", vertex_file_path);
-	char const * VertexSourcePointer = VertexShaderCode.c_str();
-	glShaderSource(VertexShaderID, 1, &VertexSourcePointer , NULL);
-	glCompileShader(VertexShaderID);
+bool ShaderManager::poll()
+{
+	if (!watch || ++frames % SHADER_WATCH_INTERVAL != 0)
+		return false;
 
-	// Check Vertex Shader
-	glGetShaderiv(VertexShaderID, GL_COMPILE_STATUS, &Result);
-	glGetShaderiv(VertexShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	if ( InfoLogLength > 0 ){
-		std::vector<char> VertexShaderErrorMessage(InfoLogLength+1);
-		glGetShaderInfoLog(VertexShaderID, InfoLogLength, NULL, &VertexShaderErrorMessage[0]);
-		printf("%s\n", &VertexShaderErrorMessage[0]);
-		glClearColor(1.0f, 0.0f, 1.0f, 0.0f);
+	bool reloaded = false;
+	for (unsigned int i = 0; i < programs.size(); i++)
+	{
+		Program& entry = programs[i];
+		long long vertexTime = modifiedTime(entry.vertexPath);
+		long long fragmentTime = modifiedTime(entry.fragmentPath);
+		if (vertexTime == entry.vertexTime && fragmentTime == entry.fragmentTime)
+			continue;
+		// a build that fails isn't retried until the sources change again
+		entry.vertexTime = vertexTime;
+		entry.fragmentTime = fragmentTime;
+
+		string vertexSource, fragmentSource;
+		if (!readFile(entry.vertexPath.c_str(), entry.defines, vertexSource) || !readFile(entry.fragmentPath.c_str(), entry.defines, fragmentSource))
+			continue;
+		GLuint fresh = build(vertexSource, fragmentSource, entry.vertexPath.c_str(), entry.fragmentPath.c_str());
+		if (fresh == 0)
+		{
+			printf("Keeping the previous build of %s / %s\n", entry.vertexPath.c_str(), entry.fragmentPath.c_str());
+			continue;
+		}
 
+		// everything holds on to the id, so the new build is moved into the old program object
+		GLenum format;
+		vector<char> binary;
+		if (getBinary(fresh, format, binary) && putBinary(entry.id, format, binary))
+		{
+			saveBinary(entry.id, cachePath(vertexSource, fragmentSource));
+			printf("Reloaded %s / %s\n", entry.vertexPath.c_str(), entry.fragmentPath.c_str());
+			reloaded = true;
+		}
+		else
+		{
+			printf("The driver can't hand back program binaries, restart to pick up %s / %s\n", entry.vertexPath.c_str(), entry.fragmentPath.c_str());
+		}
+		glDeleteProgram(fresh);
 	}
-	else {
-		printf("Successfully compiled vertex shader!\n");
+	return reloaded;
+}
+
+void ShaderManager::reportStartup()
+{
+	char buff[200];
+	snprintf(buff, sizeof(buff), "Shaders: %u programs in %.1f ms, %u from the binary cache, %u compiled\n",
+		cached + compiled, loadTime * 1000.0, cached, compiled);
+	printf("%s", buff);
+#ifdef _WIN32
+	OutputDebugStringA(buff);
+#endif
+}
+
+bool ShaderManager::readFile(const char* path, const string& defines, string& source)
+{
+	ifstream stream(path, ios::in | ios::binary);
+	if (!stream.is_open())
+	{
+		printf("Impossible to open %s. Check that the file exists and the working directory is the project directory.\n", path);
+		return false;
 	}
+	stringstream contents;
+	contents << stream.rdbuf();
+	source = contents.str();
 
+	if (defines.empty())
+		return true;
 
+	// #version has to stay the first line
+	size_t body = 0;
+	if (source.compare(0, 8, "#version") == 0)
+	{
+		body = source.find('\n');
+		if (body == string::npos)
+		{
+			source += '\n';
+			body = source.size();
+		}
+		else
+		{
+			body++;
+		}
+	}
+	source.insert(body, defines[defines.size() - 1] == '\n' ? defines : defines + "\n");
+	return true;
+}
 
-	// Compile Fragment Shader
-	printf("Compiling shader : %s\n", fragment_file_path);
-	char const * FragmentSourcePointer = FragmentShaderCode.c_str();
-	glShaderSource(FragmentShaderID, 1, &FragmentSourcePointer , NULL);
-	glCompileShader(FragmentShaderID);
+long long ShaderManager::modifiedTime(const string& path)
+{
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0)
+		return -1;
+	return (long long)info.st_mtime;
+}
 
-	// Check Fragment Shader
-	glGetShaderiv(FragmentShaderID, GL_COMPILE_STATUS, &Result);
-	glGetShaderiv(FragmentShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	if ( InfoLogLength > 0 ){
-		std::vector<char> FragmentShaderErrorMessage(InfoLogLength+1);
-		glGetShaderInfoLog(FragmentShaderID, InfoLogLength, NULL, &FragmentShaderErrorMessage[0]);
-		printf("%s\n", &FragmentShaderErrorMessage[0]);
-		glClearColor(1.0f, 0.0f, 1.0f, 0.0f);
+string ShaderManager::cachePath(const string& vertexSource, const string& fragmentSource)
+{
+	// 64 bit FNV-1a over both sources and the driver, a new driver build has to relink everything
+	unsigned long long hash = 14695981039346656037ull;
+	string driver = string((const char*)glGetString(GL_VENDOR)) + (const char*)glGetString(GL_RENDERER) + (const char*)glGetString(GL_VERSION);
+	const string* parts[3] = { &vertexSource, &fragmentSource, &driver };
+	for (int p = 0; p < 3; p++)
+	{
+		for (size_t i = 0; i < parts[p]->size(); i++)
+		{
+			hash ^= (unsigned char)(*parts[p])[i];
+			hash *= 1099511628211ull;
+		}
+		// keep "ab" + "c" apart from "a" + "bc"
+		hash ^= 0xFF;
+		hash *= 1099511628211ull;
+	}
+	char name[64];
+	snprintf(name, sizeof(name), SHADER_CACHE_DIR "/%016llx.bin", hash);
+	return name;
+}
+
+bool ShaderManager::getBinary(GLuint program, GLenum& format, vector<char>& binary)
+{
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (formats == 0 || length == 0)
+		return false;
+	binary.resize(length);
+	glGetProgramBinary(program, length, NULL, &format, &binary[0]);
+	return true;
+}
+
+bool ShaderManager::putBinary(GLuint program, GLenum format, const vector<char>& binary)
+{
+	glProgramBinary(program, format, &binary[0], binary.size());
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	return linked == GL_TRUE;
+}
+
+bool ShaderManager::loadBinary(GLuint program, const string& path)
+{
+	FILE* fp = fopen(path.c_str(), "rb");
+	if (fp == NULL)
+		return false;
+	GLenum format = 0;
+	vector<char> binary;
+	bool read = fread(&format, sizeof(format), 1, fp) == 1;
+	if (read)
+	{
+		fseek(fp, 0, SEEK_END);
+		long size = ftell(fp) - (long)sizeof(format);
+		fseek(fp, sizeof(format), SEEK_SET);
+		read = size > 0;
+		if (read)
+		{
+			binary.resize(size);
+			read = fread(&binary[0], 1, size, fp) == (size_t)size;
+		}
+	}
+	fclose(fp);
+	// a truncated file or a binary the driver no longer accepts just means compiling again
+	return read && putBinary(program, format, binary);
+}
+
+void ShaderManager::saveBinary(GLuint program, const string& path)
+{
+	GLenum format;
+	vector<char> binary;
+	if (!getBinary(program, format, binary))
+		return;
+#ifdef _WIN32
+	_mkdir(SHADER_CACHE_DIR);
+#else
+	mkdir(SHADER_CACHE_DIR, 0755);
+#endif
+	FILE* fp = fopen(path.c_str(), "wb");
+	if (fp == NULL)
+		return;
+	fwrite(&format, sizeof(format), 1, fp);
+	fwrite(&binary[0], 1, binary.size(), fp);
+	fclose(fp);
+}
 
+GLuint ShaderManager::compile(GLenum type, const string& source, const char* path)
+{
+	printf("Compiling shader : %s\n", path);
+	GLuint shader = glCreateShader(type);
+	char const * sourcePointer = source.c_str();
+	glShaderSource(shader, 1, &sourcePointer, NULL);
+	glCompileShader(shader);
+
+	GLint result = GL_FALSE;
+	int infoLogLength;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &result);
+	glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLogLength);
+	if (infoLogLength > 0) {
+		std::vector<char> errorMessage(infoLogLength + 1);
+		glGetShaderInfoLog(shader, infoLogLength, NULL, &errorMessage[0]);
+		printf("%s\n", &errorMessage[0]);
 	}
-	else {
-		printf("Successfully compiled fragment shader!\n");
+	if (result != GL_TRUE) {
+		glDeleteShader(shader);
+		return 0;
 	}
+	return shader;
+}
 
+GLuint ShaderManager::build(const string& vertexSource, const string& fragmentSource, const char* vertexPath, const char* fragmentPath)
+{
+	GLuint vertexShader = compile(GL_VERTEX_SHADER, vertexSource, vertexPath);
+	GLuint fragmentShader = compile(GL_FRAGMENT_SHADER, fragmentSource, fragmentPath);
+	if (vertexShader == 0 || fragmentShader == 0) {
+		glDeleteShader(vertexShader);
+		glDeleteShader(fragmentShader);
+		return 0;
+	}
 
 	// Link the program
 	printf("Linking program\n");
-	GLuint ProgramID = glCreateProgram();
-	glAttachShader(ProgramID, VertexShaderID);
-	glAttachShader(ProgramID, FragmentShaderID);
-	glLinkProgram(ProgramID);
-
-	// Check the program
-	glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
-	glGetProgramiv(ProgramID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	if ( InfoLogLength > 0 ){
-		std::vector<char> ProgramErrorMessage(InfoLogLength+1);
-		glGetProgramInfoLog(ProgramID, InfoLogLength, NULL, &ProgramErrorMessage[0]);
-		printf("%s\n", &ProgramErrorMessage[0]);
-		glClearColor(1.0f, 0.0f, 1.0f, 0.0f);
+	GLuint program = glCreateProgram();
+	glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glAttachShader(program, vertexShader);
+	glAttachShader(program, fragmentShader);
+	glLinkProgram(program);
 
+	GLint result = GL_FALSE;
+	int infoLogLength;
+	glGetProgramiv(program, GL_LINK_STATUS, &result);
+	glGetProgramiv(program, GL_INFO_LOG_LENGTH, &infoLogLength);
+	if (infoLogLength > 0) {
+		std::vector<char> errorMessage(infoLogLength + 1);
+		glGetProgramInfoLog(program, infoLogLength, NULL, &errorMessage[0]);
+		printf("%s\n", &errorMessage[0]);
+	}
+
+	glDetachShader(program, vertexShader);
+	glDetachShader(program, fragmentShader);
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+
+	if (result != GL_TRUE) {
+		glDeleteProgram(program);
+		return 0;
 	}
-	
-	glDetachShader(ProgramID, VertexShaderID);
-	glDetachShader(ProgramID, FragmentShaderID);
-	
-	glDeleteShader(VertexShaderID);
-	glDeleteShader(FragmentShaderID);
-
-	return ProgramID;
-}
\ No newline at end of file
+	return program;
+}
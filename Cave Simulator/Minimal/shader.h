@@ -1,6 +1,61 @@
 #ifndef SHADER_HPP
 #define SHADER_HPP
 
-GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path);
+#include <string>
+#include <vector>
+using namespace std;
+
+// Directory linked program binaries are kept in, relative to the working directory
+#define SHADER_CACHE_DIR "shadercache"
+// Frames between checks of the shader sources for changes while watching
+#define SHADER_WATCH_INTERVAL 30
+
+// Loads, compiles and links a program, returning 0 when a file is missing or it fails to build.
+// defines is inserted after the #version line of both stages to build one variant of the sources.
+GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path, const char * defines = "");
+
+// Keeps every program loaded through LoadShaders. Linked programs are saved with
+// glGetProgramBinary under a hash of both sources and the driver strings, so a warm start
+// only has to hand the binary back to the same driver. While watching, programs whose
+// sources changed on disk are rebuilt in place, keeping their ids; a rebuild that fails
+// leaves the old program running.
+class ShaderManager
+{
+public:
+	// on in debug builds
+	static bool watch;
+
+	static GLuint load(const char* vertexPath, const char* fragmentPath, const char* defines = "");
+	// Checks the sources every SHADER_WATCH_INTERVAL calls, once a frame. True when a program was
+	// rebuilt, uniform locations and block bindings cached for it have to be looked up again.
+	static bool poll();
+	// Logs the time spent loading programs so far and how many came from the cache
+	static void reportStartup();
+
+private:
+	struct Program {
+		GLuint id;
+		string vertexPath, fragmentPath, defines;
+		long long vertexTime, fragmentTime;
+	};
+
+	static vector<Program> programs;
+	static unsigned int frames;
+	static double loadTime;
+	static unsigned int cached, compiled;
+
+	// Reads a stage and puts defines right after its #version line
+	static bool readFile(const char* path, const string& defines, string& source);
+	static long long modifiedTime(const string& path);
+	static string cachePath(const string& vertexSource, const string& fragmentSource);
+	static bool getBinary(GLuint program, GLenum& format, vector<char>& binary);
+	// Replaces program with the binary, false and an unusable program when the driver rejects it
+	static bool putBinary(GLuint program, GLenum format, const vector<char>& binary);
+	static bool loadBinary(GLuint program, const string& path);
+	static void saveBinary(GLuint program, const string& path);
+	static GLuint compile(GLenum type, const string& source, const char* path);
+	// Compiles and links a new program, 0 after logging the errors when either stage fails
+	static GLuint build(const string& vertexSource, const string& fragmentSource, const char* vertexPath, const char* fragmentPath);
+};
 
 #endif
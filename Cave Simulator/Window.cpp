@@ -1,4 +1,10 @@
 #include "window.h"
+#include "Minimal/TrackSpline.h"
+#include "Minimal/PointPicker.h"
+#include "Minimal/CoasterDynamics.h"
+#include "Minimal/Pool.h"
+#include "Minimal/RideCamera.h"
+#include "Minimal/UnitCube.h"
 using namespace std;
 
 const char* window_title = "GLFW Starter Project";
@@ -12,16 +18,34 @@ Cam* currCam;
 Point* activePt;
 Group* tracks;
 int camCtr = 0;
-Track* active_track;
-float track_pt = 0.0f;
+// the coaster runs on distance along the whole loop, the Track chain is only drawn and edited
+TrackSpline spline;
+float track_distance = 0.0f;
+// the Points and Tracks of tracks by type, so nothing has to walk its children and cast them;
+// segment_points names the four control points of every segment, shared anchors twice
+struct TrackPoint {
+	Point* point;
+	int segment;
+	int index;
+};
+Pool<TrackPoint> track_points;
+Pool<Track*> track_pool;
+PoolHandle segment_points[8][4];
+// every Point of tracks and where it is in the world, projected for picking once a frame
+PointPicker picker;
+std::vector<Point*> pick_points;
+std::vector<glm::vec3> pick_positions;
 float grav = 300.0f;
-float speed = 0.01f;
 int dor = 1;
+// rides the spline in fixed steps of real time, track_distance is where it's drawn
+CoasterDynamics coaster;
+double last_time = 0.0;
+// what bearCam sees, smoothed along parallel transport frames of the spline
+RideCamera ride_camera;
 Group* world;
 Group* trecks;
 
 Lights* light;
-GLuint skyboxVAO, skyboxVBO;
 GLint shaderProgram;
 GLint skyboxShader;
 GLint trackShader;
@@ -42,11 +66,6 @@ int Window::height = 500;
 glm::vec2 center((float)Window::width / 2.0f, (float)Window::height / 2.0f);
 glm::vec2 moPos(0.0f, 0.0f);
 int pressToggle = 0;
-Track* this_track;
-float temp_height = -100.0f;
-float max_height = temp_height;
-float min_height = max_height;
-float ht_addres = 0.0f;
 
 glm::mat4 Window::P;
 glm::mat4 Window::V;
@@ -129,28 +148,17 @@ GLuint loadCubemap(vector<const GLchar*> faces)
 	return textureID;
 }
 
-Group* draw_control() {
+void draw_control() {
 
 	std::vector<glm::vec3> vertices;
 	GLuint VAO, VBO;
 
-	std::list<Node*>::iterator it = tracks->children.begin();//children[0]
-	it++;
-	glm::vec3 sav = ((Point*)(*it))->loc;//children[1]
-	
-	for (int i = 0; i < 7; i++) {
-		it++;
-		vertices.push_back(((Point*)(*it))->loc);
-		it++;
-		it++;
-		vertices.push_back(((Point*)(*it))->loc);
+	// the line through every anchor between the handles on either side of it
+	for (int i = 0; i < 8; i++) {
+		vertices.push_back(track_points.get(segment_points[i][2]).point->loc);
+		vertices.push_back(track_points.get(segment_points[(i + 1) % 8][1]).point->loc);
 	}
 
-	it++;
-	vertices.push_back(((Point*)(*it))->loc);
-	vertices.push_back(sav);
-	it++;
-
 	// Create buffers/arrays
 	glGenVertexArrays(1, &VAO);
 	glGenBuffers(1, &VBO);
@@ -188,142 +196,94 @@ Group* draw_control() {
 	glBindVertexArray(VAO);
 	glDrawArrays(GL_LINES, 0, 16);
 	glBindVertexArray(0);
+}
 
-	return ((Group*)(*it));
+void update_picker() {
+	pick_points.clear();
+	pick_positions.clear();
+	for (int i = 0; i < track_points.size(); i++) {
+		Point* pt = track_points[i].point;
+		pick_points.push_back(pt);
+		pick_positions.push_back(glm::vec3(pt->toWorld * glm::vec4(pt->loc, 1.0f)));
+	}
+	picker.update(Window::P * Window::V, &pick_positions.front(), pick_positions.size());
 }
 
 Point* manip_pt(double ex, double why) {
-	glm::vec2 pt, mouse, diff;
-	std::list<Node*>::iterator it = tracks->children.begin();//children[0]
-	glm::vec4 cam_space;
-	float x, y;
-
 	float mouse_x = ((2.0f * (float)ex) - Window::width) / Window::width;
 	float mouse_y = (Window::height - (2.0f * (float)why)) / Window::height;
-	mouse = glm::vec2(mouse_x, mouse_y);
-	Point *found = nullptr;
-	for (int i = 0; i < 24; i++) {
-		cam_space = Window::P * Window::V * ((Point*)(*it))->toWorld * glm::vec4(((Point*)(*it))->loc, 1.0);
-		x = cam_space.x / cam_space.w;
-		y = cam_space.y / cam_space.w;
-		pt = glm::vec2(x, y);
-		diff = pt - mouse;
-		
-		if (abs(length(diff)) < 0.035f) {
-			found = ((Point*)(*it));
-			std::cout << "HIT\n";
-		}
-		it++;
-	}
-	return found;
+	int found = picker.pick(glm::vec2(mouse_x, mouse_y), 0.035f);
+	return found < 0 ? nullptr : pick_points[found];
+}
 
+// Rebuilds the curves of the Tracks whose bit is set in changed, Track i being segment i
+void update_tracks(int changed) {
+	for (int i = 0; i < track_pool.size(); i++) {
+		if (changed & (1 << i)) {
+			track_pool[i]->update_curves();
+		}
+	}
 }
 
-void update_tracks(Group* track_grp) {
-	for (std::list<Node*>::iterator it = track_grp->children.begin(); it != track_grp->children.end(); ++it) {
-		((Track*)(*it))->update_curves();
+// Control points of the eight segments, as init_tracks registered them
+void collect_segments(glm::vec3 segs[8][4]) {
+	for (int i = 0; i < 8; i++) {
+		for (int k = 0; k < 4; k++) {
+			segs[i][k] = track_points.get(segment_points[i][k]).point->loc;
+		}
 	}
 }
 
-Track* find_highest_pos() {
-	temp_height = -100.0f;
-	max_height = temp_height;
-	min_height = 100.0f;
-	ht_addres = 0.0f;
-	Track* to_ret = nullptr;
-	for (std::list<Node*>::iterator it = trecks->children.begin(); it != trecks->children.end(); ++it) {
-		if (to_ret == nullptr) {
-			to_ret = ((Track*)(*it));
-		}
-		this_track = ((Track*)(*it));
-		temp_height = this_track->vertices[0].y;
-
-		if (temp_height > max_height) {//initialize 
-			max_height = temp_height;
-			ht_addres = 0.0f;
-			to_ret = this_track;
-		}
-		else if (temp_height < min_height) {//initialize
-			min_height = temp_height;
-		}
-
-		for (int i = 1; i < 200; i = i + 2) {
-			temp_height = this_track->vertices[i].y;
-			if (temp_height > max_height) {
-				max_height = temp_height;
-				ht_addres = ((float)i)/200.0f;
-				
-				to_ret = this_track;
-			}
-			else if (temp_height < min_height) {
-				min_height = temp_height;
-			}
+void build_spline() {
+	glm::vec3 segs[8][4];
+	collect_segments(segs);
+	spline.clear();
+	for (int i = 0; i < 8; i++) {
+		spline.addSegment(segs[i]);
+	}
+}
 
+// Measures again only the segments a dragged Point belongs to, and returns them as bits for
+// update_tracks. A Point moves its pair or anchor along, so that's two or three segments.
+int refresh_spline() {
+	glm::vec3 segs[8][4];
+	collect_segments(segs);
+	int changed = 0;
+	for (int i = 0; i < 8; i++) {
+		const glm::vec3* old = spline.controlPoints(i);
+		if (old[0] != segs[i][0] || old[1] != segs[i][1] || old[2] != segs[i][2] || old[3] != segs[i][3]) {
+			spline.setSegment(i, segs[i]);
+			changed |= 1 << i;
 		}
 	}
-	return to_ret;
+	return changed;
 }
 
-void place_highest_pos() {
+// Distance of the highest point of the loop, from the spline's tables
+float find_highest_pos() {
+	float height;
+	return spline.highest(height);
+}
 
-	active_track = find_highest_pos();
-	track_pt = ht_addres;
-	float two[16] = { 1.0f, 0.0f, 0.0f, 0.0f,
-		0.0f, 1.0f, 0.0f, 0.0f,
-		0.0f, 0.0f, 1.0f, 0.0f,
-		active_track->find_pt(track_pt).x, active_track->find_pt(track_pt).y + 0.5f, active_track->find_pt(track_pt).z, 1.0f };
-	world->mat = glm::make_mat4(two);
+glm::mat4 car_matrix(const glm::vec3& pos) {
+	return glm::translate(glm::mat4(1.0f), pos + glm::vec3(0.0f, 0.5f, 0.0f));
+}
 
+void place_highest_pos() {
+	track_distance = find_highest_pos();
+	// the speed the old coaster had at the top, 0.2 below its energy
+	coaster.gravity = grav * (9.81f / 300.0f);
+	coaster.reset(spline, track_distance, sqrtf(2.0f * coaster.gravity * 0.2f));
+	ride_camera.build(spline);
+	ride_camera.reset(spline, track_distance);
+	last_time = glfwGetTime();
+	world->mat = car_matrix(spline.position(track_distance));
 }
 
 void Window::initialize_objects()
 {
 	glLineWidth(5.0f);
 	glPointSize(10.0f);
-	GLfloat skyboxVertices[] = {
-		// Positions          
-		-500.0f,  500.0f, -500.0f,
-		-500.0f, -500.0f, -500.0f,
-		500.0f, -500.0f, -500.0f,
-		500.0f, -500.0f, -500.0f,
-		500.0f,  500.0f, -500.0f,
-		-500.0f,  500.0f, -500.0f,
-
-		-500.0f, -500.0f,  500.0f,
-		-500.0f, -500.0f, -500.0f,
-		-500.0f,  500.0f, -500.0f,
-		-500.0f,  500.0f, -500.0f,
-		-500.0f,  500.0f,  500.0f,
-		-500.0f, -500.0f,  500.0f,
-
-		500.0f, -500.0f, -500.0f,
-		500.0f, -500.0f,  500.0f,
-		500.0f,  500.0f,  500.0f,
-		500.0f,  500.0f,  500.0f,
-		500.0f,  500.0f, -500.0f,
-		500.0f, -500.0f, -500.0f,
-
-		-500.0f, -500.0f,  500.0f,
-		-500.0f,  500.0f,  500.0f,
-		500.0f,  500.0f,  500.0f,
-		500.0f,  500.0f,  500.0f,
-		500.0f, -500.0f,  500.0f,
-		-500.0f, -500.0f,  500.0f,
-
-		-500.0f,  500.0f, -500.0f,
-		500.0f,  500.0f, -500.0f,
-		500.0f,  500.0f,  500.0f,
-		500.0f,  500.0f,  500.0f,
-		-500.0f,  500.0f,  500.0f,
-		-500.0f,  500.0f, -500.0f,
-
-		-500.0f, -500.0f, -500.0f,
-		-500.0f, -500.0f,  500.0f,
-		500.0f, -500.0f, -500.0f,
-		500.0f, -500.0f, -500.0f,
-		-500.0f, -500.0f,  500.0f,
-		500.0f, -500.0f,  500.0f
-	};
 
 	textures_faces.push_back("right.ppm");
 	textures_faces.push_back("left.ppm");
@@ -331,15 +291,6 @@ void Window::initialize_objects()
 	textures_faces.push_back("bottom.ppm");
 	textures_faces.push_back("back.ppm");
 	textures_faces.push_back("front.ppm");
-	// Setup skybox VAO
-	glGenVertexArrays(1, &skyboxVAO);
-	glGenBuffers(1, &skyboxVBO);
-	glBindVertexArray(skyboxVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
-	glBindVertexArray(0);
 
 	texture = loadCubemap(textures_faces);
 
@@ -354,7 +305,7 @@ void Window::initialize_objects()
 	// Load the shader program. Similar to the .obj objects, different platforms expect a different directory for files
 #ifdef _WIN32 // Windows (both 32 and 64 bit versions)
 	shaderProgram = LoadShaders("../shader.vert", "../shader.frag");
-	skyboxShader = LoadShaders("../sbshader.vert", "../sbshader.frag");
+	skyboxShader = LoadShaders("../sky.vert", "../skybox.frag");
 	trackShader = LoadShaders("../trackshader.vert", "../trackshader.frag");
 #else // Not windows
 	shaderProgram = LoadShaders("shader.vert", "shader.frag");
@@ -380,6 +331,27 @@ void Window::initialize_objects()
 
 }
 
+// Enters a segment's Points and Track in the pools, anchors shared with an earlier segment
+// only once
+void register_segment(int segment, Point** pts, Track* track) {
+	for (int k = 0; k < 4; k++) {
+		int found = -1;
+		for (int i = 0; i < track_points.size() && found < 0; i++) {
+			if (track_points[i].point == pts[k]) {
+				found = i;
+			}
+		}
+		if (found >= 0) {
+			segment_points[segment][k] = segment_points[track_points[found].segment][track_points[found].index];
+		}
+		else {
+			TrackPoint entry = { pts[k], segment, k };
+			segment_points[segment][k] = track_points.add(entry);
+		}
+	}
+	track_pool.add(track);
+}
+
 Group* Window::init_tracks() {
 	glm::vec3 ay1(-4.142135624f, 0.0f, 10.0f);
 	glm::vec3 es1(-2.0f, 2.0f, 10.0f);
@@ -397,6 +369,7 @@ Group* Window::init_tracks() {
 	Point* initial_pts[4] = { a1, s1, s2, a2 };
 
 	Track* track1 = (new Track(trackShader, initial_pts));
+	register_segment(0, initial_pts, track1);
 	Track* orig = track1;
 	Track* track2;
 	Group* to_ret = new Group();
@@ -476,6 +449,7 @@ Group* Window::init_tracks() {
 		initial_pts[3] = ab2;
 
 		track2 = (new Track(trackShader, initial_pts));
+		register_segment(i + 1, initial_pts, track2);
 		track1->next = track2;
 		track2->prev = track1;
 		track1 = track2;
@@ -486,71 +460,28 @@ Group* Window::init_tracks() {
 	orig->prev = track2;
 
 	to_ret->addChild(trackGrp);
+	trecks = trackGrp;
 	return to_ret;
 }
 
-float calcPE() {
-	//find_highest_pos();
-	float curr_height = active_track->find_pt(track_pt).y;
-
-	float mgh_max = max_height + 0.2f;
-
-	float old_speed = speed;
-	if(curr_height <= min_height) {
-		curr_height = min_height;
-	}
-	float delta = mgh_max - curr_height;
-	if (delta <= 0.0f) {
-		dor = -dor;
-		speed = old_speed;
-		//std::cout << speed << std::endl;
-	}
-	else {
-		speed = sqrtf(10.0f* (mgh_max - curr_height)) / 1500.0f;
-	}
-
-	return speed;
-}
-
 void next_state() {
-	float speed = calcPE();
-	glm::mat4 old_wld = world->mat;
-	Track* old_track = active_track;
-	float old_trp = track_pt;
-
-	track_pt = track_pt + (dor*speed);
-	if (track_pt < 0.0f) {
-		active_track = active_track->prev;
-		track_pt = track_pt + 1.0f;
-		float two[16] = { 1.0f, 0.0f, 0.0f, 0.0f,
-			0.0f, 1.0f, 0.0f, 0.0f,
-			0.0f, 0.0f, 1.0f, 0.0f,
-			active_track->find_pt(track_pt).x, active_track->find_pt(track_pt).y + 0.5f, active_track->find_pt(track_pt).z, 1.0f };
-		world->mat = glm::make_mat4(two);
+	if (spline.segmentCount() == 0) {
+		return;
 	}
-	else if (track_pt < 1.0f) {
-		float two[16] = { 1.0f, 0.0f, 0.0f, 0.0f,
-			0.0f, 1.0f, 0.0f, 0.0f,
-			0.0f, 0.0f, 1.0f, 0.0f,
-			active_track->find_pt(track_pt).x, active_track->find_pt(track_pt).y + 0.5f, active_track->find_pt(track_pt).z, 1.0f };
-		world->mat = glm::make_mat4(two);
-	}
-	else {
-		active_track = active_track->next;
-		track_pt = track_pt - 1.0f;
-		float two[16] = { 1.0f, 0.0f, 0.0f, 0.0f,
-			0.0f, 1.0f, 0.0f, 0.0f,
-			0.0f, 0.0f, 1.0f, 0.0f,
-			active_track->find_pt(track_pt).x, active_track->find_pt(track_pt).y + 0.5f, active_track->find_pt(track_pt).z, 1.0f };
-		world->mat = glm::make_mat4(two);
-	}
-
-	float twoo[16] = { 1.0f, 0.0f, 0.0f, 0.0f,
-		0.0f, 1.0f, 0.0f, 0.0f,
-		0.0f, 0.0f, 1.0f, 0.0f,
-		old_track->find_pt(old_trp).x, old_track->find_pt(old_trp).y + 0.5f, old_track->find_pt(old_trp).z, 1.0f };
-	old_wld = glm::make_mat4(twoo);
-
+	// grav 300 is earth gravity on a track measured in meters
+	coaster.gravity = grav * (9.81f / 300.0f);
+	double now = glfwGetTime();
+	double elapsed = now - last_time;
+	coaster.advance(spline, elapsed);
+	last_time = now;
+
+	float old_distance = track_distance;
+	track_distance = coaster.renderDistance(spline);
+	dor = coaster.speed < 0.0f ? -1 : 1;
+	world->mat = car_matrix(spline.position(track_distance));
+	ride_camera.update(spline, track_distance, coaster.speed, (float)elapsed);
+
+	glm::mat4 old_wld = car_matrix(spline.position(old_distance));
 	world->calc_dir(old_wld, dor);
 	
 }
@@ -564,6 +495,7 @@ void Window::clean_up()
 	glDeleteProgram(shaderProgram);
 	glDeleteProgram(skyboxShader);
 	glDeleteProgram(trackShader);
+	UnitCube::release();
 }
 
 GLFWwindow* Window::create_window(int width, int height)
@@ -654,39 +586,22 @@ void Window::display_callback(GLFWwindow* window)
 	// Clear the color and depth buffers
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	// skybox cube
-	glDepthMask(GL_FALSE);// Remember to turn depth writing off
-	// Update the scene graph
+	// Update the scene graph. Group::update still walks its children recursively to set the
+	// toWorld matrices draw() reads; Group keeps its children to itself, so this tree stays off
+	// Minimal/SceneGraph
 	world->update(glm::mat4(1.0f));
-	bearCam->cam_pos = glm::vec3(0.0f, 0.0f, 0.0f);
-	bearCam->cam_look_at = glm::vec3(0.0f, 0.0f, 1.0f);
-	glm::vec4 bearPos(bearCam->cam_pos, 1.0f);
-	glm::vec4 bearLookAt(bearCam->cam_look_at, 1.0f);
-	float mov[16] = { 1.0f, 0.0f, 0.0f, 0.0f,
-		0.0f, 1.0f, 0.0f, 0.0f,
-		0.0f, 0.0f, 1.0f, 0.0f,
-		0.0f, 1.0f, 1.0f, 1.0f };
-	glm::mat4 movpls = glm::make_mat4(mov);
-	bearPos = world->bear->toWorld * movpls *  bearPos;
-	bearLookAt = world->bear->toWorld * movpls *  bearLookAt;
+	// the rider's view, where the bear's head was: above the rail and a unit down the track
+	glm::mat4 ride = ride_camera.transform();
+	glm::vec4 bearPos = ride * glm::vec4(0.0f, 1.5f, -1.0f, 1.0f);
+	glm::vec4 bearLookAt = ride * glm::vec4(0.0f, 1.5f, -2.0f, 1.0f);
 	bearCam->cam_pos = glm::vec3(bearPos.x, bearPos.y, bearPos.z);
 	bearCam->cam_look_at = glm::vec3(bearLookAt.x, bearLookAt.y, bearLookAt.z);
+	bearCam->cam_up = glm::vec3(ride[1]);
 	bearCam->direction = bearCam->cam_look_at - bearCam->cam_pos;
 	
-	// Draw skybox first
-	glUseProgram(skyboxShader);
-	V = glm::lookAt(currCam->cam_pos - currCam->cam_pos, currCam->cam_look_at - currCam->cam_pos, currCam->cam_up);
-	glUniformMatrix4fv(glGetUniformLocation(skyboxShader, "view"), 1, GL_FALSE, &V[0][0]);
-	glUniformMatrix4fv(glGetUniformLocation(skyboxShader, "projection"), 1, GL_FALSE, &P[0][0]);
-	glBindVertexArray(skyboxVAO);
+	// the objects reflect the skybox
 	glActiveTexture(GL_TEXTURE0);
-	glUniform1i(glGetUniformLocation(skyboxShader, "skybox"), 0);
-
 	glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
-	glDrawArrays(GL_TRIANGLES, 0, 36);
-	glBindVertexArray(0);
-
-	glDepthMask(GL_TRUE);
 
 	// Use the shader of programID
 	glUseProgram(shaderProgram);
@@ -726,12 +641,28 @@ void Window::display_callback(GLFWwindow* window)
 	glUniformMatrix4fv(MatrixID, 1, GL_FALSE, &Window::P[0][0]);
 	tracks->draw();
 	glLineWidth(1.0f);
-	trecks = draw_control();
-	if (active_track == nullptr) {
+	draw_control();
+	if (spline.segmentCount() == 0) {
+		build_spline();
 		place_highest_pos();
 	}
+	update_picker();
 	glLineWidth(5.0f);
 
+	// Draw skybox last, at depth 1 where nothing else was drawn
+	glDepthFunc(GL_LEQUAL);
+	glUseProgram(skyboxShader);
+	glUniformMatrix4fv(glGetUniformLocation(skyboxShader, "view"), 1, GL_FALSE, &V[0][0]);
+	glUniformMatrix4fv(glGetUniformLocation(skyboxShader, "projection"), 1, GL_FALSE, &P[0][0]);
+	glBindVertexArray(UnitCube::vao());
+	glActiveTexture(GL_TEXTURE0);
+	glUniform1i(glGetUniformLocation(skyboxShader, "skybox"), 0);
+
+	glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+	glDrawArrays(GL_TRIANGLES, 0, UNIT_CUBE_VERTICES);
+	glBindVertexArray(0);
+	glDepthFunc(GL_LESS);
+
 	// Gets events, including input such as keyboard and mouse or window resizing
 	glfwPollEvents();
 	// Swap buffers
@@ -882,9 +813,10 @@ void Window::cursor_pos_callback(GLFWwindow* window, double xpos, double ypos)
 			}
 			if (activePt != nullptr) {
 				activePt->move_pos(newPos - moPos, currCam);
-				update_tracks(trecks);
-				if (active_track->find_pt(track_pt).y > max_height) {
-					max_height = active_track->find_pt(track_pt).y;
+				int changed = refresh_spline();
+				update_tracks(changed);
+				if (changed != 0) {
+					ride_camera.build(spline);
 				}
 			}
 
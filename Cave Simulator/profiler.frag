@@ -0,0 +1,10 @@
+#version 330 core
+
+in vec3 barColor;
+
+out vec4 color;
+
+void main()
+{
+	color = vec4(barColor, 1.0f);
+}
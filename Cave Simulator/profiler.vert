@@ -0,0 +1,14 @@
+#version 330 core
+
+// Profiler overlay bars, already in normalized device coordinates
+
+layout (location = 0) in vec2 position;
+layout (location = 1) in vec3 color;
+
+out vec3 barColor;
+
+void main()
+{
+    gl_Position = vec4(position, 0.0, 1.0);
+    barColor = color;
+}
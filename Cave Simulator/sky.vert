@@ -0,0 +1,18 @@
+#version 330 core
+
+// The skybox as directions: w 0 drops every translation in view and projection, so the sky
+// stays at infinity wherever the eye is, and xyww puts it at depth 1. Drawn last with
+// GL_LEQUAL, only pixels nothing else covered get shaded.
+
+layout (location = 0) in vec3 position;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+out vec3 texCoords;
+
+void main()
+{
+    gl_Position = (projection * view * vec4(position, 0.0)).xyww;
+    texCoords = position;
+}